@@ -21,6 +21,10 @@ public:
 	virtual void SetCaption(const wchar_t *title) = 0;
 	virtual void ShowMessage(const wchar_t *text) = 0;
     virtual void Tick() = 0;
+
+	/*! Called by the UI thread after a menu command has been clicked, so the thread calling Tick can be woken up instead of polling.
+	Must be thread safe and not call back into this. */
+	virtual void SetCommandWakeup(std::function<void()> fn) = 0;
 	virtual void BuildMenu() = 0;
 	virtual auint AddMenuItem(const wchar_t *msg, std::function<void()> onClick, bool enabled = true) = 0;
 	virtual void ChangeMenuItem(asizei entry, const wchar_t *msg, std::function<void()> onClick, bool enabled = true) = 0;
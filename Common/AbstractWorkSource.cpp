@@ -25,6 +25,10 @@ AbstractWorkSource::Events AbstractWorkSource::Refresh(bool canRead, bool canWri
     }
     Events ret;
 	if(canRead == false) return ret; // sends are still considered nops, as they don't really change the hi-level state
+    if(recvBuffer.MakeRoom() == false) { // line too long, no way to recover
+        ret.connFailed = true;
+        return ret;
+    }
     auto received(Receive(recvBuffer.NextBytes(), recvBuffer.Remaining()));
     if(received.first == false) {
         ret.connFailed = true;
@@ -33,35 +37,33 @@ AbstractWorkSource::Events AbstractWorkSource::Refresh(bool canRead, bool canWri
     else if(received.second == 0) return ret;
     ret.bytesReceived += received.second;
 	recvBuffer.used += received.second;
-	if(recvBuffer.Full()) recvBuffer.Grow();
+	if(recvBuffer.Pending() > recvBuffer.peak) recvBuffer.peak = recvBuffer.Pending();
 	
-	using namespace rapidjson;
-	Document object;
-	char *pos = recvBuffer.data.get();
-	char *lastEndl = nullptr;
     const auto prevDiff(GetCurrentDiff());
     const auto prevJob(stratum->GetCurrentJob());
-	while(pos < recvBuffer.NextBytes()) {
-		char *limit = std::find(pos, recvBuffer.NextBytes(), '\n');
-		if(limit >= recvBuffer.NextBytes()) pos = limit;
-		else {
-            ProcessLine(object, pos, limit - pos);
-            pos = limit;
-            lastEndl = pos++;
-
-        }
+    const asizei prevExtranonceChanges = stratum->GetExtranonceChanges();
+	bool mangled = false;
+	while(recvBuffer.scanned < recvBuffer.used) {
+		char *base = recvBuffer.data.get();
+		const char *endl = static_cast<const char*>(memchr(base + recvBuffer.scanned, '\n', recvBuffer.used - recvBuffer.scanned));
+		if(!endl) {
+			recvBuffer.scanned = recvBuffer.used;
+			break;
+		}
+		char *pos = base + recvBuffer.begin;
+		const asizei len = endl - pos;
+		// Consume before processing so a line throwing won't be mangled again. Data stays there until next MakeRoom.
+		recvBuffer.scanned = recvBuffer.begin + len + 1;
+		recvBuffer.Consumed(recvBuffer.scanned);
+		ProcessLine(pos, len);
+		mangled = true;
 	}
-	if(lastEndl) { // at least a line has been mangled
-		const char *src = lastEndl + 1;
-		char *dst = recvBuffer.data.get();
-		for(; src < recvBuffer.NextBytes(); src++, dst++) *dst = *src;
-		recvBuffer.used = src - (lastEndl + 1);
-#if _DEBUG
-		for(; dst < recvBuffer.data.get() + recvBuffer.allocated; dst++) *dst = 0;
-#endif
+	if(stratum->Nonce2SizeChanging()) { // GenWork would refuse the next job, better reconnect than keep mining the old one
+		ret.connFailed = true;
+		return ret;
 	}
-	else return ret;
-    return BuildWU(ret, prevDiff, prevJob);
+	if(!mangled) return ret;
+    return BuildWU(ret, prevDiff, prevJob, prevExtranonceChanges);
 }
 
 
@@ -87,12 +89,17 @@ stratum::AbstractWorkFactory* AbstractWorkSource::GenWork() const {
 	if(sizeof(nonce2) != subscription.extraNonceTwoSZ)  throw std::exception("nonce2 size mismatch");
 	if(diff.shareDiff <= 0.0) throw std::exception("GenWork must be called only when new work is signaled as available!");
 
-    auto btcLikeMerkle = [](std::array<aubyte, 32> &imerkle, const std::vector<aubyte> &coinbase) {
-        btc::SHA256Based(imerkle, coinbase.data(), coinbase.size());
+    using hashing::BTCSHA256;
+    auto btcLikeMerkle = [](std::array<aubyte, 32> &imerkle, const BTCSHA256 &prefix, const aubyte *tail, asizei count) {
+        BTCSHA256 hasher(prefix);
+        hasher.EndBlocks(tail, count);
+        BTCSHA256 twice(hasher, true);
+        DestinationStream dst(imerkle.data(), sizeof(imerkle));
+        twice.GetHash(dst);
     };
-    auto singleSHA256Merkle = [](std::array<aubyte, 32> &imerkle, const std::vector<aubyte> &coinbase) {
-		using hashing::BTCSHA256;
-		BTCSHA256 hasher(BTCSHA256(coinbase.data(), coinbase.size()));
+    auto singleSHA256Merkle = [](std::array<aubyte, 32> &imerkle, const BTCSHA256 &prefix, const aubyte *tail, asizei count) {
+		BTCSHA256 hasher(prefix);
+		hasher.EndBlocks(tail, count);
 		hasher.GetHash(imerkle);
     };
     stratum::AbstractWorkFactory::CBHashFunc merkleFunc;
@@ -135,21 +142,31 @@ stratum::WorkDiff AbstractWorkSource::GetCurrentDiff() const {
         auto difficulty(stratum->GetCurrentDiff());
         if(difficulty > 0.0) {
             result.shareDiff = difficulty * diffMul.stratum;
-            switch(diffMode) {
-            case::PoolInfo::dm_btc:
-                result.target = MakeTargetBits_BTC(result.shareDiff, diffMul.one);
-                break;
-            case::PoolInfo::dm_neoScrypt: 
-                result.target = MakeTargetBits_NeoScrypt(result.shareDiff, diffMul.one);
-                break;
-            default: throw std::exception("Impossible, forgot to update code for target bits generation maybe!");
-            }
+            result.target = MakeTargetBits(result.shareDiff);
         }
     }
     return result;
 }
 
 
+std::array<aulong, 4> AbstractWorkSource::MakeTargetBits(adouble shareDiff) const {
+    switch(diffMode) {
+    case::PoolInfo::dm_btc: return MakeTargetBits_BTC(shareDiff, diffMul.one);
+    case::PoolInfo::dm_neoScrypt: return MakeTargetBits_NeoScrypt(shareDiff, diffMul.one);
+    }
+    throw std::exception("Impossible, forgot to update code for target bits generation maybe!");
+}
+
+
+adouble AbstractWorkSource::GetHashesPerShare(adouble stratumDiff) const {
+    const auto target(MakeTargetBits(stratumDiff * diffMul.stratum));
+    const adouble BITS_64 = 18446744073709551616.0;
+    // Hashes are compared starting from the most significant ulong, the others just add precision.
+    const adouble chance = (adouble(LETOH(target[3])) + adouble(LETOH(target[2])) / BITS_64 + 1.0) / BITS_64;
+    return 1.0 / chance;
+}
+
+
 bool AbstractWorkSource::NeedsToSend() const {
 	return stratum && stratum->pending.size() != 0; // notice on construction this contains the subscription message
 }
@@ -174,11 +191,13 @@ void AbstractWorkSource::NewStratum(const Credentials &users) {
     stratum.reset(new StratumState);
     SetStratumCallbacks();
     for(const auto &auth : users) stratum->Authorize(auth.first, auth.second);
+    if(extranonceSubscribe) stratum->SubscribeExtranonce();
 }
 
 
 void AbstractWorkSource::ClearStratum() {
     stratum.reset();
+    recvBuffer.Clear();
     memset(recvBuffer.data.get(), 0, recvBuffer.allocated); // be extra special sure
 }
 
@@ -254,14 +273,14 @@ bool AbstractWorkSource::SendChunk() {
 			for(asizei i = 0; i < msg.total; i++) stratumDump<<msg.data[i];
 			stratumDump<<std::endl;
 #endif
-			stratum->pending.pop();
+			stratum->Sent();
 		}
 	}
     return true;
 }
 
 
-void AbstractWorkSource::ProcessLine(rapidjson::Document &json, char *pos, asizei len) {
+void AbstractWorkSource::ProcessLine(char *pos, asizei len) {
 #if STRATUM_DUMPTRAFFIC
 	stratumDump<<">>from server:";
 	for(asizei i = 0; i < len; i++) stratumDump<<pos[i];
@@ -269,6 +288,7 @@ void AbstractWorkSource::ProcessLine(rapidjson::Document &json, char *pos, asize
 #endif
 	ScopedFuncCall restoreChar([pos, len]() { pos[len] = '\n'; }); // not really necessary but I like the idea
 	pos[len] = 0;
+	auto &json(parsing.Recycle());
 	json.ParseInsitu(pos);
     using namespace rapidjson;
 	const Value::ConstMemberIterator &id(json.FindMember("id"));
@@ -309,7 +329,7 @@ void AbstractWorkSource::ProcessLine(rapidjson::Document &json, char *pos, asize
 }
 
 
-AbstractWorkSource::Events AbstractWorkSource::BuildWU(Events &ret, const stratum::WorkDiff &prevDiff, const stratum::MiningNotify &prevJob) const {
+AbstractWorkSource::Events AbstractWorkSource::BuildWU(Events &ret, const stratum::WorkDiff &prevDiff, const stratum::MiningNotify &prevJob, asizei prevExtranonceChanges) const {
     const auto nowDiff(GetCurrentDiff());
     const auto nowJob(stratum->GetCurrentJob());
     auto different = [](const stratum::MiningNotify &one, const stratum::MiningNotify &two) {
@@ -326,7 +346,8 @@ AbstractWorkSource::Events AbstractWorkSource::BuildWU(Events &ret, const stratu
         return diff;
     };
     ret.diffChanged = nowDiff != prevDiff;
-    ret.newWork = different(prevJob, nowJob) && GetCurrentDiff().shareDiff != .0; // new work is to be delayed as long as diff is 0
+    const bool newNonceOne = prevExtranonceChanges != stratum->GetExtranonceChanges(); // coinbase changes even if job does not
+    ret.newWork = (newNonceOne || different(prevJob, nowJob)) && GetCurrentDiff().shareDiff != .0; // new work is to be delayed as long as diff is 0
     if(prevDiff.shareDiff == .0 && nowDiff.shareDiff != .0) {
         // When this happens and we already have a job of any sort we can finally flush the new work to the outer code
         if(nowJob.job.size()) ret.newWork = true;
@@ -6,6 +6,9 @@
 #include "../Common/StratumState.h"
 #include <memory>
 #include <map>
+#include <array>
+#include <new>
+#include <type_traits>
 #include <time.h>
 #include <rapidjson/document.h>
 #include "../Common/AREN/ArenDataTypes.h"
@@ -74,6 +77,10 @@ public:
 	stratum::AbstractWorkFactory* GenWork() const;
     stratum::WorkDiff GetCurrentDiff() const;
 
+    /*! Average amount of hashes to compute to find a share at the given difficulty, in the same units as mining.set_difficulty.
+    This grows linearly with difficulty so it can also be used to figure out a difficulty from an hashrate. */
+    adouble GetHashesPerShare(adouble stratumDiff) const;
+
 	//! Apparently stratum supports unsubscribing, but I cannot found the documentation right now.
 	virtual void Shutdown() { ClearStratum(); }
 
@@ -87,6 +94,28 @@ public:
 
     bool Ready() const { return stratum != nullptr; } //!< A pool is ready if it is going to produce work. Not necessarily already producing or accepting.
 
+    /*! Stratum lines are limited in length only by the amount of memory we're willing to spend on them. A line not fitting this amount
+    of bytes causes the connection to fail. Values smaller than 4KiB are bumped to that. Current contents are preserved. */
+    void SetReceiveCeiling(asizei bytes) { recvBuffer.ceiling = bytes < 4096? 4096 : bytes; }
+
+    //! If true, next connections will ask for mining.set_extranonce updates. \sa StratumState::SubscribeExtranonce
+    void SetExtranonceSubscribe(bool enable) { extranonceSubscribe = enable; }
+
+    struct ReceiveStats {
+        asizei buffered; //!< bytes received but not consumed yet, typically a partial line
+        asizei capacity; //!< current size of the receive buffer
+        asizei peak; //!< max value of buffered observed so far
+        asizei copied; //!< bytes moved around in memory by compacting and growing, since creation
+    };
+    ReceiveStats GetReceiveStats() const {
+        ReceiveStats ret;
+        ret.buffered = recvBuffer.Pending();
+        ret.capacity = recvBuffer.allocated;
+        ret.peak = recvBuffer.peak;
+        ret.copied = recvBuffer.copied;
+        return ret;
+    }
+
 protected:
 	AbstractWorkSource(const char *name, const CanonicalInfo &algo, std::pair<PoolInfo::DiffMode, PoolInfo::DiffMultipliers> diffDesc, PoolInfo::MerkleMode mm);
 
@@ -124,21 +153,51 @@ protected:
 
 private:
 	/*! Data received by calling Receive(...) is stored here. Then, a pass searches for
-	newline messages and dispatches them to parsers. */
+	newline messages and dispatches them to parsers.
+	Lines are parsed where they are, consuming them only moves 'begin' forward. When everything is consumed the buffer rewinds for free,
+	otherwise the trailing partial line is moved back to the start only when there's not enough room left at the end. Capacity doubles
+	when even that is not sufficient, up to a ceiling: a line longer than that is considered garbage and the connection is failed. */
 	struct RecvBuffer {
 		std::unique_ptr<char[]> data;
 		asizei allocated;
-		asizei used;
+		asizei begin; //!< first byte not consumed yet
+		asizei scanned; //!< bytes before this have been searched for newlines already
+		asizei used; //!< one past the last byte received
+		asizei ceiling;
+		asizei copied; //!< bytes moved by compacting or growing, accumulated over the whole lifetime
+		asizei peak; //!< max amount of pending bytes observed
 		char* NextBytes() const { return data.get() + used; }
 		asizei Remaining() const { return allocated - used; }
-		bool Full() const { return used == allocated; }
-		void Grow() {
-			char *bigger = new char[allocated + 2048];
-			memcpy_s(bigger, allocated + 2048, data.get(), used);
-			data.reset(bigger);
-			allocated += 2048;
+		asizei Pending() const { return used - begin; }
+		/*! Call before receiving. Grants at least a quarter of the buffer to be available by compacting or growing.
+		If compacting does not free at least half the buffer it grows anyway so copies stay proportional to partial lines.
+		\returns false if no more bytes can be received as the ceiling has been reached. */
+		bool MakeRoom() {
+			if(Remaining() >= allocated / 4) return true;
+			if(begin) {
+				const asizei pending = Pending();
+				memmove(data.get(), data.get() + begin, pending);
+				copied += pending;
+				scanned -= begin;
+				used = pending;
+				begin = 0;
+				if(Remaining() >= allocated / 2) return true; // otherwise lines are long WRT capacity and we'd compact often
+			}
+			if(allocated >= ceiling) return Remaining() != 0;
+			const asizei bigger = allocated * 2 < ceiling? allocated * 2 : ceiling;
+			std::unique_ptr<char[]> moved(new char[bigger]);
+			memcpy_s(moved.get(), bigger, data.get(), used);
+			copied += used;
+			data = std::move(moved);
+			allocated = bigger;
+			return true;
+		}
+		void Consumed(asizei upto) {
+			begin = upto;
+			if(begin == used) begin = scanned = used = 0;
 		}
-		RecvBuffer() : used(0), data(new char[4096]), allocated(4096)  {
+		void Clear() { begin = scanned = used = 0; }
+		RecvBuffer() : data(new char[4096]), allocated(4096), begin(0), scanned(0), used(0), ceiling(256 * 1024), copied(0), peak(0) {
 			#if _DEBUG
 				memset(data.get(), 0, 4096);
 			#endif
@@ -147,6 +206,45 @@ private:
 		// Because I really want to be sure of the allocation/deallocation semantics.
 		// Is  it worth it? Probably not.
 	} recvBuffer;
+
+	/*! Lines are parsed in-situ over recvBuffer, so strings are never copied; the values themselves and the parser stack go in
+	fixed chunks living here. The pools are rewound before each line so even mining.notify with long merkle branches goes
+	through without touching the heap. Only messages not fitting the chunks allocate and that memory is released on next line. */
+	struct ParsingState {
+		typedef rapidjson::MemoryPoolAllocator<> Pool;
+		typedef rapidjson::GenericDocument<rapidjson::UTF8<>, Pool, Pool> Document;
+		std::array<char, 16 * 1024> valueChunk;
+		std::array<char, 4 * 1024> stackChunk;
+		ParsingState() : values(valueChunk.data(), valueChunk.size()), stack(stackChunk.data(), stackChunk.size()), json(nullptr) { }
+		~ParsingState() { Drop(); }
+
+		/*! Destroy the previously parsed document, give the chunks back in full and build a new document over them.
+		Pool::Clear releases the extra chunks but does not rewind the user buffer so the pools are built again as well,
+		nothing points to them at that time. */
+		Document& Recycle() {
+			Drop();
+			Rewind(values, valueChunk);
+			Rewind(stack, stackChunk);
+			json = new (&jsonStorage) Document(&values, 1024, &stack);
+			return *json;
+		}
+	private:
+		Pool values, stack;
+		std::aligned_storage<sizeof(Document), alignof(Document)>::type jsonStorage; //!< so a new document does not go through the heap
+		Document *json;
+		ParsingState(const ParsingState&) = delete;
+		ParsingState& operator=(const ParsingState&) = delete;
+
+		void Drop() {
+			if(json) json->~Document();
+			json = nullptr;
+		}
+		template<asizei SZ>
+		static void Rewind(Pool &pool, std::array<char, SZ> &chunk) {
+			pool.~Pool();
+			new (&pool) Pool(chunk.data(), chunk.size());
+		}
+	} parsing;
 	// Iterating on nonces is fully miner's responsability now. We only tell it if it can go on or not.
 	//auint nonce2;
 
@@ -161,6 +259,7 @@ private:
         void SetCoinbase(std::vector<aubyte> &binary, asizei n2off) {
             coinbase = std::move(binary);
             nonceTwoOff = n2off;
+            HashCoinbasePrefix();
         }
         void SetMerkles(const std::vector<btc::MerkleRoot> &merkles, asizei offset) {
             merkleOff = offset;
@@ -208,6 +307,9 @@ private:
     It is, at its core, more or less the same thing: dividing by power-of-two so it keeps being precise on progressive divisions. */
     static std::array<aulong, 4> MakeTargetBits_NeoScrypt(adouble diff, adouble diffOneMul);
 
+    //! Select the correct MakeTargetBits_* for this pool. \param shareDiff stratum difficulty, already multiplied by diffMul.stratum
+    std::array<aulong, 4> MakeTargetBits(adouble shareDiff) const;
+
     void SetStratumCallbacks() {
         stratum->shareResponseCallback =  [this](asizei index, StratumShareResponse status) {
 		    if(this->shareResponseCallback) this->shareResponseCallback(*this, index, status); // I honestly don't like std::bind so much
@@ -218,7 +320,9 @@ private:
     }
 
     bool SendChunk();
-    void ProcessLine(rapidjson::Document &parser, char *pos, asizei len);
+    void ProcessLine(char *pos, asizei len);
+
+    Events BuildWU(Events &ret, const stratum::WorkDiff &prevDiff, const stratum::MiningNotify &prevJob, asizei prevExtranonceChanges) const;
 
-    Events BuildWU(Events &ret, const stratum::WorkDiff &prevDiff, const stratum::MiningNotify &prevJob) const;
+    bool extranonceSubscribe = false;
 };
@@ -19,6 +19,67 @@ void SHA256Based(std::array<aubyte, 32> &storage, const aubyte *msg, const asize
 	return SHA256Based(dst, msg, count);
 }
 
+void MerkleStep(std::array<aubyte, 32> &storage, const std::array<aubyte, 64> &msg) {
+	using hashing::BTCSHA256;
+	std::array<aubyte, 64> block;
+	BTCSHA256 first;
+	first.BlockProcessing(msg.data());
+	memset(block.data(), 0, sizeof(block));
+	block[0] = 0x80;
+	DestinationStream(block.data() + 60, 4)<<auint(64 * 8); // BTCSHA256 only uses 32bit length
+	first.BlockProcessing(block.data());
+
+	BTCSHA256::Digest digest;
+	first.GetHash(digest);
+	memcpy_s(block.data(), sizeof(block), digest.data(), sizeof(digest));
+	block[32] = 0x80;
+	memset(block.data() + 33, 0, 60 - 33);
+	DestinationStream(block.data() + 60, 4)<<auint(32 * 8);
+	BTCSHA256 second;
+	second.BlockProcessing(block.data());
+	DestinationStream dst(storage.data(), sizeof(storage));
+	second.GetHash(dst);
+}
+
+void MerkleSteps(std::array<aubyte, 32> *storage, const std::array<aubyte, 64> *msg, asizei count) {
+	using hashing::BTCSHA256;
+	using hashing::sha256::CompressMulti;
+	BTCSHA256::Digest iv;
+	BTCSHA256().GetHashLE(iv);
+	std::vector<std::array<auint, 8>> state(count);
+	std::vector<const aubyte*> blocks(count);
+	auto restart = [&state, &iv]() {
+		for(auto &el : state) memcpy_s(el.data(), sizeof(el), iv.data(), sizeof(iv));
+	};
+	auto multi = [&state, &blocks]() {
+		CompressMulti(reinterpret_cast<auint(*)[8]>(state.data()), blocks.data(), state.size());
+	};
+	restart();
+	for(asizei i = 0; i < count; i++) blocks[i] = msg[i].data();
+	multi();
+	std::array<aubyte, 64> closing;
+	memset(closing.data(), 0, sizeof(closing));
+	closing[0] = 0x80;
+	DestinationStream(closing.data() + 60, 4)<<auint(64 * 8);
+	for(asizei i = 0; i < count; i++) blocks[i] = closing.data();
+	multi();
+
+	std::vector<std::array<aubyte, 64>> second(count);
+	for(asizei i = 0; i < count; i++) {
+		memset(second[i].data(), 0, sizeof(second[i]));
+		DestinationStream digest(second[i].data(), sizeof(second[i]));
+		digest<<state[i]<<aubyte(0x80);
+		DestinationStream(second[i].data() + 60, 4)<<auint(32 * 8);
+		blocks[i] = second[i].data();
+	}
+	restart();
+	multi();
+	for(asizei i = 0; i < count; i++) {
+		DestinationStream dst(storage[i].data(), sizeof(storage[i]));
+		dst<<state[i];
+	}
+}
+
 aushort ByteSwap(aushort value) { return value >> 8 | ((value & 0x00FF) << 8); }
 auint ByteSwap(auint value) { 
 	auint hi =  ByteSwap(aushort(value & 0x0000FFFF)) << 16;
@@ -32,6 +32,14 @@ void SHA256Based(DestinationStream &storage, const std::array<aubyte, SZ> &msg)
 	return SHA256Based(storage, msg.data(), sizeof(msg));
 }
 
+/*! Same as SHA256Based but specialized for merkle branch steps, which always hash two concatenated 32-byte digests.
+As the message length is fixed, so are the padding blocks: this goes straight to the compression function, 3 times. */
+void MerkleStep(std::array<aubyte, 32> &storage, const std::array<aubyte, 64> &msg);
+
+/*! Batch version of MerkleStep, storage[i] is the result of hashing msg[i]. Goes multi-buffer, use it when there are a lot of
+independant merkle roots to build, such as the same branch applied to many nonce2 values. */
+void MerkleSteps(std::array<aubyte, 32> *storage, const std::array<aubyte, 64> *msg, asizei count);
+
 
 aushort ByteSwap(aushort value);
 auint ByteSwap(auint value);
@@ -0,0 +1,40 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#if defined(_M_AMD64) || defined _M_IX86
+#include <intrin.h>
+#include <immintrin.h>
+
+/*! CPU feature probes for the code selecting SIMD paths at runtime. They are cheap enough but callers usually keep the result
+in a static anyway. x86 only, other architectures have their own ways. */
+namespace cpuid {
+
+inline void Query(int regs[4], int leaf, int subleaf = 0) { __cpuidex(regs, leaf, subleaf); }
+
+
+inline bool HasSSSE3() {
+	int regs[4];
+	Query(regs, 1);
+	return (regs[2] & (1 << 9)) != 0;
+}
+
+
+//! Checks the OS saves YMM registers as well, the CPU supporting AVX2 is not enough.
+inline bool HasAVX2() {
+	int regs[4];
+	Query(regs, 0);
+	if(regs[0] < 7) return false;
+	Query(regs, 1);
+	const bool osxsave = (regs[2] & (1 << 27)) != 0;
+	const bool avx = (regs[2] & (1 << 28)) != 0;
+	if(!osxsave || !avx) return false;
+	if((_xgetbv(0) & 6) != 6) return false;
+	Query(regs, 7);
+	return (regs[1] & (1 << 5)) != 0;
+}
+
+
+}
+#endif
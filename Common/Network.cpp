@@ -15,6 +15,8 @@ asizei NetworkInterface::AbstractDataSocket::Receive(aubyte *storage, asizei buf
 }
 
 
+#if defined(_WIN32)
+
 void WindowsNetwork::SetBlocking(SOCKET socket, bool blocks) {
 	unsigned long state = !blocks; // 0 nonblocking disabled!
 	if(ioctlsocket(socket, FIONBIO, &state)) throw std::exception("Cannot set socket blocking state.");
@@ -131,6 +133,26 @@ WindowsNetwork::WindowsNetwork() {
 
 		errMap = std::move(temp);
 	}
+	wakeup = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(wakeup == INVALID_SOCKET) throw std::exception("Could not create wakeup socket.");
+	sockaddr_in self;
+	int len = sizeof(self);
+	memset(&self, 0, sizeof(self));
+	self.sin_family = AF_INET;
+	self.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(bind(wakeup, reinterpret_cast<sockaddr*>(&self), len) || getsockname(wakeup, reinterpret_cast<sockaddr*>(&self), &len) ||
+	   connect(wakeup, reinterpret_cast<sockaddr*>(&self), len)) {
+		closesocket(wakeup);
+		throw std::exception("Could not bind wakeup socket to loopback.");
+	}
+	SetBlocking(wakeup, false);
+	resolver.completed = [this]() { Wake(); };
+}
+
+
+void WindowsNetwork::Wake() {
+	const char one = 1;
+	send(wakeup, &one, 1, 0); // if it fails the buffer is full, there's a wakeup pending anyway
 }
 
 
@@ -150,6 +172,8 @@ WindowsNetwork::~WindowsNetwork() {
 		delete el->second;
 		servers.erase(el);
 	}
+	resolver.Stop(); // getaddrinfo must not be running after cleanup
+	closesocket(wakeup);
 	WSACleanup();
 }
 
@@ -160,28 +184,15 @@ auto WindowsNetwork::BeginConnection(const char *host, const char *portService)
     ConnectedSocket *nullconn = nullptr;
 	ConnectedSocketInterface *proxy = static_cast<ConnectedSocketInterface*>(newSocket.get());
 	std::unique_ptr<PendingConnection> newConnection(new PendingConnection(newSocket.get()));
-	addrinfo hints;
-	memset(&hints, 0, sizeof(hints));
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = SOCK_STREAM;
-	hints.ai_protocol = IPPROTO_TCP;
-	addrinfo *result = nullptr;
-	ScopedFuncCall blast([result]() { if(result) freeaddrinfo(result); });
-	if(getaddrinfo(host, portService, &hints, &result)) return std::make_pair(nullconn, ce_failedResolve);
-	for(addrinfo *check = result; check; check = check->ai_next) {
-		newConnection->candidates.reserve(newConnection->candidates.size() + 1);
-		SOCKET up = socket(check->ai_family, check->ai_socktype, check->ai_protocol);
-		if(up == INVALID_SOCKET) return std::make_pair(nullconn, ce_badSocket); // I assume this means I'm very low on resources
-		SetBlocking(up, false);
-		if(connect(up, check->ai_addr, int(check->ai_addrlen))) {
-			auto error = GetSocketError();
-			if(error == se_connRefused) continue; // this sometimes happens, for example connecting to "localhost" for some reason resolves to "0.0.0.0", which is invalid.
-			if(GetSocketError() != se_wouldBlock) throw std::exception("Could not start connection procedure for socket.");
-		}
-		// I could just skip this but its' possibly indication of low resources, no point in even starting
-		newConnection->candidates.push_back(up);
+	std::vector<Resolver::Address> addresses;
+	switch(resolver.Resolve(addresses, newSocket->host, newSocket->port)) {
+	case Resolver::s_failed: return std::make_pair(nullconn, ce_failedResolve);
+	case Resolver::s_pending: newConnection->resolving = true; break; // Advance() will pick it up
+	case Resolver::s_resolved: {
+		auto error = StartConnecting(*newConnection, addresses);
+		if(error != ce_ok) return std::make_pair(nullconn, error);
+	}
 	}
-	if(newConnection->candidates.size() == 0) return std::make_pair(nullconn, ce_noRoutes);
 	PendingConnection *pending = newConnection.get();
 	connecting.insert(std::make_pair(proxy, pending));
 	ScopedFuncCall cancelPending([this, proxy]() { connecting.erase(proxy); });
@@ -192,6 +203,81 @@ auto WindowsNetwork::BeginConnection(const char *host, const char *portService)
 }
 
 
+auto WindowsNetwork::StartConnecting(PendingConnection &pending, const std::vector<Resolver::Address> &addresses) -> ConnectionError {
+	pending.untried = addresses;
+	Resolver::Interleave(pending.untried);
+	return StartNext(pending);
+}
+
+
+auto WindowsNetwork::StartNext(PendingConnection &pending) -> ConnectionError {
+	ConnectionError error = ce_noRoutes;
+	while(pending.untried.size()) {
+		const Resolver::Address check(std::move(pending.untried.front()));
+		pending.untried.erase(pending.untried.begin());
+		SOCKET up = socket(check.family, check.socktype, check.protocol);
+		if(up == INVALID_SOCKET) { // I assume this means I'm very low on resources
+			error = ce_badSocket;
+			continue;
+		}
+		SetBlocking(up, false);
+		if(connect(up, reinterpret_cast<const sockaddr*>(check.sockaddr.data()), int(check.sockaddr.size()))) {
+			// Refused sometimes happens, for example connecting to "localhost" for some reason resolves to "0.0.0.0", which is invalid.
+			// Unreachable is common with IPv6 addresses on IPv4-only machines. Either way, it's the next address turn.
+			if(GetSocketError() != se_wouldBlock) {
+				closesocket(up);
+				continue;
+			}
+		}
+		pending.candidates.push_back(up);
+		pending.nextAttempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(connectionAttemptDelayMs);
+		return ce_ok;
+	}
+	return pending.candidates.size()? ce_ok : error;
+}
+
+
+asizei WindowsNetwork::Advance() {
+	const auto now(std::chrono::steady_clock::now());
+	const std::chrono::seconds timeout(connectionTimeoutSeconds);
+	auto until = [&now](std::chrono::steady_clock::time_point when) {
+		return when > now? asizei(std::chrono::duration_cast<std::chrono::milliseconds>(when - now).count() + 1) : asizei(0);
+	};
+	asizei wait = asizei(-1);
+	std::vector<PendingConnection*> failed;
+	for(auto &el : connecting) {
+		PendingConnection &pending(*el.second);
+		ConnectionError error = ce_ok;
+		if(now >= pending.started + timeout) error = pending.resolving? ce_failedResolve : ce_failedConnect;
+		else if(pending.resolving) {
+			std::vector<Resolver::Address> addresses;
+			const Resolver::Status status = resolver.Resolve(addresses, pending.which->host, pending.which->port);
+			switch(status) {
+			case Resolver::s_pending: break; // the resolver will wake us up but the timeout below must still be honored
+			case Resolver::s_failed: error = ce_failedResolve; break;
+			case Resolver::s_resolved: error = StartConnecting(pending, addresses); break;
+			}
+			pending.resolving = status == Resolver::s_pending;
+		}
+		else if(pending.untried.size() && now >= pending.nextAttempt) error = StartNext(pending);
+		if(error != ce_ok) {
+			pending.which->error = error;
+			pending.which->failed = true;
+			failed.push_back(&pending);
+			continue;
+		}
+		if(pending.untried.size()) wait = min(wait, until(pending.nextAttempt));
+		wait = min(wait, until(pending.started + timeout));
+	}
+	for(auto pending : failed) {
+		transitioned.insert(pending->which);
+		connecting.erase(pending->which);
+		delete pending;
+	}
+	return wait;
+}
+
+
 bool WindowsNetwork::CloseConnection(ConnectedSocketInterface &object) {
 	auto el = connections.find(&object);
 	if(el == connections.cend()) return false;
@@ -200,6 +286,7 @@ bool WindowsNetwork::CloseConnection(ConnectedSocketInterface &object) {
 		delete pending->second;
 		connecting.erase(pending);
 	}
+	transitioned.erase(&object);
 	delete el->second;
 	connections.erase(el);
 	return true;
@@ -219,18 +306,27 @@ asizei WindowsNetwork::SleepOn(std::vector<SocketInterface*> &read, std::vector<
 	FD_ZERO(&readReady);
 	FD_ZERO(&writeReady);
 	FD_ZERO(&failures);
+	timeoutms = min(timeoutms, Advance());
+	if(transitioned.size()) timeoutms = 0;
 	SOCKET biggest = max(BiggestSocket(failures, readReady, read), BiggestSocket(failures, writeReady, write));
+	FD_SET(wakeup, &readReady);
+	biggest = max(biggest, wakeup);
 	biggest++; // select needs a +1 to test with strict inequality <
 	timeval timeout;
 	timeout.tv_sec = long(timeoutms / 1000);
 	timeout.tv_usec = (timeoutms % 1000) * 1000;
-	int result = select(int(biggest), &readReady, &writeReady, &failures, &timeout);
-	if(!result) {
+	int result = select(int(biggest), &readReady, &writeReady, &failures, timeoutms == asizei(-1)? nullptr : &timeout);
+	if(result > 0 && FD_ISSET(wakeup, &readReady)) {
+		char drain[64];
+		while(recv(wakeup, drain, sizeof(drain), 0) > 0) { }
+		Advance(); // maybe the resolver woke us up
+	}
+	if(!result && transitioned.empty()) {
         for(auto &el : read) el = nullptr;
         for(auto &el : write) el = nullptr;
         return 0;
     }
-	if(result < 1) throw std::exception("Some error occured while waiting for sockets to connect.");
+	if(result < 0) throw std::exception("Some error occured while waiting for sockets to connect.");
 	asizei awaken = 0;
 	for(auto &socket : read) {
 		if(Activated(failures, socket, readReady) == false) socket = nullptr;
@@ -251,10 +347,19 @@ asizei WindowsNetwork::SleepOn(std::vector<SocketInterface*> &read, std::vector<
 		if(Activated(failures, write[loop], writeReady) == false) write[loop] = nullptr;
 		else awaken++;
 	}
+	transitioned.clear();
 	return awaken;
 }
 
 
+auto WindowsNetwork::GetConnectionError(const ConnectedSocketInterface &socket) const -> ConnectionError {
+	auto el = connections.find(const_cast<ConnectedSocketInterface*>(&socket));
+	if(el == connections.cend()) return ce_ok;
+	if(el->second->failed && el->second->socket == INVALID_SOCKET && el->second->error == ce_ok) return ce_failedConnect;
+	return el->second->error;
+}
+
+
 SockErr WindowsNetwork::GetSocketError() {
 	auto soerr = WSAGetLastError();
 	auto ret = errMap->find(soerr);
@@ -388,6 +493,7 @@ SOCKET WindowsNetwork::BiggestSocket(fd_set &failures, fd_set &set, std::vector<
 
 
 bool WindowsNetwork::Activated(fd_set &failures, SocketInterface *hilevel, const fd_set &search) {
+	if(transitioned.find(hilevel) != transitioned.cend()) return true;
 	auto el = connections.find(hilevel);
 	if(el == connections.cend()) {
 		auto listening = servers.find(hilevel);
@@ -397,6 +503,7 @@ bool WindowsNetwork::Activated(fd_set &failures, SocketInterface *hilevel, const
 		return ret || FD_ISSET(listening->second->socket, &search) != 0;
 	}
 	auto pending = connecting.find(hilevel);
+	if(pending != connecting.cend() && pending->second->resolving) return false;
 	if(pending == connecting.cend()) { // fully connected.
 		bool ret = FD_ISSET(el->second->socket, &failures) != 0;
 		if(ret) el->second->failed = true;
@@ -405,14 +512,17 @@ bool WindowsNetwork::Activated(fd_set &failures, SocketInterface *hilevel, const
 	// if here, connection completed, move it to estabilished connections, but only if an active socket
 	// is really found - we might have been awakened due to timeout or another socket!
 	// We must also take care of the failing possibilities.
+	bool dropped = false;
 	for(asizei loop = 0; loop < pending->second->candidates.size(); loop++) {
 		if(FD_ISSET(pending->second->candidates[loop], &failures)) {
 			closesocket(pending->second->candidates[loop]);
             auto entry(pending->second->candidates.begin() + loop);
 			pending->second->candidates.erase(entry);
             loop--;
+			dropped = true;
 		}
 	}
+	if(dropped) StartNext(*pending->second); // a failed attempt doesn't need to wait the attempt delay
 	if(pending->second->candidates.empty()) { // will never finish connecting
 		delete pending->second;
         connecting.erase(pending);
@@ -430,3 +540,5 @@ bool WindowsNetwork::Activated(fd_set &failures, SocketInterface *hilevel, const
 	}
 	return false;
 }
+
+#endif
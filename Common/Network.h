@@ -9,6 +9,8 @@
 #include <memory>
 #include <map>
 #include <set>
+#include <chrono>
+#include "Resolver.h"
 
 #if defined(_WIN32)
 #include <WinSock2.h>
@@ -124,7 +126,8 @@ operates on its own objects, but there might be good reasons to allow multiple i
 outer code. */
 class NetworkInterface {
 public:
-	static size_t connectionTimeoutSeconds;
+	static size_t connectionTimeoutSeconds; //!< connections still not completed after this long fail, resolution included
+	static size_t connectionAttemptDelayMs; //!< how long to wait for a resolved address before racing the next one, see RFC 8305
 
 	class SocketInterface {
 	public:
@@ -173,7 +176,8 @@ public:
 
 	/*! Notice this function is called BeginConnection, not connect or something.
 	It immediately returns a socket so you can start building objects on top of it but it's very likely the connection
-	procedures will not be completed by the time this returns. It is necessary to use SleepOn putting this in the receiver
+	procedures will not be completed by the time this returns. Host name is resolved without blocking as well: unless the address
+	is cached, resolution failures only show up later, see GetConnectionError. It is necessary to use SleepOn putting this in the receiver
 	queue to figure out when the connection is ready to go - this will also allow the object to transition to a fully
 	working state without requiring thread locks.
 	In other terms, the returned connection is technically a future, but the object isn't so it is returned immediately.
@@ -189,8 +193,9 @@ public:
 	  1a- Special for service sockets: those don't receiva data but rather connection requests to Accept.
 	2- at least 1 socket in the write list has buffer space to allow instant non-blocking send;
 	3- at least one socket completes connection, regardless you placed it in write or read list;
-	3- timeout is exceeded;
-	4- an error in monitored sockets (either send or receive list) is detected.
+	3- timeout is exceeded, asizei(-1) means there's no timeout;
+	4- an error in monitored sockets (either send or receive list) is detected;
+	5- Wake is called.
 	In the last case, the function will throw.
 	If timeout is exceeded, return value is zero.
 	In other cases, the return value is not-zero but due to issues in managing connecting sockets,
@@ -205,8 +210,17 @@ public:
 	would be a bit overkill and might actually not work. */
 	virtual asizei SleepOn(std::vector<SocketInterface*> &read,
 	                       std::vector<SocketInterface*> &write, asizei timeoutms) = 0;
+
+	/*! Thread safe. Makes the current SleepOn return as soon as possible, as if timed out, or the next if no thread is sleeping.
+	This is how other threads tell the main loop they have something to be processed. */
+	virtual void Wake() = 0;
 	virtual SockErr GetSocketError() = 0;
 
+	/*! Host names are resolved asynchronously so BeginConnection can return a socket which later fails without ever connecting.
+	\returns The reason a connection started by BeginConnection(const char*, const char*) failed connecting or ce_ok if it
+	didn't fail that way. */
+	virtual ConnectionError GetConnectionError(const ConnectedSocketInterface &socket) const = 0;
+
 	/*! Creates a "service socket" on the local machine. It's a special "listen" socket used by clients to estabilish
 	new connections to this machine.
 	\param port number of local port to use on this machine. If 0, assigned by system.
@@ -221,6 +235,8 @@ public:
 };
 
 
+#if defined(_WIN32)
+
 class WindowsNetwork : public NetworkInterface {
 private:
 	class ConnectedSocket : public ConnectedSocketInterface {
@@ -229,8 +245,9 @@ private:
 		const std::string port;
 		SOCKET socket;
 		bool failed;
+		ConnectionError error; //!< why connection never completed, if failed while connecting
 		ConnectedSocket(const char *hostname, const char *portOrService)
-			: host(hostname? hostname : ""), port(portOrService? portOrService : ""), socket(INVALID_SOCKET), failed(false) {
+			: host(hostname? hostname : ""), port(portOrService? portOrService : ""), socket(INVALID_SOCKET), failed(false), error(ce_ok) {
 		}
 		~ConnectedSocket() { if(socket != INVALID_SOCKET) closesocket(socket); }
 		std::string PeerHost() const { return host; }
@@ -260,8 +277,11 @@ private:
 
 	struct PendingConnection {
 		ConnectedSocket *which;
-		std::vector<SOCKET> candidates;
-		PendingConnection(ConnectedSocket *resource = nullptr) : which(resource) { }
+		bool resolving; //!< waiting for the resolver, no candidates yet
+		std::vector<SOCKET> candidates; //!< connecting in parallel, first to complete wins
+		std::vector<Resolver::Address> untried; //!< started one at a time, every connectionAttemptDelayMs or when all candidates fail
+		std::chrono::steady_clock::time_point started, nextAttempt;
+		PendingConnection(ConnectedSocket *resource = nullptr) : which(resource), resolving(false), started(std::chrono::steady_clock::now()) { }
 		~PendingConnection() {
 			for(asizei loop = 0; loop < candidates.size(); loop++) {
 				if(which->socket == candidates[loop] || candidates[loop] == INVALID_SOCKET) continue;
@@ -281,6 +301,25 @@ private:
 
 	std::map<SocketInterface*, ServiceSocket*> servers;
 
+	/*! Connections failing resolution or timing out are woken up the next SleepOn, regardless of the list they're in. */
+	Resolver resolver;
+
+	/*! select only works with sockets so Wake sends a datagram to this, connected to itself on loopback.
+	It's always in the read set and drained after waking up. */
+	SOCKET wakeup;
+	std::set<SocketInterface*> transitioned;
+
+	//! Sorts the addresses for racing and starts connecting the first.
+	ConnectionError StartConnecting(PendingConnection &pending, const std::vector<Resolver::Address> &addresses);
+
+	//! Starts connecting the next untried address. Fails only if no candidate is left connecting.
+	ConnectionError StartNext(PendingConnection &pending);
+
+	/*! Polls the resolver for connections still waiting for addresses, starts racing the next candidates when their delay has elapsed
+	and fails the connections taking too long.
+	\returns Milliseconds until the next candidate has to be started or a connection times out, asizei(-1) if nothing pending. */
+	asizei Advance();
+
     SOCKET BiggestSocket(fd_set &failures, fd_set &set, std::vector<SocketInterface*> &monitor) const;
     bool Activated(fd_set &failures, SocketInterface *hilevel, const fd_set &search); //!< Might move connected sockets out of connecting step.
 
@@ -291,7 +330,10 @@ public:
 	bool CloseConnection(ConnectedSocketInterface &object);
 
 	asizei SleepOn(std::vector<SocketInterface*> &read, std::vector<SocketInterface*> &write, asizei timeoutms);
+	void Wake();
 	SockErr GetSocketError();
+	ConnectionError GetConnectionError(const ConnectedSocketInterface &socket) const;
+	Resolver& GetResolver() { return resolver; }
 
 	ServiceSocketInterface& NewServiceSocket(aushort port, aushort numPending);
 	void CloseServiceSocket(ServiceSocketInterface &what);
@@ -300,3 +342,7 @@ public:
 
 
 typedef WindowsNetwork Network;
+
+#else
+#include "PosixNetwork.h" // epoll or kqueue, defines Network
+#endif
@@ -72,6 +72,10 @@ public:
 		}
 		os.WakeupSignal();
 	}
+	void SetCommandWakeup(std::function<void()> fn) {
+		std::unique_lock<std::mutex> lock(mutex);
+		sharedState.commandTriggered = std::move(fn);
+	}
 	/*! If you're not using a menu, this does nothing. Otherwise, it dispatches at least one callback function according to menu callbacks.
 	If multiple menu commands are available (say you slept this thread too long) then they are dispatched in the order of creation.
 	Note I cannot run the callbacks right away as they might call back stuff which is locked so I must use a two-passes approach. */
@@ -57,6 +57,7 @@ struct NotifyIconThreadShare {
 
 	// gui thread -> main
 	bool guiTerminated;
+	std::function<void()> commandTriggered; //!< called by gui thread with no lock held after setting a MenuItem trigger
 
 	explicit NotifyIconThreadShare() : terminate(false), regenMenu(false), updateIcon(false), updateMessage(false), guiTerminated(false), updateCaption(false) { }
     bool NeedsDataChangeWakeup() {
@@ -54,6 +54,31 @@ struct PoolInfo {
     };
     MerkleMode merkleMode;
     DiffMode diffMode;
+    bool extranonceSubscribe = false; //!< send mining.extranonce.subscribe after authorizing
+    enum DiffHint {
+        dh_suggest, //!< send mining.suggest_difficulty, refreshed as hashrate changes
+        dh_password //!< append d=value to password, only updated when connecting
+    };
+    adouble targetShareRate = 0; //!< shares per minute the pool difficulty should give us, 0 to let the pool decide
+    DiffHint diffHint = dh_suggest;
+    asizei recvCeiling = 256 * 1024; //!< max length of a stratum line in bytes, see AbstractWorkSource::SetReceiveCeiling
+
+    //! How the miner spreads devices across pools, see PoolScheduling.
+    struct Scheduling {
+        auint quota = 1; //!< relative amount of hashes to compute for this pool with ps_quota
+        std::vector<auint> devices; //!< linear indices of the devices allowed to mine for this pool, empty for all
+    } scheduling;
+};
+
+
+/*! Each device picks up new work every time its pool produces a new job or withdraws its work. How the next pool is chosen is
+application-wide, devices can end up mining for different pools at the same time. In all cases pools without work and pools not
+listing the device in PoolInfo::Scheduling::devices are skipped. */
+enum PoolScheduling {
+    ps_failover, //!< first pool with work in config order, the others are backups
+    ps_quota, //!< pool getting the least hashes relative to its PoolInfo::Scheduling::quota
+    ps_roundRobin, //!< each device moves to the next pool every time, spreading hashrate evenly
+    ps_lowestReject //!< pool with the lowest ratio of rejected shares
 };
 
 /*! \note This could be better located in AlgoSourcesLoader but it ended here for the lack of a better candidate.
@@ -0,0 +1,513 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "PosixNetwork.h"
+
+#if !defined(_WIN32)
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <algorithm>
+#include <climits>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+
+PosixNetwork::ConnectedSocket::~ConnectedSocket() { if(socket >= 0) close(socket); }
+
+
+PosixNetwork::ServiceSocket::~ServiceSocket() {
+	for(auto fd : backlog) close(fd);
+	if(socket >= 0) close(socket);
+}
+
+
+PosixNetwork::PendingConnection::~PendingConnection() {
+	for(auto fd : candidates) {
+		if(fd != which->socket && fd >= 0) close(fd);
+	}
+}
+
+
+void PosixNetwork::SetBlocking(int socket, bool blocks) {
+	int flags = fcntl(socket, F_GETFL, 0);
+	if(flags < 0) throw std::string("Cannot get socket blocking state.");
+	flags = blocks? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+	if(fcntl(socket, F_SETFL, flags) < 0) throw std::string("Cannot set socket blocking state.");
+}
+
+
+PosixNetwork::PosixNetwork() {
+#if defined(__linux__)
+	poller = epoll_create1(EPOLL_CLOEXEC);
+#else
+	poller = kqueue();
+#endif
+	if(poller < 0) throw std::string("Could not create the socket event queue.");
+	if(pipe(wake)) {
+		close(poller);
+		throw std::string("Could not create the resolver wakeup pipe.");
+	}
+	SetBlocking(wake[0], false);
+	SetBlocking(wake[1], false);
+	Watch(wake[0], nullptr, false);
+	resolver.completed = [this]() { Wake(); };
+}
+
+
+void PosixNetwork::Wake() {
+	const char one = 1;
+	if(write(wake[1], &one, 1) < 0) { } // pipe full, there's a wakeup pending anyway
+}
+
+
+PosixNetwork::~PosixNetwork() {
+	for(auto &el : connecting) delete el.second;
+	for(auto &el : connections) delete el.second;
+	for(auto &el : servers) delete el.second;
+	resolver.Stop();
+	close(wake[0]);
+	close(wake[1]);
+	close(poller);
+}
+
+
+void PosixNetwork::Watch(int fd, SocketInterface *owner, bool writes) {
+#if defined(__linux__)
+	epoll_event ev;
+	ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (writes? uint32_t(EPOLLOUT) : uint32_t(0));
+	ev.data.fd = fd;
+	if(epoll_ctl(poller, EPOLL_CTL_ADD, fd, &ev)) throw std::string("Could not register socket to epoll.");
+#else
+	struct kevent ev[2];
+	EV_SET(ev + 0, fd, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+	EV_SET(ev + 1, fd, EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+	if(kevent(poller, ev, writes? 2 : 1, nullptr, 0, nullptr) < 0) throw std::string("Could not register socket to kqueue.");
+#endif
+	descriptors[fd] = owner;
+}
+
+
+void PosixNetwork::Unwatch(int fd) {
+	// Closing a descriptor removes it from both epoll and kqueue but it's not always closed right away, candidates for example.
+#if defined(__linux__)
+	epoll_event ev;
+	epoll_ctl(poller, EPOLL_CTL_DEL, fd, &ev);
+#else
+	struct kevent ev[2];
+	EV_SET(ev + 0, fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+	EV_SET(ev + 1, fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+	kevent(poller, ev, 2, nullptr, 0, nullptr);
+#endif
+	descriptors.erase(fd);
+}
+
+
+auto PosixNetwork::BeginConnection(const char *host, const char *portService) -> std::pair<ConnectedSocketInterface*, ConnectionError> {
+	std::unique_ptr<ConnectedSocket> newSocket(new ConnectedSocket(host, portService));
+	ConnectedSocket *nullconn = nullptr;
+	ConnectedSocketInterface *proxy = static_cast<ConnectedSocketInterface*>(newSocket.get());
+	std::unique_ptr<PendingConnection> newConnection(new PendingConnection(newSocket.get()));
+	std::vector<Resolver::Address> addresses;
+	switch(resolver.Resolve(addresses, newSocket->host, newSocket->port)) {
+	case Resolver::s_failed: return std::make_pair(nullconn, ce_failedResolve);
+	case Resolver::s_pending: newConnection->resolving = true; break; // Advance() will pick it up
+	case Resolver::s_resolved: {
+		auto error = StartConnecting(*newConnection, addresses);
+		if(error != ce_ok) return std::make_pair(nullconn, error);
+	}
+	}
+	connecting.insert(std::make_pair(proxy, newConnection.release()));
+	connections.insert(std::make_pair(proxy, newSocket.get()));
+	return std::make_pair(newSocket.release(), ce_ok);
+}
+
+
+auto PosixNetwork::StartConnecting(PendingConnection &pending, const std::vector<Resolver::Address> &addresses) -> ConnectionError {
+	pending.untried = addresses;
+	Resolver::Interleave(pending.untried);
+	return StartNext(pending);
+}
+
+
+auto PosixNetwork::StartNext(PendingConnection &pending) -> ConnectionError {
+	ConnectionError error = ce_noRoutes;
+	while(pending.untried.size()) {
+		const Resolver::Address check(std::move(pending.untried.front()));
+		pending.untried.erase(pending.untried.begin());
+		int up = socket(check.family, check.socktype, check.protocol);
+		if(up < 0) { // I assume this means I'm very low on resources
+			lastError = errno;
+			error = ce_badSocket;
+			continue;
+		}
+		SetBlocking(up, false);
+		if(connect(up, reinterpret_cast<const sockaddr*>(check.sockaddr.data()), socklen_t(check.sockaddr.size()))) {
+			lastError = errno;
+			if(errno != EINPROGRESS) { // refused and unreachable are common, for example with IPv6 addresses on IPv4-only machines
+				close(up);
+				continue;
+			}
+		}
+		pending.candidates.push_back(up);
+		Watch(up, pending.which);
+		pending.nextAttempt = std::chrono::steady_clock::now() + std::chrono::milliseconds(connectionAttemptDelayMs);
+		return ce_ok;
+	}
+	return pending.candidates.size()? ce_ok : error;
+}
+
+
+asizei PosixNetwork::Advance() {
+	const auto now(std::chrono::steady_clock::now());
+	const std::chrono::seconds timeout(connectionTimeoutSeconds);
+	auto until = [&now](std::chrono::steady_clock::time_point when) {
+		return when > now? asizei(std::chrono::duration_cast<std::chrono::milliseconds>(when - now).count() + 1) : asizei(0);
+	};
+	asizei wait = asizei(-1);
+	std::vector<PendingConnection*> failed;
+	for(auto &el : connecting) {
+		PendingConnection &pending(*el.second);
+		ConnectionError error = ce_ok;
+		if(now >= pending.started + timeout) error = pending.resolving? ce_failedResolve : ce_failedConnect;
+		else if(pending.resolving) {
+			std::vector<Resolver::Address> addresses;
+			const Resolver::Status status = resolver.Resolve(addresses, pending.which->host, pending.which->port);
+			switch(status) {
+			case Resolver::s_pending: break; // the resolver will wake us up but the timeout below must still be honored
+			case Resolver::s_failed: error = ce_failedResolve; break;
+			case Resolver::s_resolved: error = StartConnecting(pending, addresses); break;
+			}
+			pending.resolving = status == Resolver::s_pending;
+		}
+		else if(pending.untried.size() && now >= pending.nextAttempt) error = StartNext(pending);
+		if(error != ce_ok) {
+			pending.which->error = error;
+			pending.which->failed = true;
+			failed.push_back(&pending);
+			continue;
+		}
+		if(pending.untried.size()) wait = std::min(wait, until(pending.nextAttempt));
+		wait = std::min(wait, until(pending.started + timeout));
+	}
+	for(auto pending : failed) {
+		for(auto fd : pending->candidates) Unwatch(fd);
+		transitioned.insert(pending->which);
+		connecting.erase(pending->which);
+		delete pending;
+	}
+	return wait;
+}
+
+
+bool PosixNetwork::CloseConnection(ConnectedSocketInterface &object) {
+	auto el = connections.find(&object);
+	if(el == connections.cend()) return false;
+	auto pending = connecting.find(&object);
+	if(pending != connecting.cend()) {
+		for(auto fd : pending->second->candidates) Unwatch(fd);
+		delete pending->second;
+		connecting.erase(pending);
+	}
+	if(el->second->socket >= 0) Unwatch(el->second->socket);
+	transitioned.erase(&object);
+	delete el->second;
+	connections.erase(el);
+	return true;
+}
+
+
+asizei PosixNetwork::SleepOn(std::vector<SocketInterface*> &read, std::vector<SocketInterface*> &write, asizei timeoutms) {
+	/* Edges persist in the flags so if anything is already good to go there's no need to sleep, still take the chance to get what's
+	pending from the kernel. */
+	const asizei due = Advance();
+	bool ready = transitioned.size() != 0;
+	for(asizei loop = 0; loop < read.size() && !ready; loop++) ready = Ready(read[loop], false);
+	for(asizei loop = 0; loop < write.size() && !ready; loop++) ready = Ready(write[loop], true);
+	Harvest(ready? 0 : std::min(timeoutms, due));
+	Advance(); // maybe that's what woke us up
+
+	asizei awaken = 0;
+	for(auto &socket : read) {
+		if(Ready(socket, false) || transitioned.find(socket) != transitioned.cend()) awaken++;
+		else socket = nullptr;
+	}
+	for(auto &socket : write) {
+		if(Ready(socket, true) || transitioned.find(socket) != transitioned.cend()) awaken++;
+		else socket = nullptr;
+	}
+	transitioned.clear();
+	return awaken;
+}
+
+
+bool PosixNetwork::Ready(SocketInterface *hilevel, bool write) {
+	auto el = connections.find(hilevel);
+	if(el != connections.cend()) {
+		auto &conn(*el->second);
+		if(conn.socket < 0) return conn.failed; // still connecting
+		if(conn.failed) return true;
+		if(!write && conn.hangup && !conn.readable) {
+			// Nothing more will come and everything has been consumed, only now report the closure.
+			conn.failed = true;
+			return true;
+		}
+		return write? conn.writable : conn.readable;
+	}
+	auto listening = servers.find(hilevel);
+	if(listening != servers.cend()) return listening->second->failed || (!write && listening->second->backlog.size());
+	return false;
+}
+
+
+asizei PosixNetwork::Harvest(asizei timeoutms) {
+	const int MAX_EVENTS = 64;
+	asizei processed = 0;
+#if defined(__linux__)
+	epoll_event ev[MAX_EVENTS];
+	const int wait = timeoutms == asizei(-1)? -1 : int(std::min(timeoutms, asizei(INT_MAX)));
+	int count = epoll_wait(poller, ev, MAX_EVENTS, wait);
+	if(count < 0) {
+		if(errno == EINTR) return 0;
+		throw std::string("Some error occured while waiting for socket events.");
+	}
+	for(int loop = 0; loop < count; loop++) {
+		const auto flags(ev[loop].events);
+		Readiness(ev[loop].data.fd, (flags & EPOLLIN) != 0, (flags & EPOLLOUT) != 0, (flags & (EPOLLRDHUP | EPOLLHUP)) != 0, (flags & EPOLLERR) != 0);
+		processed++;
+	}
+#else
+	struct kevent ev[MAX_EVENTS];
+	timespec timeout;
+	timeout.tv_sec = long(timeoutms / 1000);
+	timeout.tv_nsec = long(timeoutms % 1000) * 1000000;
+	int count = kevent(poller, nullptr, 0, ev, MAX_EVENTS, timeoutms == asizei(-1)? nullptr : &timeout);
+	if(count < 0) {
+		if(errno == EINTR) return 0;
+		throw std::string("Some error occured while waiting for socket events.");
+	}
+	for(int loop = 0; loop < count; loop++) {
+		const bool read = ev[loop].filter == EVFILT_READ, write = ev[loop].filter == EVFILT_WRITE;
+		const bool failed = (ev[loop].flags & EV_ERROR) != 0 || ((ev[loop].flags & EV_EOF) && ev[loop].fflags && write);
+		Readiness(int(ev[loop].ident), read, write, read && (ev[loop].flags & EV_EOF) != 0, failed);
+		processed++;
+	}
+#endif
+	return processed;
+}
+
+
+void PosixNetwork::Readiness(int fd, bool read, bool write, bool hangup, bool failed) {
+	if(fd == wake[0]) {
+		char drain[64];
+		while(::read(fd, drain, sizeof(drain)) > 0) { }
+		return;
+	}
+	auto owner = descriptors.find(fd);
+	if(owner == descriptors.cend()) return; // already closed, events were still queued
+	auto pending = connecting.find(owner->second);
+	if(pending != connecting.cend()) {
+		if(!failed && !write && !hangup) return; // connection completion always comes with writable
+		int error = 0;
+		socklen_t len = sizeof(error);
+		if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) || error) failed = true;
+		Connected(*pending->second, fd, !failed);
+		if(failed) return;
+		// Otherwise it's now a connection like the others, data might have arrived already.
+	}
+	auto conn = connections.find(owner->second);
+	if(conn != connections.cend()) {
+		conn->second->readable |= read;
+		conn->second->writable |= write;
+		conn->second->hangup |= hangup;
+		conn->second->failed |= failed;
+		return;
+	}
+	auto service = servers.find(owner->second);
+	if(service != servers.cend()) {
+		service->second->failed |= failed;
+		while(read) {
+			int client = accept(service->second->socket, NULL, NULL);
+			if(client < 0) {
+				if(errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED && errno != EINTR) service->second->failed = true;
+				if(errno != ECONNABORTED && errno != EINTR) break;
+			}
+			else service->second->backlog.push_back(client);
+		}
+	}
+}
+
+
+void PosixNetwork::Connected(PendingConnection &pending, int fd, bool good) {
+	ConnectedSocket &socket(*pending.which);
+	if(good) {
+		socket.socket = fd;
+		for(auto other : pending.candidates) {
+			if(other != fd) Unwatch(other);
+		}
+	}
+	else {
+		Unwatch(fd);
+		close(fd);
+		pending.candidates.erase(std::find(pending.candidates.begin(), pending.candidates.end(), fd));
+		StartNext(pending); // a failed attempt doesn't need to wait the attempt delay
+		if(pending.candidates.size()) return; // maybe next time
+		socket.failed = true;
+	}
+	transitioned.insert(&socket);
+	delete connecting[&socket];
+	connecting.erase(&socket);
+}
+
+
+asizei PosixNetwork::ConnectedSocket::Send(const abyte *message, asizei count) throw() {
+	ssize_t sent = send(socket, message, count, MSG_NOSIGNAL);
+	if(sent < 0) {
+		if(errno == EAGAIN || errno == EWOULDBLOCK) writable = false;
+		else failed = true;
+		return 0;
+	}
+	if(asizei(sent) < count) writable = false; // next edge will tell us when there's room again
+	return asizei(sent);
+}
+
+
+asizei PosixNetwork::ConnectedSocket::Receive(abyte *storage, asizei count) throw() {
+	ssize_t received = recv(socket, storage, count, 0);
+	if(received < 0) {
+		if(errno == EAGAIN || errno == EWOULDBLOCK) readable = false;
+		else failed = true;
+		return 0;
+	}
+	if(received == 0 && count) { // orderly shutdown, everything consumed
+		readable = false;
+		failed = true;
+	}
+	else if(asizei(received) < count) readable = false;
+	return asizei(received);
+}
+
+
+bool PosixNetwork::ConnectedSocket::GotData() const {
+	int pending = 0;
+	if(ioctl(socket, FIONREAD, &pending)) return false;
+	return pending > 0;
+}
+
+
+auto PosixNetwork::GetConnectionError(const ConnectedSocketInterface &socket) const -> ConnectionError {
+	auto el = connections.find(const_cast<ConnectedSocketInterface*>(&socket));
+	if(el == connections.cend()) return ce_ok;
+	if(el->second->failed && el->second->socket < 0 && el->second->error == ce_ok) return ce_failedConnect;
+	return el->second->error;
+}
+
+
+SockErr PosixNetwork::GetSocketError() {
+	switch(lastError) {
+	case 0: return se_OK;
+	case EBADF: return se_badHandle;
+	case ENOMEM: return se_outtaMemory;
+	case EINTR: return se_interrupted;
+	case EACCES: return se_denied;
+	case EFAULT: return se_badPointer;
+	case EINVAL: return se_badArg;
+	case EMFILE: return se_outtaFiles;
+	case EAGAIN: return se_wouldBlock;
+	case EINPROGRESS: return se_blockingOp;
+	case EALREADY: return se_alreadyPerformed;
+	case ENOTSOCK: return se_notSocket;
+	case EDESTADDRREQ: return se_badDstAddress;
+	case EMSGSIZE: return se_tooLong;
+	case EPROTOTYPE: return se_badProtocol;
+	case ENOPROTOOPT: return se_badProtocolOption;
+	case EPROTONOSUPPORT: return se_unsupportedProtocol;
+	case EOPNOTSUPP: return se_unsupportedOperation;
+	case EAFNOSUPPORT: return se_unsupportedAddress;
+	case EADDRINUSE: return se_usedPort;
+	case EADDRNOTAVAIL: return se_unavailable;
+	case ENETDOWN: return se_netFail;
+	case ENETUNREACH: return se_unreachable;
+	case ENETRESET: return se_connReset;
+	case ECONNABORTED: return se_connAborted;
+	case ECONNRESET: return se_connAbortedRemotely;
+	case ENOBUFS: return se_outtaBuffers;
+	case EISCONN: return se_alreadyConnected;
+	case ENOTCONN: return se_notConnected;
+	case ESHUTDOWN: return se_shutdown;
+	case ETIMEDOUT: return se_timedOut;
+	case ECONNREFUSED: return se_connRefused;
+	case ENAMETOOLONG: return se_nameTooLong;
+	case EHOSTDOWN: return se_remoteDown;
+	case EHOSTUNREACH: return se_unreachableHost;
+	}
+	throw std::string("errno " + std::to_string(lastError) + " is not mapped to a socket error.");
+}
+
+
+void PosixNetwork::CloseServiceSocket(ServiceSocketInterface &what) {
+	auto rem = servers.find(&what);
+	if(rem != servers.end()) {
+		Unwatch(rem->second->socket);
+		delete rem->second;
+		servers.erase(rem);
+	}
+}
+
+
+NetworkInterface::ServiceSocketInterface& PosixNetwork::NewServiceSocket(aushort port, aushort numPending) {
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	hints.ai_flags = AI_PASSIVE;
+	addrinfo *result = nullptr;
+	ScopedFuncCall blast([&result]() { if(result) freeaddrinfo(result); });
+	const std::string number(std::to_string(port));
+	if(getaddrinfo(NULL, port? number.c_str() : NULL, &hints, &result)) throw std::string("getaddrinfo failed.");
+	int listener = -1;
+	ScopedFuncCall clearSocket([&listener]() { if(listener >= 0) close(listener); });
+	listener = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	if(listener < 0) throw std::string("Error creating new Service Socket, creation failed.");
+	const int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)); // otherwise restarting fails for a while
+	SetBlocking(listener, false);
+	if(bind(listener, result->ai_addr, result->ai_addrlen)) throw std::string("Error creating new Service Socket, could not bind.");
+	if(listen(listener, numPending? numPending : SOMAXCONN)) throw std::string("Error creating new Service Socket, could enter listen state.");
+
+	std::unique_ptr<ServiceSocket> add(new ServiceSocket(listener, port));
+	clearSocket.Dont();
+	Watch(listener, add.get());
+	servers.insert(std::make_pair(static_cast<SocketInterface*>(add.get()), add.get()));
+	return *add.release();
+}
+
+
+NetworkInterface::ConnectedSocketInterface& PosixNetwork::BeginConnection(ServiceSocketInterface &listener) {
+	auto real(servers.find(&listener));
+	if(real == servers.cend()) throw std::string("Trying to create a connection from a socket not managed by this object.");
+	auto &backlog(real->second->backlog);
+	if(backlog.empty()) throw std::string("Could not accept an incoming connection, none pending.");
+	int client = backlog.front();
+	backlog.erase(backlog.begin());
+	ScopedFuncCall clearSocket([client]() { close(client); });
+	SetBlocking(client, false);
+	std::unique_ptr<ConnectedSocket> add(new ConnectedSocket(nullptr, nullptr));
+	add->socket = client;
+	Watch(client, add.get());
+	clearSocket.Dont();
+	connections.insert(std::make_pair(static_cast<SocketInterface*>(add.get()), add.get()));
+	return *add.release();
+}
+
+#endif
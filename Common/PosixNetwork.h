@@ -0,0 +1,130 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "Network.h"
+
+#if !defined(_WIN32)
+#include <string>
+
+
+/*! NetworkInterface on top of epoll (Linux) or kqueue (BSD and OSX).
+Every socket is registered to the kernel once, when created, asking for edge-triggered read and write readiness. Edges are collected
+in per-socket flags which are cleared only when Send/Receive hit EAGAIN or a short transfer so SleepOn does not need to rebuild any
+descriptor set: it harvests pending events and then just looks at the flags of the sockets passed.
+Remote closure is reported as a failure only after all the data received has been consumed so no trailing messages are lost,
+there's no need to peek at the socket to tell data from closure.
+Host names are resolved by a Resolver; its threads wake up SleepOn through a pipe when an answer comes, just as any other thread
+calling Wake. */
+class PosixNetwork : public NetworkInterface {
+private:
+	class ConnectedSocket : public ConnectedSocketInterface {
+	public:
+		const std::string host;
+		const std::string port;
+		int socket = -1;
+		bool failed = false;
+		bool readable = false, writable = false; //!< edges collected, data to receive or buffer space to send
+		bool hangup = false; //!< peer won't send anything more, still possible to have data pending
+		ConnectionError error = ce_ok; //!< why connection never completed, if failed while connecting
+		ConnectedSocket(const char *hostname, const char *portOrService)
+			: host(hostname? hostname : ""), port(portOrService? portOrService : "") { }
+		~ConnectedSocket();
+		std::string PeerHost() const { return host; }
+		std::string PeerPort() const { return port; }
+		asizei Send(const abyte *octects, asizei count) throw();
+		asizei Receive(abyte  *octects, asizei buffSize) throw();
+		bool GotData() const;
+		bool CanSend() const { return writable; }
+		bool Works() const { return !failed; }
+	};
+
+	struct ServiceSocket : public ServiceSocketInterface {
+		const aushort port;
+		int socket;
+		bool failed = false;
+		/*! Edges only come once so connection requests are accepted as soon as they are signaled and handed out by
+		BeginConnection(ServiceSocketInterface&) later. */
+		std::vector<int> backlog;
+		ServiceSocket(int s, aushort p) : port(p), socket(s) { }
+		~ServiceSocket();
+		aushort GetPort() const { return port; }
+		bool Works() const { return !failed; }
+	};
+
+	struct PendingConnection {
+		ConnectedSocket *which;
+		bool resolving = false; //!< waiting for the resolver, no candidates yet
+		std::vector<int> candidates; //!< connecting in parallel, first to complete wins
+		std::vector<Resolver::Address> untried; //!< started one at a time, every connectionAttemptDelayMs or when all candidates fail
+		std::chrono::steady_clock::time_point started, nextAttempt;
+		PendingConnection(ConnectedSocket *resource = nullptr) : which(resource), started(std::chrono::steady_clock::now()) { }
+		~PendingConnection();
+		bool operator==(const ConnectedSocket *s) const { return which == s; }
+	};
+
+	std::map<SocketInterface*, ConnectedSocket*> connections;
+	std::map<SocketInterface*, PendingConnection*> connecting;
+	std::map<SocketInterface*, ServiceSocket*> servers;
+
+	//! Kernel events carry the descriptor, this maps it back. Connecting sockets have an entry for each candidate.
+	std::map<int, SocketInterface*> descriptors;
+
+	//! Connecting sockets which completed or failed connection since last SleepOn, they wake up regardless of the list they're in.
+	std::set<SocketInterface*> transitioned;
+
+	int poller; //!< epoll or kqueue descriptor
+	int wake[2]; //!< pipe written by Wake to interrupt the wait, read end is in the poller
+	Resolver resolver;
+	int lastError = 0; //!< errno of the last failed call, for GetSocketError
+
+	void Watch(int fd, SocketInterface *owner, bool writes = true);
+	void Unwatch(int fd);
+
+	/*! Wait for events up to timeoutms, forever if asizei(-1), and update the socket flags.
+	\returns Number of events processed. */
+	asizei Harvest(asizei timeoutms);
+
+	//! \param failed The descriptor signaled an error condition.
+	void Readiness(int fd, bool read, bool write, bool hangup, bool failed);
+
+	//! Sorts the addresses for racing and starts connecting the first.
+	ConnectionError StartConnecting(PendingConnection &pending, const std::vector<Resolver::Address> &addresses);
+
+	//! Starts connecting the next untried address. Fails only if no candidate is left connecting.
+	ConnectionError StartNext(PendingConnection &pending);
+
+	/*! Polls the resolver for connections still waiting for addresses, starts racing the next candidates when their delay has elapsed
+	and fails the connections taking too long.
+	\returns Milliseconds until the next candidate has to be started or a connection times out, asizei(-1) if nothing pending. */
+	asizei Advance();
+
+	//! Connection of a candidate completed or failed, select a winner, try the next address or give up.
+	void Connected(PendingConnection &pending, int fd, bool good);
+
+	bool Ready(SocketInterface *hilevel, bool write);
+
+	static void SetBlocking(int socket, bool blocks);
+
+public:
+	PosixNetwork();
+	~PosixNetwork();
+	std::pair<ConnectedSocketInterface*, ConnectionError> BeginConnection(const char *host, const char *portService);
+	bool CloseConnection(ConnectedSocketInterface &object);
+
+	asizei SleepOn(std::vector<SocketInterface*> &read, std::vector<SocketInterface*> &write, asizei timeoutms);
+	void Wake();
+	SockErr GetSocketError();
+	ConnectionError GetConnectionError(const ConnectedSocketInterface &socket) const;
+	Resolver& GetResolver() { return resolver; }
+
+	ServiceSocketInterface& NewServiceSocket(aushort port, aushort numPending);
+	void CloseServiceSocket(ServiceSocketInterface &what);
+	ConnectedSocketInterface& BeginConnection(ServiceSocketInterface &listener);
+};
+
+
+typedef PosixNetwork Network;
+
+#endif
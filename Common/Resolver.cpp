@@ -0,0 +1,140 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "Resolver.h"
+#include "AREN/ScopedFuncCall.h"
+#include <string.h>
+
+#if defined(_WIN32)
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#endif
+
+
+Resolver::Resolver(asizei workers) : maxWorkers(workers? workers : 1), lookup(SystemLookup) {
+}
+
+
+void Resolver::Stop() {
+	{
+		std::unique_lock<std::mutex> lock(guard);
+		quit = true;
+		queue.clear();
+	}
+	wakeup.notify_all();
+	for(auto &worker : workers) worker.join(); // a lookup in progress still has to time out, nothing to do about it
+	workers.clear();
+}
+
+
+void Resolver::SetLookup(Lookup fn) {
+	std::unique_lock<std::mutex> lock(guard);
+	lookup = fn? fn : Lookup(SystemLookup);
+	generation++;
+	cache.clear();
+}
+
+
+bool Resolver::Busy() const {
+	std::unique_lock<std::mutex> lock(guard);
+	return waiting.size() != 0;
+}
+
+
+auto Resolver::Resolve(std::vector<Address> &result, const std::string &host, const std::string &port) -> Status {
+	const Key key(host, port);
+	std::unique_lock<std::mutex> lock(guard);
+	auto hit = cache.find(key);
+	if(hit != cache.cend()) {
+		if(std::chrono::steady_clock::now() < hit->second.expire) {
+			if(hit->second.answer.good == false) return s_failed;
+			result = hit->second.answer.addresses;
+			return s_resolved;
+		}
+		cache.erase(hit);
+	}
+	if(quit) return s_failed;
+	if(waiting.insert(key).second == false) return s_pending;
+	queue.push_back(key);
+	if(idle < queue.size() && workers.size() < maxWorkers) workers.push_back(std::thread([this]() { Work(); }));
+	wakeup.notify_one();
+	return s_pending;
+}
+
+
+void Resolver::Work() {
+	std::unique_lock<std::mutex> lock(guard);
+	while(true) {
+		idle++;
+		wakeup.wait(lock, [this]() { return quit || queue.size(); });
+		idle--;
+		if(quit) return;
+		const Key key(queue.front());
+		queue.pop_front();
+		const Lookup fn(lookup);
+		const asizei started = generation;
+		Answer answer;
+		answer.ttl = defaultTTL;
+		lock.unlock();
+		try {
+			fn(answer, key.first, key.second);
+		} catch(...) {
+			answer.good = false; // a stub throwing, most likely. Nothing to report it to.
+		}
+		lock.lock();
+		waiting.erase(key);
+		if(started != generation) continue; // SetLookup called meanwhile, next Resolve will ask again
+		if(answer.good == false || answer.addresses.empty()) {
+			answer.good = false;
+			answer.ttl = negativeTTL;
+		}
+		Entry &entry(cache[key]);
+		entry.expire = std::chrono::steady_clock::now() + std::chrono::seconds(answer.ttl);
+		entry.answer = std::move(answer);
+		auto notify(completed);
+		lock.unlock();
+		if(notify) notify();
+		lock.lock();
+	}
+}
+
+
+void Resolver::Interleave(std::vector<Address> &list) {
+	if(list.empty()) return;
+	const int first = list[0].family;
+	std::vector<Address> preferred, other;
+	for(auto &el : list) (el.family == first? preferred : other).push_back(std::move(el));
+	list.clear();
+	for(asizei loop = 0; loop < preferred.size() || loop < other.size(); loop++) {
+		if(loop < preferred.size()) list.push_back(std::move(preferred[loop]));
+		if(loop < other.size()) list.push_back(std::move(other[loop]));
+	}
+}
+
+
+void Resolver::SystemLookup(Answer &result, const std::string &host, const std::string &port) {
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	addrinfo *list = nullptr;
+	ScopedFuncCall blast([&list]() { if(list) freeaddrinfo(list); });
+	if(getaddrinfo(host.c_str(), port.c_str(), &hints, &list)) return;
+	for(addrinfo *check = list; check; check = check->ai_next) {
+		Address add;
+		add.family = check->ai_family;
+		add.socktype = check->ai_socktype;
+		add.protocol = check->ai_protocol;
+		const aubyte *raw = reinterpret_cast<const aubyte*>(check->ai_addr);
+		add.sockaddr.assign(raw, raw + check->ai_addrlen);
+		result.addresses.push_back(std::move(add));
+	}
+	result.good = true;
+}
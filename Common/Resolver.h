@@ -0,0 +1,95 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "AREN/ArenDataTypes.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+/*! Host name resolution without stalling the caller. getaddrinfo blocks for as long as the system resolver wants, which can be seconds
+when DNS is slow or unreachable. Lookups are therefore carried out by a few worker threads while the caller keeps polling Resolve.
+Answers are cached for their TTL so reconnecting to a pool doesn't go through DNS again.
+The lookup function can be replaced, for example by a stub answering from a table to test connection logic without a real DNS. */
+class Resolver {
+public:
+	struct Address {
+		int family = 0, socktype = 0, protocol = 0;
+		std::vector<aubyte> sockaddr; //!< sockaddr_in or sockaddr_in6, raw bytes to be passed to connect
+	};
+
+	struct Answer {
+		bool good = false; //!< false if host could not be resolved, addresses are then ignored
+		std::vector<Address> addresses;
+		asizei ttl; //!< seconds, lookup functions can change it. Initialized to the resolver default.
+	};
+
+	/*! Called on a worker thread, must be thread safe. Default is getaddrinfo, which does not tell the record TTL so it gets
+	the default value. */
+	typedef std::function<void(Answer &result, const std::string &host, const std::string &port)> Lookup;
+
+	enum Status {
+		s_resolved, //!< result has been filled with addresses
+		s_pending, //!< lookup queued or in progress, try again later
+		s_failed //!< no addresses for this name, negative answers are also cached but for a much shorter time
+	};
+
+	explicit Resolver(asizei workers = 4);
+	~Resolver() { Stop(); }
+
+	/*! Drops queued lookups and waits for those in progress to complete. Call this before destroying whatever completed uses.
+	Resolve will not work anymore. */
+	void Stop();
+
+	/*! Replaces the lookup function. Cache is flushed and answers from lookups still in progress are discarded.
+	\param fn If empty, restores getaddrinfo. */
+	void SetLookup(Lookup fn);
+	void SetDefaultTTL(asizei seconds) { std::unique_lock<std::mutex> lock(guard); defaultTTL = seconds; }
+	void SetNegativeTTL(asizei seconds) { std::unique_lock<std::mutex> lock(guard); negativeTTL = seconds; }
+
+	/*! Non-blocking. If the name is in cache and not expired, gets it in result. Otherwise queues a lookup for it, if not already
+	queued and returns s_pending. */
+	Status Resolve(std::vector<Address> &result, const std::string &host, const std::string &port);
+
+	/*! Called on the worker thread after a lookup has completed and its answer is in cache so the thread calling Resolve
+	can be woken up. Set this before the first Resolve call. */
+	std::function<void()> completed;
+
+	/*! Happy eyeballs order (RFC 8305): alternates address families starting with the family of the first address, order within
+	each family is preserved. A broken IPv6 or IPv4 route then costs at most a connection attempt delay. */
+	static void Interleave(std::vector<Address> &list);
+
+	//! True if there are lookups queued or in progress. Useful to limit sleep time when there's no way to wake up the waiting thread.
+	bool Busy() const;
+
+private:
+	typedef std::pair<std::string, std::string> Key; //!< host, port
+	struct Entry {
+		Answer answer;
+		std::chrono::steady_clock::time_point expire;
+	};
+	std::map<Key, Entry> cache;
+	std::deque<Key> queue;
+	std::set<Key> waiting; //!< queued or being looked up, so the same name is not asked twice
+	asizei idle = 0;
+	const asizei maxWorkers;
+	std::vector<std::thread> workers;
+	bool quit = false;
+	Lookup lookup;
+	asizei generation = 0; //!< incremented by SetLookup, answers from older lookup functions are dropped
+	asizei defaultTTL = 300, negativeTTL = 15;
+	mutable std::mutex guard;
+	std::condition_variable wakeup;
+
+	void Work();
+	static void SystemLookup(Answer &result, const std::string &host, const std::string &port);
+};
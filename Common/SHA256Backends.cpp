@@ -0,0 +1,289 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "SHA256Backends.h"
+#include "AREN/SerializationBuffers.h"
+#include "CPUID.h"
+#include <stdlib.h>
+#if defined _M_ARM64
+#include <Windows.h>
+#include <arm64_neon.h>
+#endif
+
+namespace hashing {
+namespace sha256 {
+
+
+const auint* RoundConstants() {
+	static const auint K[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+	return K;
+}
+
+
+void CompressGeneric(auint state[8], const aubyte *block) {
+	auto SigmaO = [](auint v) { return _rotr(v,  7) ^ _rotr(v, 18) ^    (v >>  3); };
+	auto SigmaI = [](auint v) { return _rotr(v, 17) ^ _rotr(v, 19) ^    (v >> 10); };
+	auto SumO =   [](auint v) { return _rotr(v,  2) ^ _rotr(v, 13) ^ _rotr(v, 22); };
+	auto SumI =   [](auint v) { return _rotr(v,  6) ^ _rotr(v, 11) ^ _rotr(v, 25); };
+	auto Ch =  [](auint x, auint y, auint z) { return (x & y) ^ (~x & z); };
+	auto Maj = [](auint x, auint y, auint z) { return (x & y) ^ ( x & z) ^ (y & z); };
+	const auint *K = RoundConstants();
+	auint w[64];
+	const auint *cbytes = reinterpret_cast<const auint*>(block);
+	for(size_t cp = 0; cp < 16; cp++) w[cp] = HTON(cbytes[cp]);
+	for(size_t cp = 16; cp < 64; cp++) {
+		auint so = SigmaO(w[cp - 15]);
+		auint si = SigmaI(w[cp -  2]);
+		w[cp] = w[cp - 16] + so + w[cp - 7] + si;
+	}
+	auint a = state[0],  b  = state[1];
+	auint c = state[2],  d  = state[3];
+	auint e = state[4],  f  = state[5];
+	auint g = state[6],  hp = state[7];
+	for(size_t inner = 0; inner < 64; inner++) {
+		auint t1 = hp + SumI(e) + Ch(e, f, g) + K[inner] + w[inner];
+		auint t2 = SumO(a) + Maj(a, b, c);
+		hp = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+	state[0] += a;  state[1] += b;
+	state[2] += c;  state[3] += d;
+	state[4] += e;  state[5] += f;
+	state[6] += g;  state[7] += hp;
+}
+
+
+#if defined(_M_AMD64) || defined _M_IX86
+
+bool HasSHANI() {
+	int regs[4];
+	cpuid::Query(regs, 0);
+	if(regs[0] < 7) return false;
+	cpuid::Query(regs, 7);
+	const bool sha = (regs[1] & (1 << 29)) != 0;
+	cpuid::Query(regs, 1);
+	const bool sse41 = (regs[2] & (1 << 19)) != 0; // for blend, always there in practice
+	return sha && sse41;
+}
+
+
+bool HasARMv8() { return false; }
+
+
+void CompressSHANI(auint state[8], const aubyte *block) {
+	const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull); // byte swap each uint
+	const auint *K = RoundConstants();
+	__m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+	__m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+	tmp = _mm_shuffle_epi32(tmp, 0xB1); // CDAB
+	state1 = _mm_shuffle_epi32(state1, 0x1B); // EFGH
+	__m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0); // CDGH
+	const __m128i abefStart = state0, cdghStart = state1;
+
+	__m128i msg[4];
+	for(asizei load = 0; load < 4; load++) {
+		msg[load] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + load * 16));
+		msg[load] = _mm_shuffle_epi8(msg[load], MASK);
+	}
+	for(asizei quad = 0; quad < 16; quad++) { // 4 rounds each
+		const __m128i current = msg[quad % 4];
+		__m128i wk = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i*>(K + quad * 4)));
+		state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+		wk = _mm_shuffle_epi32(wk, 0x0E);
+		state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+		if(quad >= 12) continue;
+		// w[t..t+3] from w[t-16..t-13], w[t-12..t-9], w[t-8..t-5], w[t-4..t-1]
+		const __m128i &next(msg[(quad + 1) % 4]), &far(msg[(quad + 2) % 4]), &last(msg[(quad + 3) % 4]);
+		__m128i build = _mm_sha256msg1_epu32(current, next);
+		build = _mm_add_epi32(build, _mm_alignr_epi8(last, far, 4));
+		msg[quad % 4] = _mm_sha256msg2_epu32(build, last);
+	}
+	state0 = _mm_add_epi32(state0, abefStart);
+	state1 = _mm_add_epi32(state1, cdghStart);
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B); // FEBA
+	state1 = _mm_shuffle_epi32(state1, 0xB1); // DCHG
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+	state1 = _mm_alignr_epi8(state1, tmp, 8); // ABEF
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+
+void CompressARMv8(auint state[8], const aubyte *block) { CompressGeneric(state, block); }
+
+
+/*! Multi-buffer SHA256 is the plain algorithm with each uint being a vector of lanes, each lane an independant message.
+The operations needed are very few so they're wrapped in those small structures and the rounds are written only once. */
+struct SSE2Lanes {
+	typedef __m128i V;
+	static const asizei count = 4;
+	static V Load(const auint *src) { return _mm_loadu_si128(reinterpret_cast<const V*>(src)); }
+	static void Store(auint *dst, V v) { _mm_storeu_si128(reinterpret_cast<V*>(dst), v); }
+	static V Set1(auint v) { return _mm_set1_epi32(int(v)); }
+	static V Add(V a, V b) { return _mm_add_epi32(a, b); }
+	static V Xor(V a, V b) { return _mm_xor_si128(a, b); }
+	static V And(V a, V b) { return _mm_and_si128(a, b); }
+	static V AndNot(V a, V b) { return _mm_andnot_si128(a, b); } // ~a & b
+	static V Shr(V a, int n) { return _mm_srli_epi32(a, n); }
+	static V Rotr(V a, int n) { return _mm_or_si128(_mm_srli_epi32(a, n), _mm_slli_epi32(a, 32 - n)); }
+};
+
+
+struct AVX2Lanes {
+	typedef __m256i V;
+	static const asizei count = 8;
+	static V Load(const auint *src) { return _mm256_loadu_si256(reinterpret_cast<const V*>(src)); }
+	static void Store(auint *dst, V v) { _mm256_storeu_si256(reinterpret_cast<V*>(dst), v); }
+	static V Set1(auint v) { return _mm256_set1_epi32(int(v)); }
+	static V Add(V a, V b) { return _mm256_add_epi32(a, b); }
+	static V Xor(V a, V b) { return _mm256_xor_si256(a, b); }
+	static V And(V a, V b) { return _mm256_and_si256(a, b); }
+	static V AndNot(V a, V b) { return _mm256_andnot_si256(a, b); }
+	static V Shr(V a, int n) { return _mm256_srli_epi32(a, n); }
+	static V Rotr(V a, int n) { return _mm256_or_si256(_mm256_srli_epi32(a, n), _mm256_slli_epi32(a, 32 - n)); }
+};
+
+
+template<typename L>
+static void CompressLanes(auint (*state)[8], const aubyte * const *blocks) {
+	typedef typename L::V V;
+	const auint *K = RoundConstants();
+	auint transpose[L::count];
+	auto gather = [&transpose](const auint *lane[L::count], asizei index) {
+		for(asizei l = 0; l < L::count; l++) transpose[l] = HTON(lane[l][index]);
+		return L::Load(transpose);
+	};
+	const auint *words[L::count];
+	for(asizei l = 0; l < L::count; l++) words[l] = reinterpret_cast<const auint*>(blocks[l]);
+	V w[64];
+	for(asizei cp = 0; cp < 16; cp++) w[cp] = gather(words, cp);
+	for(asizei cp = 16; cp < 64; cp++) {
+		const V so = L::Xor(L::Xor(L::Rotr(w[cp - 15],  7), L::Rotr(w[cp - 15], 18)), L::Shr(w[cp - 15],  3));
+		const V si = L::Xor(L::Xor(L::Rotr(w[cp -  2], 17), L::Rotr(w[cp -  2], 19)), L::Shr(w[cp -  2], 10));
+		w[cp] = L::Add(L::Add(w[cp - 16], so), L::Add(w[cp - 7], si));
+	}
+	V start[8];
+	for(asizei i = 0; i < 8; i++) {
+		for(asizei l = 0; l < L::count; l++) transpose[l] = state[l][i];
+		start[i] = L::Load(transpose);
+	}
+	V a = start[0], b = start[1], c = start[2], d = start[3];
+	V e = start[4], f = start[5], g = start[6], hp = start[7];
+	for(asizei inner = 0; inner < 64; inner++) {
+		const V sumI = L::Xor(L::Xor(L::Rotr(e, 6), L::Rotr(e, 11)), L::Rotr(e, 25));
+		const V ch = L::Xor(L::And(e, f), L::AndNot(e, g));
+		const V t1 = L::Add(L::Add(L::Add(hp, sumI), L::Add(ch, L::Set1(K[inner]))), w[inner]);
+		const V sumO = L::Xor(L::Xor(L::Rotr(a, 2), L::Rotr(a, 13)), L::Rotr(a, 22));
+		const V maj = L::Xor(L::Xor(L::And(a, b), L::And(a, c)), L::And(b, c));
+		const V t2 = L::Add(sumO, maj);
+		hp = g;
+		g = f;
+		f = e;
+		e = L::Add(d, t1);
+		d = c;
+		c = b;
+		b = a;
+		a = L::Add(t1, t2);
+	}
+	const V result[8] = { a, b, c, d, e, f, g, hp };
+	for(asizei i = 0; i < 8; i++) {
+		L::Store(transpose, L::Add(start[i], result[i]));
+		for(asizei l = 0; l < L::count; l++) state[l][i] = transpose[l];
+	}
+}
+
+
+asizei GetLaneCount() {
+	static const asizei lanes = cpuid::HasAVX2()? AVX2Lanes::count : SSE2Lanes::count;
+	return lanes;
+}
+
+
+void CompressMulti(auint (*state)[8], const aubyte * const *blocks, asizei count) {
+	const asizei lanes = GetLaneCount();
+	while(count >= lanes) {
+		if(lanes == AVX2Lanes::count) CompressLanes<AVX2Lanes>(state, blocks);
+		else CompressLanes<SSE2Lanes>(state, blocks);
+		state += lanes;
+		blocks += lanes;
+		count -= lanes;
+	}
+	if(count >= SSE2Lanes::count) {
+		CompressLanes<SSE2Lanes>(state, blocks);
+		state += SSE2Lanes::count;
+		blocks += SSE2Lanes::count;
+		count -= SSE2Lanes::count;
+	}
+	const Compressor single = Select();
+	for(asizei loop = 0; loop < count; loop++) single(state[loop], blocks[loop]);
+}
+
+
+#elif defined _M_ARM64
+
+bool HasSHANI() { return false; }
+bool HasARMv8() { return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0; }
+
+void CompressSHANI(auint state[8], const aubyte *block) { CompressGeneric(state, block); }
+
+
+void CompressARMv8(auint state[8], const aubyte *block) {
+	const auint *K = RoundConstants();
+	uint32x4_t state0 = vld1q_u32(state);
+	uint32x4_t state1 = vld1q_u32(state + 4);
+	const uint32x4_t abcdStart = state0, efghStart = state1;
+	uint32x4_t msg[4];
+	for(asizei load = 0; load < 4; load++) msg[load] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(block + load * 16)));
+	for(asizei quad = 0; quad < 16; quad++) {
+		const uint32x4_t wk = vaddq_u32(msg[quad % 4], vld1q_u32(K + quad * 4));
+		const uint32x4_t prev = state0;
+		state0 = vsha256hq_u32(state0, state1, wk);
+		state1 = vsha256h2q_u32(state1, prev, wk);
+		if(quad >= 12) continue;
+		const uint32x4_t build = vsha256su0q_u32(msg[quad % 4], msg[(quad + 1) % 4]);
+		msg[quad % 4] = vsha256su1q_u32(build, msg[(quad + 2) % 4], msg[(quad + 3) % 4]);
+	}
+	vst1q_u32(state, vaddq_u32(state0, abcdStart));
+	vst1q_u32(state + 4, vaddq_u32(state1, efghStart));
+}
+
+
+asizei GetLaneCount() { return 1; }
+
+
+void CompressMulti(auint (*state)[8], const aubyte * const *blocks, asizei count) {
+	const Compressor single = Select(); // crypto extensions are faster than NEON multi-buffer anyway
+	for(asizei loop = 0; loop < count; loop++) single(state[loop], blocks[loop]);
+}
+
+#else
+#error SHA256 backends need some care
+#endif
+
+
+Compressor Select() {
+	static const Compressor chosen = HasSHANI()? CompressSHANI : (HasARMv8()? CompressARMv8 : CompressGeneric);
+	return chosen;
+}
+
+
+}
+}
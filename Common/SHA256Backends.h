@@ -0,0 +1,39 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "AREN/ArenDataTypes.h"
+
+/*! SHA256 compression functions. The hashing classes only care about mangling a 64-byte block into an 8-uint state, how this happens
+depends on the CPU running the program. This is selected at runtime, the first time a SHA256 block is processed.
+State is always in "natural" order (h[0] = a ... h[7] = h), blocks are always big endian words as mandated by the standard. */
+namespace hashing {
+namespace sha256 {
+
+typedef void (*Compressor)(auint state[8], const aubyte *block);
+
+const auint* RoundConstants(); //!< the 64 K values
+
+void CompressGeneric(auint state[8], const aubyte *block); //!< plain C++, always available
+void CompressSHANI(auint state[8], const aubyte *block); //!< Intel SHA extensions, only call if HasSHANI
+void CompressARMv8(auint state[8], const aubyte *block); //!< ARMv8 crypto extensions, only call if HasARMv8
+
+bool HasSHANI();
+bool HasARMv8();
+
+//! Best single-buffer compressor for this CPU.
+Compressor Select();
+
+
+/*! Multi-buffer compression: each lane has its own state and its own block. Useful when there are a lot of independant small messages to
+hash, such as merkle roots for many nonce2 values. Lanes are processed in groups of 8 (AVX2) or 4 (SSE2), what's left goes to Select().
+\param state Array of count states.
+\param blocks Array of count pointers to blocks, one for each state. */
+void CompressMulti(auint (*state)[8], const aubyte * const *blocks, asizei count);
+
+//! How many blocks CompressMulti can mangle at once on this CPU.
+asizei GetLaneCount();
+
+}
+}
@@ -7,7 +7,11 @@
 1- Effective work block headers
 2- Difficulty adjustments. */
 #include <array>
+#include <vector>
+#include <functional>
 #include "../AREN/ArenDataTypes.h"
+#include "../hashing.h"
+#include "../BTC/Funcs.h"
 
 
 namespace stratum {
@@ -39,10 +43,15 @@ struct Work {
 This was a bit unconvenient as work units have to be produced miner-side on need for "nonce2 rolling".
 There is also the need to provide an easy way to do "ntime rolling" in the future. For the time being, this is not there, ntime is embedded in the basic
 header as soon as notify is received so I'll have to think at this in more detail.
-So, WorkSources will now generate factory objects whose goal is to build an header to hash. */
+So, WorkSources will now generate factory objects whose goal is to build an header to hash.
+
+Only nonce2 changes across headers generated by the same factory. The coinbase blocks before nonce2 are hashed once and their SHA256 state is
+kept around so each header only costs the coinbase tail blocks and the merkle branch steps. */
 class AbstractWorkFactory {
 public:
-    typedef std::function<void(std::array<aubyte, 32> &merkleOut, const std::vector<aubyte> &coinbase)> CBHashFunc;
+    /*! Called after nonce2 is slapped in coinbase to produce the initial merkle root. The coinbase blocks not depending on nonce2 have been
+    hashed already, their state is prefix. Only the tail is left to hash. */
+    typedef std::function<void(std::array<aubyte, 32> &merkleOut, const hashing::BTCSHA256 &prefix, const aubyte *tail, asizei count)> CBHashFunc;
     AbstractWorkFactory(bool restartWork, auint networkTime, const CBHashFunc cbmode, const std::string &poolJob)
         : ntime(networkTime), initialMerkle(cbmode), job(poolJob), restart(restartWork) { }
     virtual ~AbstractWorkFactory() { }
@@ -53,47 +62,59 @@ public:
 
     Work MakeNoncedHeader(bool littleEndianAlgo, aulong algoDiffNumerator) {
         Work result;
-        const asizei rem = coinbase.size() - nonceTwoOff;
-        const auint nonce2BE = HTON(nonce2);
-	    memcpy_s(coinbase.data() + nonceTwoOff, rem, &nonce2BE, sizeof(nonce2BE));
-        result.nonce2 = nonce2++;
-        result.ntime = ntime;
-        result.job = job;
-		std::array<aubyte, 32> merkleRoot;
-		initialMerkle(merkleRoot, coinbase);
-		std::array<aubyte, 64> merkleSHA;
-		std::copy(merkleRoot.cbegin(), merkleRoot.cend(), merkleSHA.begin());
-		for(asizei loop = 0; loop < merkles.size(); loop++) {
-			auto &sign(merkles[loop]);
-			std::copy(sign.cbegin(), sign.cend(), merkleSHA.begin() + 32);
-			btc::SHA256Based(DestinationStream(merkleRoot.data(), sizeof(merkleRoot)), merkleSHA);
-			std::copy(merkleRoot.cbegin(), merkleRoot.cend(), merkleSHA.begin());
-		}
-		// vvv I tried to do that using std::copy, but I hate it.
-		if(littleEndianAlgo) memcpy_s(merkleRoot.data(), sizeof(merkleRoot), merkleSHA.data(), sizeof(merkleRoot));
-		else btc::FlipIntegerBytes<8>(merkleRoot.data(), merkleSHA.data()); // most of the time
-
-        result.header = blankHeader;
-		aubyte *raw = result.header.data() + merkleOff;
-		memcpy_s(raw, 128 - merkleOff, merkleRoot.data(), sizeof(merkleRoot));
-
-		if(littleEndianAlgo) { // the structure is the same but several bytes must be flipped.
-			raw = result.header.data();
-			for(auint shuffle = 0; shuffle < merkleOff; shuffle += 4) {
-				aubyte load[4];
-				for(auint i = 0; i < 4; i++) load[i] = raw[shuffle + i];
-				for(auint i = 0; i < 4; i++) raw[shuffle + 3 - i] = load[i];
-			}
-			// merkle is already in the right layout
-			// nbits, ntime
-			for(auint shuffle = 68; shuffle < 76; shuffle += 4) {
-				aubyte load[4];
-				for(auint i = 0; i < 4; i++) load[i] = raw[shuffle + i];
-				for(auint i = 0; i < 4; i++) raw[shuffle + 3 - i] = load[i];
-			}
-		}
+        MakeNoncedHeaders(&result, 1, littleEndianAlgo, algoDiffNumerator);
         return result;
-	}
+    }
+
+    /*! Same as calling MakeNoncedHeader count times, dst[i] gets the i-th nonce2 value.
+    The merkle branch is applied to all the headers at once, each step goes multi-buffer with btc::MerkleSteps. */
+    void MakeNoncedHeaders(Work *dst, asizei count, bool littleEndianAlgo, aulong algoDiffNumerator) {
+        std::vector<std::array<aubyte, 32>> merkleRoot(count);
+        std::vector<std::array<aubyte, 64>> merkleSHA(count);
+        const asizei rem = coinbase.size() - nonceTwoOff;
+        for(asizei loop = 0; loop < count; loop++) {
+            Work &result(dst[loop]);
+            const auint nonce2BE = HTON(nonce2);
+            memcpy_s(coinbase.data() + nonceTwoOff, rem, &nonce2BE, sizeof(nonce2BE));
+            result.nonce2 = nonce2++;
+            result.ntime = ntime;
+            result.job = job;
+            initialMerkle(merkleRoot[loop], prefix, coinbase.data() + prefixBytes, coinbase.size() - prefixBytes);
+        }
+        for(asizei step = 0; step < merkles.size(); step++) {
+            auto &sign(merkles[step]);
+            for(asizei loop = 0; loop < count; loop++) {
+                std::copy(merkleRoot[loop].cbegin(), merkleRoot[loop].cend(), merkleSHA[loop].begin());
+                std::copy(sign.cbegin(), sign.cend(), merkleSHA[loop].begin() + 32);
+            }
+            btc::MerkleSteps(merkleRoot.data(), merkleSHA.data(), count);
+        }
+        for(asizei loop = 0; loop < count; loop++) {
+            Work &result(dst[loop]);
+            std::array<aubyte, 32> &root(merkleRoot[loop]);
+            if(littleEndianAlgo == false) btc::FlipIntegerBytes<8>(root.data(), root.data()); // most of the time
+
+            result.header = blankHeader;
+            aubyte *raw = result.header.data() + merkleOff;
+            memcpy_s(raw, 128 - merkleOff, root.data(), sizeof(root));
+
+            if(littleEndianAlgo) { // the structure is the same but several bytes must be flipped.
+                raw = result.header.data();
+                for(auint shuffle = 0; shuffle < merkleOff; shuffle += 4) {
+                    aubyte load[4];
+                    for(auint i = 0; i < 4; i++) load[i] = raw[shuffle + i];
+                    for(auint i = 0; i < 4; i++) raw[shuffle + 3 - i] = load[i];
+                }
+                // merkle is already in the right layout
+                // nbits, ntime
+                for(auint shuffle = 68; shuffle < 76; shuffle += 4) {
+                    aubyte load[4];
+                    for(auint i = 0; i < 4; i++) load[i] = raw[shuffle + i];
+                    for(auint i = 0; i < 4; i++) raw[shuffle + 3 - i] = load[i];
+                }
+            }
+        }
+    }
     virtual double GetNetworkDiff() const = 0;
 
 protected:
@@ -105,6 +126,18 @@ protected:
     asizei merkleOff;
     std::array<aubyte, 128> blankHeader;
     std::vector<std::array<aubyte, 32>> merkles;
+    hashing::BTCSHA256 prefix; //!< state after mangling the coinbase blocks preceding nonce2, those are constant for the whole job
+    asizei prefixBytes = 0; //!< amount of coinbase bytes already in prefix, multiple of SHA256 block size
+
+    //! Call every time coinbase or nonceTwoOff change.
+    void HashCoinbasePrefix() {
+        prefix.Restart();
+        prefixBytes = 0;
+        while(prefixBytes + prefix.GetBlockSize() <= nonceTwoOff) {
+            prefix.BlockProcessing(coinbase.data() + prefixBytes);
+            prefixBytes += prefix.GetBlockSize();
+        }
+    }
 };
 
 
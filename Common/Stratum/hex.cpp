@@ -0,0 +1,203 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "hex.h"
+#include "../CPUID.h"
+
+namespace stratum {
+namespace hex {
+
+
+static const aubyte NIBBLE[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+
+static const char BYTE_DIGITS[] =
+	"000102030405060708090a0b0c0d0e0f"
+	"101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f"
+	"303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f"
+	"505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f"
+	"707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f"
+	"909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+	"b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+	"d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+	"f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+
+const char* Describe(Result res) {
+	switch(res) {
+	case r_ok: return "Hexadecimal string decoded correctly.";
+	case r_truncated: return "Hexadecimal string truncated.";
+	case r_badChar: return "Hexadecimal string contains invalid character.";
+	case r_tooLong: return "Hexadecimal string is too long, overflows available bits.";
+	}
+	return "Unknown hexadecimal decoding error.";
+}
+
+
+aubyte Nibble(char c) { return NIBBLE[aubyte(c)]; }
+
+
+/*! Scalar paths, always there and also used for the tails of the vector paths.
+Invalid chars have the high bits set, those are accumulated and only checked at the end so there are no branches in the loop. */
+static bool DecodeScalar(aubyte *dst, const char *hex, asizei bytes) {
+	aubyte invalid = 0;
+	for(asizei loop = 0; loop < bytes; loop++) {
+		const aubyte hi = NIBBLE[aubyte(hex[loop * 2])];
+		const aubyte lo = NIBBLE[aubyte(hex[loop * 2 + 1])];
+		invalid |= hi | lo;
+		dst[loop] = aubyte(hi << 4) | (lo & 0x0F);
+	}
+	return (invalid & 0xF0) == 0;
+}
+
+
+static void EncodeScalar(char *dst, const aubyte *src, asizei count) {
+	for(asizei loop = 0; loop < count; loop++) {
+		const char *pair = BYTE_DIGITS + 2 * src[loop];
+		dst[loop * 2] = pair[0];
+		dst[loop * 2 + 1] = pair[1];
+	}
+}
+
+
+typedef bool (*Decoder)(aubyte *dst, const char *hex, asizei bytes);
+typedef void (*Encoder)(char *dst, const aubyte *src, asizei count);
+
+
+#if defined(_M_AMD64) || defined _M_IX86
+
+/*! 16 chars to 8 bytes at a time. Digits and letters are told apart by two unsigned range checks (min(x, limit) == x),
+then the nibbles are joined by multiplying the high one by 16 with a single maddubs. */
+static bool DecodeSSSE3(aubyte *dst, const char *hex, asizei bytes) {
+	const __m128i zero = _mm_set1_epi8('0'), alpha = _mm_set1_epi8('a'), lower = _mm_set1_epi8(0x20);
+	const __m128i nine = _mm_set1_epi8(9), five = _mm_set1_epi8(5), ten = _mm_set1_epi8(10);
+	const __m128i weights = _mm_set1_epi16(0x0110); // hi * 16 + lo * 1
+	asizei done = 0;
+	for(; done + 8 <= bytes; done += 8) {
+		const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + done * 2));
+		const __m128i digit = _mm_sub_epi8(chars, zero);
+		const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, lower), alpha);
+		const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, nine), digit);
+		const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, five), letter);
+		if(_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xFFFF) return false;
+		const __m128i value = _mm_or_si128(_mm_and_si128(isDigit, digit), _mm_and_si128(isLetter, _mm_add_epi8(letter, ten)));
+		const __m128i joined = _mm_maddubs_epi16(value, weights);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + done), _mm_packus_epi16(joined, joined));
+	}
+	return DecodeScalar(dst + done, hex + done * 2, bytes - done);
+}
+
+
+//! Same as above but 32 chars at a time. packus works on 128-bit lanes so the two halves must be put back together.
+static bool DecodeAVX2(aubyte *dst, const char *hex, asizei bytes) {
+	const __m256i zero = _mm256_set1_epi8('0'), alpha = _mm256_set1_epi8('a'), lower = _mm256_set1_epi8(0x20);
+	const __m256i nine = _mm256_set1_epi8(9), five = _mm256_set1_epi8(5), ten = _mm256_set1_epi8(10);
+	const __m256i weights = _mm256_set1_epi16(0x0110);
+	asizei done = 0;
+	for(; done + 16 <= bytes; done += 16) {
+		const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + done * 2));
+		const __m256i digit = _mm256_sub_epi8(chars, zero);
+		const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, lower), alpha);
+		const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, nine), digit);
+		const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, five), letter);
+		if(_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter)) != -1) return false;
+		const __m256i value = _mm256_or_si256(_mm256_and_si256(isDigit, digit), _mm256_and_si256(isLetter, _mm256_add_epi8(letter, ten)));
+		const __m256i joined = _mm256_maddubs_epi16(value, weights);
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(joined, joined), 0xD8);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + done), _mm256_castsi256_si128(packed));
+	}
+	return DecodeSSSE3(dst + done, hex + done * 2, bytes - done);
+}
+
+
+//! 8 bytes to 16 chars: split nibbles, interleave them and look them up with pshufb.
+static void EncodeSSSE3(char *dst, const aubyte *src, asizei count) {
+	const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+	const __m128i low = _mm_set1_epi8(0x0F);
+	asizei done = 0;
+	for(; done + 8 <= count; done += 8) {
+		const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + done));
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), low);
+		const __m128i lo = _mm_and_si128(bytes, low);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + done * 2), _mm_shuffle_epi8(digits, _mm_unpacklo_epi8(hi, lo)));
+	}
+	EncodeScalar(dst + done * 2, src + done, count - done);
+}
+
+
+static void EncodeAVX2(char *dst, const aubyte *src, asizei count) {
+	const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+	                                        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+	const __m128i low = _mm_set1_epi8(0x0F);
+	asizei done = 0;
+	for(; done + 16 <= count; done += 16) {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done));
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), low);
+		const __m128i lo = _mm_and_si128(bytes, low);
+		const __m256i nibbles = _mm256_set_m128i(_mm_unpackhi_epi8(hi, lo), _mm_unpacklo_epi8(hi, lo));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + done * 2), _mm256_shuffle_epi8(digits, nibbles));
+	}
+	EncodeSSSE3(dst + done * 2, src + done, count - done);
+}
+
+
+static Decoder SelectDecoder() { return cpuid::HasAVX2()? DecodeAVX2 : (cpuid::HasSSSE3()? DecodeSSSE3 : DecodeScalar); }
+static Encoder SelectEncoder() { return cpuid::HasAVX2()? EncodeAVX2 : (cpuid::HasSSSE3()? EncodeSSSE3 : EncodeScalar); }
+
+#else
+
+static Decoder SelectDecoder() { return DecodeScalar; }
+static Encoder SelectEncoder() { return EncodeScalar; }
+
+#endif
+
+
+Result Decode(aubyte *dst, const char *hex, asizei len, asizei *bad) {
+	if(len % 2) return r_truncated;
+	static const Decoder decode = SelectDecoder();
+	const asizei bytes = len / 2;
+	if(bytes < 16 ? DecodeScalar(dst, hex, bytes) : decode(dst, hex, bytes)) return r_ok;
+	if(bad) {
+		asizei scan = 0;
+		while(NIBBLE[aubyte(hex[scan])] < 16) scan++;
+		*bad = scan;
+	}
+	return r_badChar;
+}
+
+
+char* Encode(char *dst, const aubyte *src, asizei count) {
+	static const Encoder encode = SelectEncoder();
+	if(count < 8) EncodeScalar(dst, src, count);
+	else encode(dst, src, count);
+	return dst + count * 2;
+}
+
+
+}
+}
@@ -0,0 +1,39 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../AREN/ArenDataTypes.h"
+
+namespace stratum {
+
+/*! Stratum moves everything binary around as hex strings: coinbase parts, merkle branches, previous hash and every share we send.
+Those are the low-level converters, they write to caller-provided memory and never throw.
+Long strings go through SSSE3 or AVX2 if the CPU has them, selected the first time they are needed. */
+namespace hex {
+
+enum Result {
+	r_ok,
+	r_truncated, //!< odd amount of hex digits
+	r_badChar, //!< something not [0-9a-fA-F]
+	r_tooLong //!< more digits than destination can hold
+};
+
+//! A string describing the error, suitable for throwing by outer code.
+const char* Describe(Result res);
+
+//! \returns 0 <= ret < 16 for valid hex digits, 0xFF otherwise.
+aubyte Nibble(char c);
+
+/*! Decode len hex digits in len / 2 bytes.
+\param dst Must have room for at least len / 2 bytes. Content is undefined in case of error.
+\param bad If not nullptr and the result is r_badChar, gets the index of the first invalid char. */
+Result Decode(aubyte *dst, const char *hex, asizei len, asizei *bad = nullptr);
+
+/*! Lowercase hex, most significant nibble first. Does not add a terminator.
+\param dst Must have room for 2 * count chars.
+\returns dst + 2 * count */
+char* Encode(char *dst, const aubyte *src, asizei count);
+
+}
+}
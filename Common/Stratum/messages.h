@@ -126,6 +126,24 @@ struct MiningSubmitResponse {
 	MiningSubmitResponse(bool ok = false) : accepted(ok) { }
 };
 
+
+/*! Client->Server mining.extranonce.subscribe has no parameters. The server replies true if it's going to send mining.set_extranonce
+instead of dropping the connection when nonce1 changes. Pools not knowing about it usually reply with an error, that's just false. */
+struct MiningExtranonceSubscribeResponse {
+	bool subscribed;
+	MiningExtranonceSubscribeResponse(bool ok = false) : subscribed(ok) { }
+};
+
+
+/*! Server->Client, .params = [ nonce1, nonce2size ], same meaning as the last two values of the mining.subscribe response.
+Those are not to be used right away but starting from the next mining.notify. */
+struct MiningSetExtranonceNotify {
+	std::vector<aubyte> extraNonceOne;
+	__int32 extraNonceTwoSZ;
+	//! Remember to populate the extraNonceOne array, same as MiningSubscribeResponse.
+	explicit MiningSetExtranonceNotify(__int32 extraSZ = 0) : extraNonceTwoSZ(extraSZ) { }
+};
+
 /*
 
 /*
@@ -5,6 +5,7 @@
 #pragma once
 #include <rapidjson/document.h> // Value
 #include "messages.h"
+#include "hex.h"
 #include <memory>
 #include "../AREN/ArenDataTypes.h"
 
@@ -15,24 +16,26 @@ as defined in messages.h */
 namespace parsing {
 
 struct AbstractParser {
+	/*! Those are convenience wrappers over stratum::hex which throw on errors instead of returning codes.
+	If you need to decode without exceptions or into your own memory, go there. */
+	static void Check(hex::Result res) {
+		if(res != hex::r_ok) throw std::exception(hex::Describe(res));
+	}
+
 	/*! Decode a hex character to its value, with safety checks.
 	\returns 0 <= ret < 16 */
 	static __int8 DecodeHEX(char c) {
-		c = toupper(c);
-		if(c >= '0' && c <= '9') return c - '0';
-		if(c >= 'A' && c <= 'F') return c - 'A' + 10;
-		throw std::exception("Hexadecimal string contains invalid character.");
-		return c;
+		const aubyte value = hex::Nibble(c);
+		if(value > 0x0F) Check(hex::r_badChar);
+		return __int8(value);
 	}
 
 	/* Decode a string made of hex digits in an array of uint8 being half as long.
 	\returns The vector used as destination. */
 	static std::vector<aubyte>& DecodeHEX(std::vector<aubyte> &dst, const char *hex, asizei len) {
-		if(len % 1) throw std::exception("Hexadecimal string truncated.");
+		if(len % 2) Check(hex::r_truncated);
 		dst.resize(len / 2);
-		for(size_t scan = 0; scan < len; scan += 2) {
-			dst[scan / 2] = DecodeHEX(hex[scan]) << 4 | DecodeHEX(hex[scan + 1]); // + is ok too
-		}
+		Check(hex::Decode(dst.data(), hex, len));
 		return dst;
 	}
 	static std::vector<unsigned __int8>& DecodeHEX(std::vector<unsigned __int8> &dst, const std::string &hex) {
@@ -40,17 +43,9 @@ struct AbstractParser {
 	}
 	/*! Takes a few bytes and produces a HEX string. */
 	static std::string EncodeToHEX(const aubyte *stream, asizei count) {
-		std::unique_ptr<char[]> enc(new char[count * 2 + 1]);
-		char *dst = enc.get();
-		char *digits = "0123456789abcdef";
-		for(asizei loop = 0; loop < count; loop++) {
-			*dst = digits[stream[loop] >> 4];
-			dst++;
-			*dst = digits[stream[loop] & 0x0F];
-			dst++;
-		}
-		*dst = 0;
-		return std::string(enc.get());
+		std::string ret(count * 2, 0);
+		hex::Encode(&ret[0], stream, count);
+		return ret;
 	}
 	static std::string EncodeToHEX(const std::vector<aubyte> &stream) {
 		return EncodeToHEX(stream.data(), stream.size());
@@ -61,28 +56,41 @@ struct AbstractParser {
 		value = HTON(value);
 		return EncodeToHEX(reinterpret_cast<aubyte*>(&value), sizeof(value));
 	}
+	//! Caller-provided storage, 2 * sizeof(value) chars. \returns one past the last char written.
+	template<typename Scalar>
+	static char* EncodeToHEX(char *dst, Scalar value) {
+		value = HTON(value);
+		return hex::Encode(dst, reinterpret_cast<aubyte*>(&value), sizeof(value));
+	}
 	template<size_t SZ>
 	static std::array<unsigned __int8, SZ>& DecodeHEX(std::array<unsigned __int8, SZ> &dst, const std::string &hex) {
-		if(hex.length() % 1) throw std::exception("Hexadecimal string truncated.");
-		if(hex.size() < hex.length() / 2) throw std::exception("Hexadecimal string is too long, overflows available constant bits.");
-		for(size_t scan = 0; scan < hex.length(); scan += 2) {
-			dst[scan / 2] = DecodeHEX(hex[scan]) << 4 | DecodeHEX(hex[scan + 1]); // + is ok too
-		}
+		return DecodeHEX(dst, hex.c_str(), hex.length());
+	}
+	//! Same as above but does not need to build a string, for decoding straight from (in-situ) JSON values.
+	template<size_t SZ>
+	static std::array<unsigned __int8, SZ>& DecodeHEX(std::array<unsigned __int8, SZ> &dst, const char *hex, asizei len) {
+		if(len / 2 > SZ) Check(hex::r_tooLong);
+		Check(hex::Decode(dst.data(), hex, len));
 		return dst;
 	}
 	template<typename Integer>
-	static Integer DecodeHEX(const std::string &hex) {
+	static Integer DecodeHEX(const std::string &hex) { return DecodeHEX<Integer>(hex.c_str(), hex.length()); }
+	template<typename Integer>
+	static Integer DecodeHEX(const char *hex, asizei len) {
 		Integer ret(0);
-		if(hex.length() / 2 > sizeof(Integer)) throw std::exception("Too many bits to pack.");
+		if(len / 2 > sizeof(Integer)) throw std::exception("Too many bits to pack.");
 		size_t shift = 0;
-		for(size_t scan = 0; scan < hex.length(); scan++) {
-			char c = hex[hex.length() - 1 - scan];
-			ret |= DecodeHEX(c) << shift;
+		aubyte invalid = 0;
+		for(size_t scan = 0; scan < len; scan++) {
+			const aubyte value = hex::Nibble(hex[len - 1 - scan]);
+			invalid |= value;
+			ret |= Integer(value & 0x0F) << shift;
 			//! \todo this assumes the target machine is little endian.
 			//! so when the message is big-endian, we also swap
 			//! is it the correct thing to do?
 			shift += 4;
 		}
+		if(invalid > 0x0F) Check(hex::r_badChar);
 		return ret;
 	}
 
@@ -185,6 +193,17 @@ struct MiningSubmit : public AbstractParser {
 };
 
 
+struct MiningExtranonceSubscribe : public AbstractParser {
+	typedef MiningExtranonceSubscribeResponse Product;
+	MiningExtranonceSubscribe() : AbstractParser("mining.extranonce.subscribe") { }
+	Product* Mangle(const rapidjson::Value &root) {
+		if(root.IsNull()) return new Product(false);
+		if(root.IsBool() == false) throw std::exception("mining.extranonce.subscribe, result is not a boolean.");
+		return new Product(root.GetBool());
+	}
+};
+
+
 struct ClientGetVersion : public AbstractParser {
 	typedef ClientGetVersionRequest Product;
 	ClientGetVersion() : AbstractParser("client.get_version") { }
@@ -210,32 +229,57 @@ struct MiningSetDifficulty : public AbstractParser {
 };
 
 
+struct MiningSetExtranonce : public AbstractParser {
+	typedef MiningSetExtranonceNotify Product;
+	MiningSetExtranonce() : AbstractParser("mining.set_extranonce") { }
+	Product* Mangle(const rapidjson::Value &params) {
+		if(params.Size() != 2) throw std::exception("mining.set_extranonce must have 2 parameters.");
+		if(params[0u].IsString() == false) throw std::exception("mining.set_extranonce .params[0] is not a valid nonce1 string.");
+		if(params[1].IsUint() == false) throw std::exception("mining.set_extranonce .params[1] is not a valid extra size.");
+		std::unique_ptr<Product> ret(new Product(params[1].GetUint()));
+		DecodeHEX(ret->extraNonceOne, params[0u].GetString(), params[0u].GetStringLength());
+		return ret.release();
+	}
+};
+
+
 /*! \todo better naming structure */
 struct MiningNotifyParser : public AbstractParser {
 	typedef MiningNotify Product;
 	MiningNotifyParser() : AbstractParser("mining.notify") { }
 	Product* Mangle(const rapidjson::Value &params) {
+		std::unique_ptr<MiningNotify> ret(new MiningNotify);
+		Mangle(*ret, params);
+		return ret.release();
+	}
+
+	/*! Decode in an already existing object, recycling its storage. Notify is very frequent and its vectors are fairly stable in size
+	so when the same destination is used over and over the only allocations happen when a message is bigger than all the previous.
+	\note If this throws, dst contents are undefined. */
+	void Mangle(MiningNotify &dst, const rapidjson::Value &params) {
 		if(params.IsArray() == false || params.Size() != 9) throw std::exception("mining.notify message not array or not having 8 entries.");
 		if(params[8].IsBool() == false) throw std::exception("restart flag is not a bool");
-		const bool restart = params[8].GetBool();
-		const __int32 ntime = DecodeHEX<__int32>(ToString(params[7]));
-		const __int32 nbit = DecodeHEX<__int32>(ToString(params[6]));
-		const __int32 blockVersion = DecodeHEX<__int32>(ToString(params[5]));
-		const std::string job(ToString(params[0U]));
-		std::unique_ptr<MiningNotify> ret(new MiningNotify(job, blockVersion, nbit, ntime, restart));
-		DecodeHEX(ret->prevHash, params[1].GetString());
-		DecodeHEX(ret->coinBaseOne, params[2].GetString(), params[2].GetStringLength());
-		DecodeHEX(ret->coinBaseTwo, params[3].GetString(), params[3].GetStringLength());
+		for(auint check = 1; check < 8; check++) {
+			if(check != 4 && params[check].IsString() == false) throw std::exception("mining.notify, expected string parameter.");
+		}
+		dst.clear = params[8].GetBool();
+		dst.ntime = DecodeHEX<__int32>(params[7].GetString(), params[7].GetStringLength());
+		dst.nbits = DecodeHEX<__int32>(params[6].GetString(), params[6].GetStringLength());
+		dst.blockVer = DecodeHEX<__int32>(params[5].GetString(), params[5].GetStringLength());
+		if(params[0U].IsString()) dst.job.assign(params[0U].GetString(), params[0U].GetStringLength());
+		else dst.job = ToString(params[0U]);
+		DecodeHEX(dst.prevHash, params[1].GetString(), params[1].GetStringLength());
+		DecodeHEX(dst.coinBaseOne, params[2].GetString(), params[2].GetStringLength());
+		DecodeHEX(dst.coinBaseTwo, params[3].GetString(), params[3].GetStringLength());
 		auto &merkles(params[4]);
 		if(merkles.IsArray() == false) throw std::exception("Merkle array missing");
-		ret->merkles.resize(merkles.Size()); // notice: it can be 0 length, it's valid.
+		dst.merkles.resize(merkles.Size()); // notice: it can be 0 length, it's valid.
 		asizei loop = 0;
 		for(rapidjson::Value::ConstValueIterator mrk = merkles.Begin(); mrk != merkles.End(); ++mrk) {
 			if(mrk->IsString() == false) throw std::exception("Merkle array contains non-string element.");
-			DecodeHEX(ret->merkles[loop].hash, mrk->GetString());
+			DecodeHEX(dst.merkles[loop].hash, mrk->GetString(), mrk->GetStringLength());
 			loop++;
 		}
-		return ret.release();
 	}
 };
 
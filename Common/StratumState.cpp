@@ -77,29 +77,63 @@ StratumState::AuthStatus StratumState::GetAuthenticationStatus(const char *name)
 
 
 asizei StratumState::SendWork(const std::string &job, auint ntime, auint nonce2, auint nonce) {
-	const char *user = workers[0].name.c_str(); //!< \todo quick hack to match, should be tracked by worker!
-	auto &worker(workers[0]);
-
-	const char *sep = "\", \"";
-	std::stringstream params;
-	params<<std::hex;
-	params<<"[\""<<worker.name<<sep<<job<<sep
-		  <<std::setw(8)<<std::setfill('0')<<nonce2<<sep
-		  <<std::setw(8)<<std::setfill('0')<<ntime<<sep
-		  <<std::setw(8)<<std::setfill('0')<<HTON(nonce)<<"\"]";
-	const std::string message(params.str());
-	const size_t used = PushMethod("mining.submit", KeyValue("params", message, false));
-	ScopedFuncCall popMsg([this]() { this->pending.pop(); });
+	auto &worker(workers[0]); //!< \todo quick hack to match, should be tracked by worker!
+	const asizei used = nextRequestID;
+	submitFormat.Format(spare, worker.name, used, job, nonce2, ntime, HTON(nonce));
+	Blob add(std::move(spare), used);
+	pendingRequests.insert(std::make_pair(used, "mining.submit"));
+	ScopedFuncCall popPending([this, used]() { this->pendingRequests.erase(used); });
 	submittedWork.insert(std::make_pair(used, &worker));
 	ScopedFuncCall popSubmitted([this, used]() { this->submittedWork.erase(used); });
-	pendingRequests.insert(std::make_pair(used, "mining.submit"));
-	popMsg.Dont();
+	pending.push(std::move(add));
+	popPending.Dont();
 	popSubmitted.Dont();
+	nextRequestID++;
+	if(!nextRequestID) nextRequestID++; // \sa PushMethod
 	worker.nonces.sent++;
     return used;
 }
 
 
+void StratumState::SubmitFormatter::Format(std::vector<__int8> &line, const std::string &worker, asizei id, const std::string &job, auint nonce2, auint ntime, auint nonce) {
+	const char *idPrefix = "{\"id\": \"";
+	const char *sep = "\", \"";
+	const char *close = "\"]}\n";
+	if(this->worker != worker || afterID.empty()) {
+		this->worker = worker;
+		afterID = "\", \"method\": \"mining.submit\", \"params\": [\"";
+		afterID += worker;
+		afterID += sep;
+	}
+	char idstr[20];
+	char *digit = idstr + sizeof(idstr);
+	do {
+		digit--;
+		*digit = '0' + id % 10;
+		id /= 10;
+	} while(id);
+	const asizei idLen = idstr + sizeof(idstr) - digit;
+	const asizei sepLen = strlen(sep);
+	line.resize(strlen(idPrefix) + idLen + afterID.length() + job.length() + 3 * (sepLen + 8) + strlen(close));
+	char *dst = reinterpret_cast<char*>(line.data());
+	auto put = [&dst](const char *src, asizei count) {
+		memcpy(dst, src, count);
+		dst += count;
+	};
+	put(idPrefix, strlen(idPrefix));
+	put(digit, idLen);
+	put(afterID.c_str(), afterID.length());
+	put(job.c_str(), job.length());
+	put(sep, sepLen);
+	dst = stratum::parsing::AbstractParser::EncodeToHEX(dst, nonce2);
+	put(sep, sepLen);
+	dst = stratum::parsing::AbstractParser::EncodeToHEX(dst, ntime);
+	put(sep, sepLen);
+	dst = stratum::parsing::AbstractParser::EncodeToHEX(dst, nonce);
+	put(close, strlen(close));
+}
+
+
 void StratumState::Request(const stratum::ClientGetVersionRequest &msg) {
     // There are various ways to produce a decent version string...
     // But at the end of the day it's just easier to fully rebuild and be done with it.
@@ -144,11 +178,40 @@ void StratumState::Response(asizei id, const stratum::MiningSubmitResponse &msg)
 
 
 void StratumState::Notify(const stratum::MiningNotify &msg) {
+	if(nextExtranonce) { // so the swap happens together with the new job
+		subscription.extraNonceOne = std::move(nextExtranonce->extraNonceOne);
+		subscription.extraNonceTwoSZ = nextExtranonce->extraNonceTwoSZ;
+		nextExtranonce.reset();
+		extranonceChanges++;
+	}
 	block = msg;
 	dataTimestamp = time(NULL);
 }
 
 
+void StratumState::Notify(const stratum::MiningSetExtranonceNotify &msg) {
+	nextExtranonce.reset(new stratum::MiningSetExtranonceNotify(msg));
+}
+
+
+void StratumState::SubscribeExtranonce() {
+	PushMethod("mining.extranonce.subscribe", KeyValue("params", "[]", false));
+}
+
+
+void StratumState::SuggestDifficulty(adouble diff) {
+	PushMethod("mining.suggest_difficulty", KeyValue("params", "[" + FormatDifficulty(diff) + "]", false));
+}
+
+
+string StratumState::FormatDifficulty(adouble diff) {
+	if(diff >= 1.0) return std::to_string(aulong(diff + .5));
+	char buff[32];
+	snprintf(buff, sizeof(buff), "%.17g", diff);
+	return string(buff);
+}
+
+
 void StratumState::RequestReplyReceived(asizei id, bool error) {
 	ScopedFuncCall clear([this, id]() { pendingRequests.erase(pendingRequests.find(id)); });
 	if(error) {
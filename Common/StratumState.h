@@ -85,6 +85,27 @@ public:
 	void Authorize(const char *user, const char *psw);
 	AuthStatus GetAuthenticationStatus(const char *name) const;
 
+	/*! Queue a mining.extranonce.subscribe. If the server accepts, it will send mining.set_extranonce when it wants to change
+	nonce1 instead of dropping the connection. Not sent by default as some pools don't like unknown methods. */
+	void SubscribeExtranonce();
+
+	/*! Queue a mining.suggest_difficulty. Pools are free to ignore it, some don't even reply so the result is not tracked.
+	Difficulty goes out as-is, use the same units as mining.set_difficulty. */
+	void SuggestDifficulty(adouble diff);
+
+	/*! Difficulty as it goes in mining.suggest_difficulty and "d=" passwords. Some pools choke on fractional values so it's integer
+	whenever possible, otherwise full precision as low difficulties (such as 1/65536 for scrypt) would be truncated to 0. */
+	static string FormatDifficulty(adouble diff);
+	bool ExtranonceSubscribed() const { return extranonceSubscribed; }
+
+	/*! Incremented every time a mining.set_extranonce gets applied, which happens together with a mining.notify.
+	Work generated before that is no good anymore even if the job looks the same. */
+	asizei GetExtranonceChanges() const { return extranonceChanges; }
+
+	/*! True if a mining.set_extranonce waiting to be applied also changes the nonce2 size. Work generation does not deal with that,
+	the connection is better dropped and subscribed again. */
+	bool Nonce2SizeChanging() const { return nextExtranonce && nextExtranonce->extraNonceTwoSZ != subscription.extraNonceTwoSZ; }
+
 	/*! Returns true if the given worker has attempted authorization. It might be still being authorized
 	or perhaps it might have failed registration. \sa CanSendWork */
 	bool IsWorker(const char *name) const;
@@ -111,11 +132,20 @@ public:
             data.resize(total);
             std::copy(msg, msg + count, data.begin());
 		}
+		//! Takes ownership of an already filled buffer, no copy.
+		Blob(std::vector<__int8> &&msg, size_t msgID)
+			: data(std::move(msg)), total(data.size()), sent(0), id(msgID) { }
 		// note no destructor --> leak. I destruct those when the pool is destroyed so copy
 		// is easy and no need for unique_ptr
 	};
 	std::queue<Blob> pending;
 
+	//! Call this instead of popping pending directly so the buffer can be recycled by SendWork.
+	void Sent() {
+		spare = std::move(pending.front().data);
+		pending.pop();
+	}
+
 	// .id and .method --> Request \sa RequestReplyReceived
 	void Request(const stratum::ClientGetVersionRequest &msg);
 
@@ -127,9 +157,11 @@ public:
 	void Response(size_t id, const stratum::MiningSubscribeResponse &msg) { subscription = msg; }
 	void Response(asizei id, const stratum::MiningAuthorizeResponse &msg);
 	void Response(asizei id, const stratum::MiningSubmitResponse &msg);
+	void Response(asizei id, const stratum::MiningExtranonceSubscribeResponse &msg) { extranonceSubscribed = msg.subscribed; }
 
 	void Notify(const stratum::MiningSetDifficultyNotify &msg) { difficulty = msg.newDiff; }
 	void Notify(const stratum::MiningNotify &msg);
+	void Notify(const stratum::MiningSetExtranonceNotify &msg);
 
 	/*! When a reply to a request is received, no matter if successful or not, you use Response to identify the original type of request and then issue
 	a Response call accordingly. After processing has elapsed, call this function the free the resources allocated to remember the message which was just processed.
@@ -160,6 +192,10 @@ private:
 	stratum::MiningSubscribeResponse subscription; //!< comes handy!
 	stratum::MiningNotify block; //!< sent by remote server and stored here
 	double difficulty;
+	bool extranonceSubscribed = false;
+	asizei extranonceChanges = 0;
+	//! mining.set_extranonce received but not applied yet. Jobs already notified keep using the old values, so they keep building valid shares.
+	std::unique_ptr<stratum::MiningSetExtranonceNotify> nextExtranonce;
 
 	struct Worker {
 		std::string name; //!< server side login credentials
@@ -185,6 +221,22 @@ private:
 
 	/*! Maps a mining.submit to the worker originating it so I can keep count of accepted/rejected shares. */
 	std::map<size_t, Worker*> submittedWork;
+
+	/*! mining.submit is the only message sent often enough to matter so instead of going through streams and concatenations it is
+	built by filling in a template. What comes between the id and the job only depends on the worker so it's rebuilt only when the
+	worker changes. Output goes straight to the buffer which will be queued for sending, same bytes as the old PushMethod/KeyValue path. */
+	class SubmitFormatter {
+	public:
+		//! Replaces the contents of line with the formatted message, including the newline.
+		void Format(std::vector<__int8> &line, const std::string &worker, asizei id, const std::string &job, auint nonce2, auint ntime, auint nonce);
+	private:
+		std::string worker; //!< afterID has been built for this
+		std::string afterID; //!< closes the id, method, opens params and includes the worker name
+	} submitFormat;
+
+	/*! Storage of the last message fully sent, shares are formatted there. Messages are about the same length so after the first
+	few shares it has enough capacity and sending a share does not allocate. */
+	std::vector<__int8> spare;
 };
 
 /*! \todo It appears obvious this object is not in the correct place
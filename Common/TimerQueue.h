@@ -0,0 +1,129 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "AREN/ArenDataTypes.h"
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+
+
+/*! Deadlines for the main loop. Instead of waking up every few milliseconds to check if something has to be done, each subsystem
+registers the time it needs to run and the loop sleeps until the earliest one, or until an I/O event comes.
+Timers are kept sorted by expiration so the next deadline is always the first and cancelling is just a removal.
+This is not thread safe: timers are added, cancelled and fired by the thread running the loop. Other threads can only wake it up,
+see NetworkInterface::Wake. */
+class TimerQueue {
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef asizei TimerID; //!< 0 is never used so it can be used to mark "no timer"
+
+	TimerID At(Clock::time_point when, std::function<void()> fn) { return Add(when, Clock::duration::zero(), std::move(fn)); }
+	TimerID After(Clock::duration delay, std::function<void()> fn) { return Add(Clock::now() + delay, Clock::duration::zero(), std::move(fn)); }
+
+	//! Callback is called every period, first call after one period. Late calls are not recovered, the next is a full period later.
+	TimerID Every(Clock::duration period, std::function<void()> fn) { return Add(Clock::now() + period, period, std::move(fn)); }
+
+	//! Cancelling a timer which already fired or was never created is fine, does nothing. Timers can cancel themselves.
+	void Cancel(TimerID id) {
+		auto timer = timers.find(id);
+		if(timer == timers.end()) return;
+		queue.erase(std::make_pair(timer->second.when, id));
+		timers.erase(timer);
+	}
+
+	/*! Move a timer to a new deadline or create it if id is 0 or does not exist anymore, id is updated.
+	This is the common way for something which has a single deadline changing over time. */
+	void Reschedule(TimerID &id, Clock::time_point when, std::function<void()> fn) {
+		auto timer = timers.find(id);
+		if(timer != timers.end() && timer->second.when == when) return;
+		Cancel(id);
+		id = At(when, std::move(fn));
+	}
+
+	/*! Same thing for deadlines kept with the wall clock. Those are compared as they are: converting them to our clock gives a
+	slightly different value every time so the timer would be cancelled and added again at every call. */
+	void Reschedule(TimerID &id, std::chrono::system_clock::time_point when, std::function<void()> fn) {
+		auto timer = timers.find(id);
+		if(timer != timers.end() && timer->second.wallWhen == when) return;
+		Cancel(id);
+		id = At(FromSystem(when), std::move(fn));
+		timers.find(id)->second.wallWhen = when;
+	}
+
+	/*! \returns Milliseconds to the earliest deadline, rounded up so sleeping that long is enough for it to expire,
+	0 if some timer is already expired, cap if there are no timers or they're further away. */
+	asizei Timeout(asizei cap = asizei(-1)) const {
+		if(queue.empty()) return cap;
+		const auto now(Clock::now());
+		const auto when(queue.cbegin()->first);
+		if(when <= now) return 0;
+		const asizei ms = asizei(std::chrono::duration_cast<std::chrono::milliseconds>(when - now).count()) + 1;
+		return ms < cap? ms : cap;
+	}
+
+	/*! Calls the callbacks of expired timers in deadline order. Timers added by the callbacks are only considered next call,
+	even if already expired, so a timer rescheduling itself cannot starve the loop.
+	\returns Number of callbacks called. */
+	asizei Fire() {
+		const auto now(Clock::now());
+		const TimerID last = nextID;
+		asizei fired = 0;
+		auto next = queue.begin();
+		while(next != queue.end() && next->first <= now) {
+			const TimerID id = next->second;
+			if(id >= last) { // created by a callback
+				++next;
+				continue;
+			}
+			queue.erase(next);
+			auto timer = timers.find(id);
+			std::function<void()> fn;
+			if(timer->second.period == Clock::duration::zero()) {
+				fn = std::move(timer->second.fn);
+				timers.erase(timer);
+			}
+			else {
+				fn = timer->second.fn;
+				timer->second.when = now + timer->second.period;
+				queue.insert(std::make_pair(timer->second.when, id));
+			}
+			fn();
+			fired++;
+			next = queue.begin(); // callbacks can cancel anything
+		}
+		return fired;
+	}
+
+	bool Empty() const { return timers.empty(); }
+	bool Pending(TimerID id) const { return timers.find(id) != timers.cend(); }
+
+	//! Lots of code keeps time with the wall clock, this converts to our clock which cannot jump.
+	static Clock::time_point FromSystem(std::chrono::system_clock::time_point when) {
+		return Clock::now() + std::chrono::duration_cast<Clock::duration>(when - std::chrono::system_clock::now());
+	}
+
+private:
+	struct Timer {
+		Clock::time_point when;
+		Clock::duration period;
+		std::function<void()> fn;
+		std::chrono::system_clock::time_point wallWhen; //!< deadline as given to Reschedule, if that was wall clock time
+	};
+	std::map<TimerID, Timer> timers;
+	std::set<std::pair<Clock::time_point, TimerID>> queue;
+	TimerID nextID = 1;
+
+	TimerID Add(Clock::time_point when, Clock::duration period, std::function<void()> fn) {
+		const TimerID id = nextID++;
+		Timer add;
+		add.when = when;
+		add.period = period;
+		add.fn = std::move(fn);
+		timers.insert(std::make_pair(id, std::move(add)));
+		queue.insert(std::make_pair(when, id));
+		return id;
+	}
+};
@@ -29,7 +29,10 @@ public:
 			if(count + used > GetMaxInboundMessageSize()) throw std::exception("Message is way too big!");
 			message.resize(message.size() + asizei(count));
 			memcpy_s(message.data() + used, message.size() - used, raw, asizei(count));
-			if(IsFinalFrame()) data.push_back(std::move(message));
+			if(IsFinalFrame()) {
+				if(IsCompressedMessage()) Inflate(message, GetMaxInboundMessageSize());
+				data.push_back(std::move(message));
+			}
 		}
 		return data.size() != initially;
 	}
@@ -0,0 +1,94 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "Deflate.h"
+#include <zlib.h>
+#include <sstream>
+#include <cstring>
+
+namespace ws {
+
+
+std::string DeflateParams::Response() const {
+	std::stringstream build;
+	build<<"permessage-deflate";
+	if(serverNoContextTakeover) build<<"; server_no_context_takeover";
+	if(clientNoContextTakeover) build<<"; client_no_context_takeover";
+	if(serverMaxWindowBits < 15) build<<"; server_max_window_bits="<<serverMaxWindowBits;
+	return build.str();
+}
+
+
+Deflater::Deflater(aint level, auint windowBits, bool contextTakeover) : stream(new z_stream_s), takeover(contextTakeover) {
+	memset(stream.get(), 0, sizeof(z_stream_s));
+	if(deflateInit2(stream.get(), level, Z_DEFLATED, -aint(windowBits), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		throw std::exception("Could not initialize deflate stream.");
+	}
+}
+
+
+Deflater::~Deflater() { deflateEnd(stream.get()); }
+
+
+void Deflater::Compress(std::vector<aubyte> &dst, const aubyte *msg, asizei len) {
+	const asizei initial = dst.size();
+	stream->next_in = const_cast<Bytef*>(msg);
+	stream->avail_in = uInt(len);
+	asizei produced = initial;
+	do {
+		dst.resize(produced + deflateBound(stream.get(), uLong(len)) + 16);
+		stream->next_out = dst.data() + produced;
+		stream->avail_out = uInt(dst.size() - produced);
+		if(deflate(stream.get(), Z_SYNC_FLUSH) == Z_STREAM_ERROR) throw std::exception("Deflate stream error.");
+		produced = dst.size() - stream->avail_out;
+	} while(stream->avail_out == 0);
+	dst.resize(produced);
+	// A sync flush always ends with an empty stored block, 00 00 FF FF. The extension wants it removed, the receiver adds it back.
+	if(produced - initial >= 4) dst.resize(produced - 4);
+	if(!takeover) deflateReset(stream.get());
+}
+
+
+Inflater::Inflater(bool contextTakeover) : stream(new z_stream_s), takeover(contextTakeover) {
+	memset(stream.get(), 0, sizeof(z_stream_s));
+	if(inflateInit2(stream.get(), -15) != Z_OK) throw std::exception("Could not initialize inflate stream.");
+}
+
+
+Inflater::~Inflater() { inflateEnd(stream.get()); }
+
+
+void Inflater::Decompress(std::vector<aubyte> &message, asizei maxSize) {
+	static const aubyte trailer[4] = { 0x00, 0x00, 0xFF, 0xFF };
+	message.insert(message.end(), trailer, trailer + sizeof(trailer));
+	std::vector<aubyte> result(message.size() * 4 < maxSize? message.size() * 4 : maxSize);
+	stream->next_in = message.data();
+	stream->avail_in = uInt(message.size());
+	asizei produced = 0;
+	do {
+		if(produced == result.size()) {
+			if(result.size() >= maxSize) { // exactly maxSize is fine, it's too big only if there's more to come
+				aubyte probe;
+				stream->next_out = &probe;
+				stream->avail_out = 1;
+				const int status = inflate(stream.get(), Z_SYNC_FLUSH);
+				if(status != Z_OK && status != Z_BUF_ERROR) throw std::exception("Invalid compressed message.");
+				if(stream->avail_out == 0) throw std::exception("Message is way too big!");
+				break;
+			}
+			result.resize(result.size() * 2 < maxSize? result.size() * 2 : maxSize);
+		}
+		stream->next_out = result.data() + produced;
+		stream->avail_out = uInt(result.size() - produced);
+		const int status = inflate(stream.get(), Z_SYNC_FLUSH);
+		if(status != Z_OK && status != Z_BUF_ERROR) throw std::exception("Invalid compressed message.");
+		produced = result.size() - stream->avail_out;
+		if(status == Z_BUF_ERROR && stream->avail_out) break; // no progress possible, input is truncated
+	} while(stream->avail_in || stream->avail_out == 0);
+	result.resize(produced);
+	message = std::move(result);
+	if(!takeover) inflateReset(stream.get());
+}
+
+}
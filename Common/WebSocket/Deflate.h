@@ -0,0 +1,56 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../AREN/ArenDataTypes.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+struct z_stream_s; // zlib, only the .cpp needs to know
+
+
+namespace ws {
+
+/*! permessage-deflate extension, RFC 7692. The client offers it in the handshake together with some parameters,
+the server picks the first offer it can satisfy and replies with the parameters it agreed on, see HandShaker.
+Context takeover is the default: each side keeps the LZ77 window between messages so a push which is mostly equal to the
+previous one compresses to a few bytes. */
+struct DeflateParams {
+	bool enabled = false;
+	bool serverNoContextTakeover = false, clientNoContextTakeover = false;
+	auint serverMaxWindowBits = 15; //!< zlib cannot do raw deflate with 8 bits so offers requiring it are declined
+	aint level = 6; //!< zlib compression level 1..9, 0 disables the extension
+	asizei threshold = 64; //!< messages shorter than this are sent uncompressed, the extension allows that on a per-message basis
+
+	//! Value of the Sec-WebSocket-Extensions reply header, only meaningful if enabled.
+	std::string Response() const;
+};
+
+
+//! Compresses messages as a sequence of raw deflate blocks, each terminated by a sync flush with its 4 byte trailer removed.
+class Deflater {
+public:
+	Deflater(aint level, auint windowBits, bool contextTakeover);
+	~Deflater();
+	//! Appends the compressed message to dst.
+	void Compress(std::vector<aubyte> &dst, const aubyte *msg, asizei len);
+private:
+	std::unique_ptr<z_stream_s> stream;
+	const bool takeover;
+};
+
+
+class Inflater {
+public:
+	explicit Inflater(bool contextTakeover);
+	~Inflater();
+	//! Decompresses a message in place. Throws if the data is not valid or the message would be bigger than maxSize.
+	void Decompress(std::vector<aubyte> &message, asizei maxSize);
+private:
+	std::unique_ptr<z_stream_s> stream;
+	const bool takeover;
+};
+
+}
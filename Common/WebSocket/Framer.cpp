@@ -82,7 +82,7 @@ void Framer::EnqueueClose(CloseReason r) {
 }
 
 
-void Framer::EnqueueTextMessage(const char *msg, asizei len) {
+void Framer::EnqueueMessage(FrameType type, const aubyte *msg, asizei len) {
 	if(closeFrame.payload.size()) {
 		// It comes handy to just let the outer code think we're doing all our work here... While in fact we don't and
 		// just shut down. In theory the outer code should not send us stuff anymore but being NOP is just more convenient.
@@ -91,13 +91,42 @@ void Framer::EnqueueTextMessage(const char *msg, asizei len) {
 	// Due to the way TCP works, enqueuing is dead cheap. We just keep concatenating bytes.
 	// Note due to this path being assumed trustworthy it can grow to massive sizes if connection goes belly up.
 	if(len == 0) throw std::exception("Zero-sized messages are not supported!"); // in case you haven't got that.
+	if(!server) {
+		throw std::exception("TODO: get 4 random bytes as mask key from some high-entropy, possibly hardware source!");
+	}
+	traffic.messages++;
+	traffic.raw += len;
+	if(deflater && len >= deflateParams.threshold) {
+		compressing.clear();
+		deflater->Compress(compressing, msg, len);
+		BuildFrame(outbound, type, compressing.data(), compressing.size(), true);
+		traffic.sent += compressing.size();
+	}
+	else {
+		BuildFrame(outbound, type, msg, len);
+		traffic.sent += len;
+	}
+}
+
+
+void Framer::EnableDeflate(const DeflateParams &params) {
+	deflateParams = params;
+	deflater.reset();
+	inflater.reset();
+	if(!params.enabled) return;
+	deflater.reset(new Deflater(params.level, params.serverMaxWindowBits, !params.serverNoContextTakeover));
+	inflater.reset(new Inflater(!params.clientNoContextTakeover));
+}
+
+
+void Framer::BuildFrame(std::vector<aubyte> &dst, FrameType type, const aubyte *msg, asizei len, bool deflated) {
 	// There's no such thing as framing on the send-side. Framing happens by connection intermediaries.
 	// In the future, I think I might frame on say 4MiB, but for the time being, I just send everything as is!
-	aubyte header[1 + 1 + 8 + 4]; // max size
+	aubyte header[1 + 1 + 8]; // max size, no mask
 	asizei hbytes = 2;
-	header[0] = 0x81;
-	if(!server) header[1] = 0x80;
-	else header[1] = 0;
+	header[0] = type == ft_user_binary? 0x82 : 0x81; // FIN, opcode
+	if(deflated) header[0] |= 0x40; // RSV1 marks compressed messages
+	header[1] = 0;
 	if(len <= 125) header[1] |= aubyte(len);
 	else if(len < 64 * 1024) {
 		header[1] |= 126;
@@ -111,16 +140,22 @@ void Framer::EnqueueTextMessage(const char *msg, asizei len) {
 		memcpy_s(header + 2, sizeof(header) - 2, &extra, sizeof(extra));
 		hbytes += 8;
 	}
-	if(!server) {
-		throw std::exception("TODO: get 4 random bytes as mask key from some high-entropy, possibly hardware source!");
-	}
-	const asizei initial = outbound.size();
-	outbound.resize(initial + len + hbytes);
-	memcpy_s(outbound.data() + initial, outbound.size() - initial, header, hbytes);
-	memcpy_s(outbound.data() + initial + hbytes, outbound.size() - initial - hbytes, msg, len);
-	if(!server) {
-		throw std::exception("TODO: mask the octects being sent! (or just copy them by masking)");
-	}
+	const asizei initial = dst.size();
+	dst.resize(initial + len + hbytes);
+	memcpy_s(dst.data() + initial, dst.size() - initial, header, hbytes);
+	memcpy_s(dst.data() + initial + hbytes, dst.size() - initial - hbytes, msg, len);
+}
+
+
+void Framer::EnqueueFrames(const aubyte *frames, asizei count, asizei raw) {
+	if(closeFrame.payload.size() || count == 0) return; // see EnqueueTextMessage
+	if(!server) throw std::exception("Pre-built frames are unmasked, only servers can send them.");
+	const aubyte lenCode = frames[1] & 0x7F; // BuildFrame always produces a single unmasked frame
+	const asizei header = lenCode == 127? 10 : (lenCode == 126? 4 : 2);
+	traffic.messages++;
+	traffic.raw += raw;
+	traffic.sent += count - header;
+	outbound.insert(outbound.end(), frames, frames + count);
 }
 
 
@@ -149,10 +184,13 @@ aubyte* Framer::FrameDataUpdated(asizei got) {
 
 	const asizei valid = usedInbound + got;
 	if(valid && !usedInbound) {
-		// check for extension bits
-		if(inbound[0] & 0x70) throw std::exception("Extension bits set. Invalid packet."); //!< \todo too brittle! Throw a catch-able exception so client can be disconnected instead of crunching the server. Must fail the connection.
-		
+		// check for extension bits, RSV1 is permessage-deflate, only allowed on the first frame of data messages
 		const aubyte opcode = inbound[0] & 0x0F;
+		const bool rsv1 = (inbound[0] & 0x40) != 0;
+		if(inbound[0] & 0x30) throw std::exception("Extension bits set. Invalid packet."); //!< \todo too brittle! Throw a catch-able exception so client can be disconnected instead of crunching the server. Must fail the connection.
+		if(rsv1 && (!inflater || !firstFrame || opcode >= 0x08)) throw std::exception("Compressed bit set without permessage-deflate or on a wrong frame.");
+		if(firstFrame && opcode < 0x08) compressedMessage = rsv1;
+
 		if(firstFrame) head = MakeFT(opcode);
 		else {
 			/*! \todo Not true. A control opcode can be at any point in the frame stream, I should really check for that. I should really allow it to concatenate but this requires some additional logic.
@@ -4,6 +4,7 @@
  */
 #pragma once
 #include "../Network.h"
+#include "Deflate.h"
 #include <string>
 
 namespace ws {
@@ -30,6 +31,10 @@ public:
 
 	// In general, the functions below are valid only if you got a pointer out of either Read() or Next().
 
+	//! True if the message being received has been compressed by the peer, call Inflate on it once fully assembled.
+	bool IsCompressedMessage() const { return compressedMessage; }
+	void Inflate(std::vector<aubyte> &message, asizei maxSize) { inflater->Decompress(message, maxSize); }
+
 	//! Returns 0 if there's no frame being received or we haven't received enough bytes.
 	//! It is also possible for a frame to have 0 bytes of payload.
 	aulong GetPayloadLen() const { return plLen; }
@@ -75,9 +80,36 @@ public:
 	//! The application here on this peer has requested to shut down.
 	//! To do this, we must wait until the client replies with the shutdown packet.
 	void EnqueueClose(CloseReason r);
-	void EnqueueTextMessage(const char *msg, asizei len);
+	//! \param type Either ft_user_text or ft_user_binary.
+	void EnqueueMessage(FrameType type, const aubyte *msg, asizei len);
+	void EnqueueMessage(FrameType type, const std::string &str) { EnqueueMessage(type, reinterpret_cast<const aubyte*>(str.c_str()), str.length()); }
+	void EnqueueTextMessage(const char *msg, asizei len) { EnqueueMessage(ft_user_text, reinterpret_cast<const aubyte*>(msg), len); }
 	void EnqueueTextMessage(const std::string &str) { EnqueueTextMessage(str.c_str(), str.length()); }
 
+	/*! Servers sending the same message to many clients can frame it once with BuildFrame and then give the bytes to each connection.
+	Server frames are not masked so they are the same for everybody.
+	\param deflated Sets the permessage-deflate bit, msg must be already compressed. Only send those to connections which negotiated
+	the extension without context takeover or the peer would inflate using the wrong window. */
+	static void BuildFrame(std::vector<aubyte> &dst, FrameType type, const aubyte *msg, asizei len, bool deflated = false);
+	static void BuildTextFrame(std::vector<aubyte> &dst, const char *msg, asizei len, bool deflated = false) {
+		BuildFrame(dst, ft_user_text, reinterpret_cast<const aubyte*>(msg), len, deflated);
+	}
+	//! \param raw Message length before compression, for GetTraffic.
+	void EnqueueFrames(const aubyte *frames, asizei count, asizei raw);
+	void EnqueueFrames(const std::vector<aubyte> &frames, asizei raw) { EnqueueFrames(frames.data(), frames.size(), raw); }
+
+	//! Call after handshaking, before sending or receiving anything. Outbound messages longer than threshold are compressed from now on.
+	void EnableDeflate(const DeflateParams &params);
+	const DeflateParams& GetDeflate() const { return deflateParams; }
+
+	//! Payload bytes of the data messages enqueued so far.
+	struct Traffic {
+		aulong messages = 0;
+		aulong raw = 0; //!< as given by the caller
+		aulong sent = 0; //!< after compression
+	};
+	const Traffic& GetTraffic() const { return traffic; }
+
 	bool NeedsToSend() const;
 
 	enum WebSocketStatus {
@@ -110,6 +142,13 @@ private:
 	std::vector<aubyte> outbound;
 	asizei sentOut;
 
+	DeflateParams deflateParams;
+	std::unique_ptr<Deflater> deflater;
+	std::unique_ptr<Inflater> inflater;
+	std::vector<aubyte> compressing; //!< scratch buffer, kept to avoid reallocations
+	bool compressedMessage = false;
+	Traffic traffic;
+
 	static FrameType MakeFT(aubyte opcode);
 	asizei HeaderByteCount() const;
 
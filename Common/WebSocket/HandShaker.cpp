@@ -52,12 +52,17 @@ void HandShaker::Receive() {
 	//! \todo Send 426 upgrade required if this fails, WS protocol see page 23
 
 	// (8.) |Sec-WebSocket-Protocol| this is technically optional for some reason but it's really required IMHO
-	{
+	{	// Client lists them by preference.
 		std::vector<std::string> protocols(Split(GetHeaderValue(lines, "Sec-WebSocket-Protocol"), ','));
-		auto match = std::find(protocols.cbegin(), protocols.cend(), this->protocol);
+		auto match = std::find_if(protocols.cbegin(), protocols.cend(), [this](const std::string &test) {
+			return test == protocol || (alternate.length() && test == alternate);
+		});
 		if(match == protocols.cend()) 
 			throw std::exception("HTTP request missing valid \"Sec-WebSocket-Protocol\" header.");
+		selected = *match;
 	}
+	// (9.) |Sec-WebSocket-Extensions| optional, only permessage-deflate is supported
+	NegotiateDeflate(GetHeaderValue(lines, "Sec-WebSocket-Extensions"));
 	response = BuildResponse(key);
 }
 
@@ -143,12 +148,48 @@ std::string HandShaker::BuildResponse(const std::string &key) {
 	resp<<"Upgrade: websocket"<<CR<<LF;
 	resp<<"Connection: Upgrade"<<CR<<LF;
 	resp<<"Sec-WebSocket-Accept: "<<result.data()<<CR<<LF;
-	resp<<"Sec-WebSocket-Protocol: "<<protocol<<CR<<LF;
+	resp<<"Sec-WebSocket-Protocol: "<<selected<<CR<<LF;
+	if(deflate.enabled) resp<<"Sec-WebSocket-Extensions: "<<deflate.Response()<<CR<<LF;
 	resp<<CR<<LF;
     return resp.str();
 }
 
 
+void HandShaker::NegotiateDeflate(const std::string &offers) {
+	if(deflate.level <= 0) return;
+	for(const auto &offer : Split(offers, ',')) {
+		std::vector<std::string> params(Split(offer, ';'));
+		if(params.empty() || params[0] != "permessage-deflate") continue;
+		DeflateParams build(deflate);
+		bool good = true;
+		for(asizei loop = 1; loop < params.size() && good; loop++) {
+			const asizei eq = params[loop].find('=');
+			std::string name(params[loop].substr(0, eq)), value;
+			while(name.length() && LWS(name.back())) name.pop_back();
+			if(eq != std::string::npos) {
+				for(asizei cp = eq + 1; cp < params[loop].length(); cp++) {
+					if(params[loop][cp] != '"' && !LWS(params[loop][cp])) value += params[loop][cp];
+				}
+			}
+			if(name == "server_no_context_takeover") build.serverNoContextTakeover = true;
+			else if(name == "client_no_context_takeover") build.clientNoContextTakeover = true;
+			else if(name == "server_max_window_bits") {
+				const aint bits = atoi(value.c_str());
+				if(bits < 9 || bits > 15) good = false;
+				else build.serverMaxWindowBits = auint(bits);
+			}
+			else if(name == "client_max_window_bits") { } // we inflate with the biggest window anyway, no need to limit the client
+			else good = false; // unknown parameter, offer must be declined
+		}
+		if(good) {
+			build.enabled = true;
+			deflate = build;
+			return;
+		}
+	}
+}
+
+
 std::string HandShaker::GetHeaderValue(const std::vector<std::string> &lines, const char *name) {
 	std::string ret; // is "not there" the same thing as "empty"? Sure not for HTTP but for me it'll do for the time being!
 	for(asizei loop = 0; loop < lines.size(); loop++) {
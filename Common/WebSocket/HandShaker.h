@@ -7,6 +7,7 @@
 #include <string>
 #include <algorithm>
 #include "../hashing.h"
+#include "Deflate.h"
 #include <sstream>
 
 namespace ws {
@@ -24,8 +25,15 @@ class HandShaker {
 public:
 	static const asizei maxHeaderBytes;
 	const std::string protocol, resource;
-	HandShaker(Network::ConnectedSocketInterface &pipe, const std::string &protocolString, const std::string &uri)
-		: stream(pipe), used(0), protocol(protocolString), resource(uri), sent(0) { }
+	const std::string alternate; //!< another subprotocol the server can speak, possibly empty
+	/*! \param deflateLevel If nonzero, permessage-deflate is accepted if the client offers it. See DeflateParams.
+	\param alternateProtocol If the client lists this before protocolString it is selected instead, see GetProtocol. */
+	HandShaker(Network::ConnectedSocketInterface &pipe, const std::string &protocolString, const std::string &uri, aint deflateLevel = 0, asizei deflateThreshold = 64,
+	           const std::string &alternateProtocol = std::string())
+		: stream(pipe), used(0), protocol(protocolString), resource(uri), sent(0), alternate(alternateProtocol) {
+		deflate.level = deflateLevel;
+		deflate.threshold = deflateThreshold;
+	}
 
 	/*! Call this if the port has been signaled to have bytes to be read.
 	What it does: collect bytes till obtaining a proper HTTP header requesting switch to WebSockets and process it.
@@ -44,10 +52,17 @@ public:
 	//! \returns true if handshake completed and this object is no more necessary. Socket is now WebSocket protocol. Same value returned by previous Read() call.
 	bool Upgraded() { return response.length() > 0 && sent == response.length(); }
 
+	//! Extension agreed with the client, to be given to the Connection once Upgraded.
+	const DeflateParams& GetDeflate() const { return deflate; }
+
+	//! Subprotocol agreed with the client, either protocol or alternate. Empty until Receive has mangled the header.
+	const std::string& GetProtocol() const { return selected; }
+
 private:
     asizei ReadHeaderTerm(); //!< returns bytes to first char out of header, terminated by CR,LF,CR,LF
     void CheckGETRequest(const std::string &firstLine); //!< throws if syntax error
     std::string BuildResponse(const std::string &key);
+	void NegotiateDeflate(const std::string &offers); //!< picks the first permessage-deflate offer having parameters we understand
 
 	static const asizei headerIncrementBytes;
 	static const char CR, LF;
@@ -63,6 +78,8 @@ private:
 	std::string response; //!< Populated by Receive() as soon as
 	std::string key;
 	asizei sent;
+	DeflateParams deflate;
+	std::string selected;
 };
 
 }
@@ -136,9 +136,14 @@ LRESULT AsyncNotifyIconPumper::NotifyCallback(WORD msg, int x, int y) {
         BOOL dirty = TrackPopupMenu(asyncOwned.contextMenu, flags, x, y, 0, asyncOwned.windowHandle, NULL);
 		if(dirty > 0) { // otherwise user did not click, not supposed to be negative
 			dirty--;
-			std::unique_lock<std::mutex> lock(*mutex);
-			if(asizei(dirty) >= shared->commands.size()) throw std::exception("Command list incoherent?");
-			this->shared->commands[dirty].trigger = true;
+			std::function<void()> wakeup;
+			{
+				std::unique_lock<std::mutex> lock(*mutex);
+				if(asizei(dirty) >= shared->commands.size()) throw std::exception("Command list incoherent?");
+				this->shared->commands[dirty].trigger = true;
+				wakeup = this->shared->commandTriggered;
+			}
+			if(wakeup) wakeup();
 		}
 	    PostMessage(asyncOwned.windowHandle, WM_NULL, 0, 0);
 	}
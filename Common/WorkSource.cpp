@@ -9,9 +9,16 @@ bool WorkSource::Use(NetworkInterface::ConnectedSocketInterface *remote) {
     if(credentials.empty()) return false;
     pipe = remote;
     std::vector<std::pair<const char*, const char*>> meh(credentials.size());
+    std::vector<std::string> hinted(credentials.size());
     for(asizei cp = 0; cp < credentials.size(); cp++) {
         meh[cp].first = credentials[cp].first.c_str();
         meh[cp].second = credentials[cp].second.c_str();
+        if(passwordDiff > .0) {
+            hinted[cp] = credentials[cp].second;
+            if(hinted[cp].length()) hinted[cp] += ',';
+            hinted[cp] += "d=" + StratumState::FormatDifficulty(passwordDiff);
+            meh[cp].second = hinted[cp].c_str();
+        }
     }
     NewStratum(meh);
     return true;
@@ -27,6 +34,15 @@ void WorkSource::Disconnected() {
 void WorkSource::MangleReplyFromServer(size_t id, const rapidjson::Value &result, const rapidjson::Value &error) {
 	const char *sent = stratum->Response(id);
 	if(error.IsNull() == false) {
+		if(strcmp(sent, "mining.extranonce.subscribe") == 0) { // pools not supporting it complain about unknown method, which is fine
+			ScopedFuncCall clear([this, id]() { stratum->RequestReplyReceived(id, false); }); // so it's not counted as an error
+			stratum->Response(id, stratum::MiningExtranonceSubscribeResponse(false));
+			return;
+		}
+		if(strcmp(sent, "mining.suggest_difficulty") == 0) { // just a hint, same as above
+			stratum->RequestReplyReceived(id, false);
+			return;
+		}
 		ScopedFuncCall clear([this, id]() { stratum->RequestReplyReceived(id, true); });
 		std::string desc;
 		aint code;
@@ -55,6 +71,8 @@ void WorkSource::MangleReplyFromServer(size_t id, const rapidjson::Value &result
 		MangleResult(mangled, sent, id, result, MiningSubscribe());
 		MangleResult(mangled, sent, id, result, MiningAuthorize());
 		MangleResult(mangled, sent, id, result, MiningSubmit());
+		MangleResult(mangled, sent, id, result, MiningExtranonceSubscribe());
+		if(!mangled && strcmp(sent, "mining.suggest_difficulty") == 0) mangled = true; // whatever the result, nothing to do
 		if(!mangled) throw std::exception("unmatched response!");
 	}
 }
@@ -66,6 +84,7 @@ void WorkSource::MangleMessageFromServer(const std::string &idstr, const char *s
 	using namespace stratum::parsing;
 	MangleNotification(mangled, signature, paramArray, MiningSetDifficulty());
 	MangleNotification(mangled, signature, paramArray, MiningNotifyParser());
+	MangleNotification(mangled, signature, paramArray, MiningSetExtranonce());
 	MangleRequest(mangled, signature, idstr, paramArray, ClientGetVersion());
 	if(!mangled) throw std::exception("unmatched response!");
 }
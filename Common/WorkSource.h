@@ -35,6 +35,13 @@ public:
     //! This call instead destroys the internal stratum state and gives up the previous socket. From now on, the pool is "inactive" until next Use()
     void Disconnected();
 
+    /*! Pools supporting the "d=" password convention will start next connection from this difficulty. Takes effect on next Use().
+    0 (default) sends passwords as they are. */
+    void SetPasswordDifficulty(adouble diff) { passwordDiff = diff; }
+
+    //! \sa StratumState::SuggestDifficulty, ignored if not connected
+    void SuggestDifficulty(adouble diff) { if(stratum) stratum->SuggestDifficulty(diff); }
+
 	//! This function gets called by MangleError.
 	std::function<void(const WorkSource &pool, asizei index, int errorCode, const std::string &message)> errorCallback;
 
@@ -53,6 +60,7 @@ public:
 private:
 	NetworkInterface::ConnectedSocketInterface *pipe = nullptr; //! this is supposed to be const (in the sense you don't mess up with it), owned by some other code.
     std::vector< std::pair<std::string, std::string> > credentials;
+    adouble passwordDiff = .0;
 
 	template<typename Parser>
 	void MangleResult(bool &processed, const char *originally, size_t id, const rapidjson::Value &object, Parser &parser) {
@@ -84,6 +92,17 @@ private:
 		processed = true;
 	}
 
+	/*! mining.notify is the most frequent and by far the biggest message so it's decoded into persistent storage instead of a new object.
+	Both this and the stratum state keep their vectors around so after a few jobs they're not reallocated anymore. */
+	stratum::MiningNotify notified;
+	void MangleNotification(bool &processed, const char *methodName, const rapidjson::Value &paramsArray, stratum::parsing::MiningNotifyParser &parser) {
+		if(processed) return;
+		if(parser.name != methodName) return;
+		parser.Mangle(notified, paramsArray);
+		stratum->Notify(notified);
+		processed = true;
+	}
+
 protected:
 	void MangleReplyFromServer(size_t id, const rapidjson::Value &result, const rapidjson::Value &error);
 	void MangleMessageFromServer(const std::string &idstr, const char *signature, const rapidjson::Value &notification);
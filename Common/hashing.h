@@ -5,6 +5,7 @@
 #pragma once
 #include <array>
 #include "AREN/SerializationBuffers.h"
+#include "SHA256Backends.h"
 
 
 namespace hashing {
@@ -93,13 +94,6 @@ public:
 template<typename LenType>
 class VariableLengthSHA256 : public AbstractSHA_bits<256, LenType> {
 private:
-	static auint SigmaO(auint v) { return _rotr(v,  7) ^ _rotr(v, 18) ^    (v >>  3); };
-	static auint SigmaI(auint v) { return _rotr(v, 17) ^ _rotr(v, 19) ^    (v >> 10); };
-	static auint SumO(auint v)   { return _rotr(v,  2) ^ _rotr(v, 13) ^ _rotr(v, 22); };
-	static auint SumI(auint v)   { return _rotr(v,  6) ^ _rotr(v, 11) ^ _rotr(v, 25); };
-	static auint Ch(auint x, auint y, auint z)  { return (x & y) ^ (~x & z); };
-	static auint Maj(auint x, auint y, auint z) { return (x & y) ^ ( x & z) ^ (y & z); };
-
 	std::array<auint, 8> GetIV() const {
 		std::array<auint, 8> hstart;
 		hstart[0] = 0x6a09e667; //2^32 times the square root of the first 8 primes 2..19
@@ -113,46 +107,10 @@ private:
 		return hstart;
 	}
 public:
+	//! Goes to SHA extensions when available. \sa sha256::Select
 	void BlockProcessing(const aubyte *chunk) {
-		const auint K[64] = {
-			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-		};
-		std::array<auint, 64> w;
-		const auint *cbytes = reinterpret_cast<const auint*>(chunk);
-		for(size_t cp = 0; cp < 16; cp++) w[cp] = HTON(cbytes[cp]);
-		for(size_t cp = 16; cp < 64; cp++) {
-			auint so = SigmaO(w[cp - 15]);
-			auint si = SigmaI(w[cp -  2]);
-			w[cp] = w[cp - 16] + so + w[cp - 7] + si;
-		}
-		auint a = h[0],  b  = h[1];
-		auint c = h[2],  d  = h[3];
-		auint e = h[4],  f  = h[5];
-		auint g = h[6],  hp = h[7];
-		for(size_t inner = 0; inner < 64; inner++) {
-			auint t1 = hp + SumI(e) + Ch(e, f, g) + K[inner] + w[inner];
-			auint t2 = SumO(a) + Maj(a, b, c);
-			hp = g;
-			g = f;
-			f = e;
-			e = d + t1;
-			d = c;
-			c = b;
-			b = a;
-			a = t1 + t2;
-		}
-		// Add the hash to result so far.
-		h[0] += a;  h[1] += b;
-		h[2] += c;  h[3] += d;
-		h[4] += e;	h[5] += f;
-		h[6] += g;	h[7] += hp;
+		static const sha256::Compressor compress = sha256::Select();
+		compress(h.data(), chunk);
 		bytesProcessed += 16 * sizeof(auint);
 	}
 	VariableLengthSHA256() { Restart(); }
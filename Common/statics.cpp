@@ -10,5 +10,8 @@ special variables in a single place so they can be monitored more easily. */
 #include "Network.h"
 
 
+#if defined(_WIN32)
 std::unique_ptr< std::map<int, SockErr> > WindowsNetwork::errMap;
+#endif
 size_t NetworkInterface::connectionTimeoutSeconds = 30;
+size_t NetworkInterface::connectionAttemptDelayMs = 250;
@@ -4,6 +4,7 @@
  * For conditions of distribution and use, see the LICENSE or hit the web.
  */
 #include "AbstractAlgorithm.h"
+#include <algorithm>
 
 
 void AbstractAlgorithm::DescribeResources(std::vector<ConfigDesc::MemDesc> &desc, const std::vector<ResourceRequest> &resources) {
@@ -36,6 +37,91 @@ void AbstractAlgorithm::DescribeResources(std::vector<ConfigDesc::MemDesc> &desc
 }
 
 
+aulong AbstractAlgorithm::DescribeResources(std::vector<ConfigDesc::MemDesc> &desc, const std::vector<ResourceRequest> &res, const std::vector<KernelRequest> &kern) {
+    DescribeResources(desc, res);
+    auto groups(PlanAliasing(res, kern));
+    // desc skips immediates, so I need to remap.
+    std::vector<asizei> descIndex(res.size());
+    for(asizei loop = 0, slot = 0; loop < res.size(); loop++) descIndex[loop] = res[loop].immediate? asizei(-1) : slot++;
+    aulong saved = 0;
+    for(const auto &group : groups) {
+        for(asizei loop = 1; loop < group.members.size(); loop++) {
+            auto &entry(desc[descIndex[group.members[loop]]]);
+            saved += entry.bytes;
+            entry.bytes = 0;
+            entry.flags.push_back("aliased");
+        }
+    }
+    return saved;
+}
+
+
+std::vector<AbstractAlgorithm::AliasGroup> AbstractAlgorithm::PlanAliasing(const std::vector<ResourceRequest> &res, const std::vector<KernelRequest> &kern) {
+    const cl_mem_flags hostFlags = CL_MEM_USE_HOST_PTR | CL_MEM_ALLOC_HOST_PTR | CL_MEM_COPY_HOST_PTR;
+    struct Lifetime {
+        asizei resource;
+        asizei first = asizei(-1), last = 0;
+    };
+    std::vector<Lifetime> candidates;
+    for(asizei loop = 0; loop < res.size(); loop++) {
+        const auto &check(res[loop]);
+        if(check.immediate || check.initialData || check.imageDesc.image_width) continue;
+        if(check.memFlags & hostFlags) continue;
+        Lifetime add;
+        add.resource = loop;
+        for(asizei k = 0; k < kern.size(); k++) {
+            auto params(SplitParams(kern[k].params));
+            if(std::find(params.cbegin(), params.cend(), check.name) == params.cend()) continue;
+            if(add.first == asizei(-1)) add.first = k;
+            add.last = k;
+        }
+        if(add.first != asizei(-1)) candidates.push_back(add); // unused buffers are really a bug in algorithm description, leave them alone
+    }
+    // Greedy: biggest buffers first so they provide the allocation, then pack everything else.
+    std::sort(candidates.begin(), candidates.end(), [&res](const Lifetime &one, const Lifetime &two) {
+        return res[one.resource].bytes > res[two.resource].bytes;
+    });
+    std::vector<std::vector<Lifetime>> packed;
+    for(const auto &el : candidates) {
+        auto fits = [&res, &el](const std::vector<Lifetime> &group) {
+            if(res[group[0].resource].memFlags != res[el.resource].memFlags) return false;
+            for(const auto &test : group) {
+                if(el.first <= test.last && test.first <= el.last) return false;
+            }
+            return true;
+        };
+        auto dst(std::find_if(packed.begin(), packed.end(), fits));
+        if(dst != packed.end()) dst->push_back(el);
+        else packed.push_back(std::vector<Lifetime>(1, el));
+    }
+    std::vector<AliasGroup> ret;
+    for(const auto &group : packed) {
+        if(group.size() < 2) continue;
+        AliasGroup add;
+        add.bytes = res[group[0].resource].bytes;
+        for(const auto &el : group) add.members.push_back(el.resource);
+        ret.push_back(std::move(add));
+    }
+    return ret;
+}
+
+
+std::vector<std::string> AbstractAlgorithm::SplitParams(const std::string &params) {
+    std::vector<std::string> ret;
+    asizei begin = 0;
+    while(begin <= params.length()) {
+        asizei end = params.find(',', begin);
+        if(end == std::string::npos) end = params.length();
+        asizei first = begin, last = end;
+        while(first < last && params[first] == ' ') first++;
+        while(last > first && params[last - 1] == ' ') last--;
+        ret.push_back(params.substr(first, last - first));
+        begin = end + 1;
+    }
+    return ret;
+}
+
+
 void AbstractAlgorithm::RunAlgorithm(cl_command_queue q, asizei amount) {
     for(asizei loop = 0; loop < kernels.size(); loop++) {
         const auto &kern(kernels[loop]);
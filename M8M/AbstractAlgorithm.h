@@ -88,9 +88,11 @@ public:
     const asizei hashCount;
     const asizei uintsPerHash; /*!< Mining algorithms should use the following format for the result buffer (buffer of uints):
         [0] amount of candidate nonces found, let's call it candCount.
+        [1] generation, copied from $dispatchData[3] by whoever writes a candidate. Used to reject stale results.
         Candidate[candCount], where the Candidate structure is
             uint nonce;
             uint hash[uintsPerHash]
+        Only the first $dispatchData[4] candidates are to be stored but candCount must keep counting so overflows can be detected.
         It is strongly suggested they produce an hash out so it can be checked for validity. */
 
     //! Implementations don't load from disk anymore. Instead, they request an handle to a persistent, RO buffer of data.
@@ -170,6 +172,18 @@ public:
         std::string params;
     };
 
+    /*! Many algorithms start by hashing the 80-byte block header in 64-byte blocks. The first block does not contain the nonce so its
+    contribution (the "midstate") does not change while scanning nonces: it can be computed once per header on the host instead of once
+    per hash. Kernels then only process the nonce-dependent tail. */
+    enum class MidstateKind {
+        none, //!< kernels process the whole header, no midstate is computed.
+        sha256 //!< SHA-256 state after the first 64 header bytes, as 8 uints in the same order used by SHA256_transform in kernels.
+    };
+
+    /*! Host precompute hook, called by dispatchers every time the header changes.
+    \returns false if this algorithm does not use a midstate, in this case state is left untouched. */
+    virtual bool Midstate(std::array<auint, 8> &state, const std::array<aubyte, 80> &header) const { return false; }
+
     //! If this returns true you're supposed to not dispatch any more work but rather upload new hash data and restart scanning hashes from 0.
     bool Overflowing() const { return nonceBase + hashCount > std::numeric_limits<auint>::max(); };
 
@@ -196,10 +210,29 @@ public:
             explicit MemDesc() : memoryType(as_device), bytes(0) { }
         };
         std::vector<MemDesc> memUsage;
-        explicit ConfigDesc() : hashCount(0) { }
+        aulong aliasingSavings; //!< bytes not allocated thanks to PlanAliasing, already accounted in memUsage
+        explicit ConfigDesc() : hashCount(0), aliasingSavings(0) { }
     };
     static void DescribeResources(std::vector<ConfigDesc::MemDesc> &desc, const std::vector<ResourceRequest> &res);
 
+    /*! Same as above, but also considers buffer aliasing. Aliased buffers get flagged and don't count towards memory consumption.
+    \returns Amount of bytes saved by aliasing. */
+    static aulong DescribeResources(std::vector<ConfigDesc::MemDesc> &desc, const std::vector<ResourceRequest> &res, const std::vector<KernelRequest> &kern);
+
+    /*! Multi-step algorithms often use intermediate buffers for a few kernels only. Their lifetime is known by looking at the kernel parameters:
+    a buffer is alive from the first to the last kernel referencing it. Buffers whose lifetimes don't overlap can share the same allocation.
+    Only buffers which are device-only scratch are considered: no images, no initial data, no host pointers. They must also have the same
+    memory flags to share. Note this assumes scratch buffers are written before being read in every algorithm iteration.
+    \returns A list of groups. Each group counts at least two members, all aliasing the same allocation. */
+    struct AliasGroup {
+        asizei bytes = 0; //!< size of the shared allocation, that is, the biggest member footprint
+        std::vector<asizei> members; //!< indices in the resource array, members[0] is the biggest and provides the allocation
+    };
+    static std::vector<AliasGroup> PlanAliasing(const std::vector<ResourceRequest> &res, const std::vector<KernelRequest> &kern);
+
+    //! Kernel parameter bindings are a comma separated list of names. Blanks around names are trimmed.
+    static std::vector<std::string> SplitParams(const std::string &params);
+
 protected:
     /*! \param ctx OpenCL context used for creating kernels and resources. Kernels take a while to build and are very small so they can be shared
                    across devices... but they currently don't.
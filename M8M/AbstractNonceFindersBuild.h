@@ -26,16 +26,20 @@ public:
     mangled by the various dispatchers. In other words, given an arbitrary registered source S, producing work W, dispatching W to an arbitrary Dispatcher D
     is a valid operation producing good results.
     Those calls must come first and before any call to InitWorkQueue(...). */
-    bool RegisterWorkProvider(const AbstractWorkSource &src){
+    bool RegisterWorkProvider(const AbstractWorkSource &src, const PoolInfo::Scheduling &sched = PoolInfo::Scheduling()){
         const void *key = &src; // I drop all type information so I don't run the risk to try access this async
         auto compare = [key](const CurrentWork &test) { return test.owner == key; };
         if(std::find_if(owners.cbegin(), owners.cend(), compare) != owners.cend()) return false; // already added. Not sure if this buys anything but not a performance path anyway
         CurrentWork source(src.diffMul);
         source.owner = key;
+        source.scheduling = sched;
         owners.push_back(std::move(source));
         return true;
     }
 
+    //! Select how devices pick pools. Like RegisterWorkProvider, must be called before starting the mining threads. Default is ps_failover.
+    virtual void SetPoolScheduling(PoolScheduling policy) = 0;
+
     struct AlgoBuild {
         SignedAlgoIdentifier identifier;
         std::vector<AbstractAlgorithm::ResourceRequest> res;
@@ -44,6 +48,7 @@ public:
         cl_context ctx;
         cl_device_id dev;
         asizei candHashUints = 0;
+        AbstractAlgorithm::MidstateKind midstate = AbstractAlgorithm::MidstateKind::none;
     };
 
     /*! Initialize a mining thread using the passed device. Contents of the own parameter will be moved to internal memory. */
@@ -74,6 +79,15 @@ public:
     It is assumed iterations always take at least one microseconds. Elapsed=0 can be used to signal device going to sleep. */
     std::function<void(asizei devIndex, bool found, std::chrono::microseconds elapsed)> onIterationCompleted;
 
+    /*! Called asynchronously when a device got new work after the pool it was mining for withdrew its work (not just replaced it with a new job).
+    Pools are identified by the same keys as RegisterWorkProvider. to can be equal to from if no other pool had work to give.
+    gap is the time the device went without valid work. */
+    std::function<void(asizei devIndex, const void *from, const void *to, std::chrono::microseconds gap)> onFailover;
+
+    /*! Called asynchronously after new results have been queued so the main thread can wake up and pull them with ResultsFound
+    instead of polling. */
+    std::function<void()> onResults;
+
     // Those are not really part of initialization but the class is still fairly easy.
     bool SetDifficulty(const AbstractWorkSource &from, const stratum::WorkDiff &diff) {
         std::unique_lock<std::mutex> lock(guard);
@@ -91,6 +105,19 @@ public:
         match->factory = factory.release();
         return true;
     }
+    bool SetShareCounts(const AbstractWorkSource &from, aulong accepted, aulong rejected) {
+        std::unique_lock<std::mutex> lock(guard);
+        auto match(std::find_if(owners.begin(), owners.end(), [&from](const CurrentWork &test) { return test.owner == &from; }));
+        if(match == owners.end()) return false;
+        match->accepted = accepted;
+        match->rejected = rejected;
+        return true;
+    }
+    aulong GetHashCount(const AbstractWorkSource &from) const {
+        std::unique_lock<std::mutex> lock(guard);
+        auto match(std::find_if(owners.cbegin(), owners.cend(), [&from](const CurrentWork &test) { return test.owner == &from; }));
+        return match != owners.cend()? match->hashes : 0;
+    }
 
 
     bool ResultsFound(NonceOriginIdentifier &src, VerifiedNonces &nonces) {
@@ -170,7 +197,15 @@ protected:
         PoolInfo::DiffMultipliers diffMul;
         stratum::WorkDiff workDiff;
         stratum::AbstractWorkFactory *factory; //! this is owned by the usedFactories std::map, which keeps them reference-counted
+        PoolInfo::Scheduling scheduling;
+        aulong hashes = 0; //!< scanned by all devices using work from this pool, updated by the mining threads
+        aulong accepted = 0, rejected = 0; //!< from SetShareCounts
         CurrentWork(PoolInfo::DiffMultipliers multipliers) : diffMul(multipliers), factory(nullptr) { }
+
+        bool Allows(asizei device) const {
+            const auto &list(scheduling.devices);
+            return list.empty() || std::find(list.cbegin(), list.cend(), auint(device)) != list.cend();
+        }
     };
     template<typename Type>
     struct RefCounted {
@@ -51,6 +51,7 @@ public:
     - "$wuData" is the 80-bytes block header to hash. Yes, 80 bytes, even though we overwrite the last 4 (most of the time).
     - "$dispatchData" contains "other stuff" including targetbits... note those are probably going to be refactored as well.
     - "$candidates" is the resulting nonce buffer.
+    - "$midstate" is the hash state after the first 64 bytes of "$wuData", computed on the host. \sa AbstractAlgorithm::Midstate
     Those can be bound early or dinamically, there's no requirement. */
     bool SpecialValue(SpecialValueBinding &desc, const std::string &name) const {
         for(auto test : specials) {
@@ -5,13 +5,14 @@
 #include "AbstractWSServer.h"
 
 
-const auint AbstractWSServer::maxClients = 5;
+const auint AbstractWSServer::MAX_CLIENTS_LIMIT = 4000;
 
 
 void AbstractWSServer::FillSleepLists(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
     if(!landing) return;  // it is always shut down after everything else so if that happens nothing is there for sure.
     if(shutdownInitiated == TimePoint()) toRead.push_back(landing); // not going to accept this anymore if shutting down
-    std::for_each(clients.cbegin(), clients.cend(), [&toRead, &toWrite](const ClientState &ua) {
+    for(const auto &entry : clients) {
+        const ClientState &ua(entry.second);
         if(ua.initializer) {
             if(ua.initializer->NeedsToSend()) toWrite.push_back(&ua.conn.get());
             else toRead.push_back(&ua.conn.get());
@@ -20,7 +21,7 @@ void AbstractWSServer::FillSleepLists(std::vector<Network::SocketInterface*> &to
             if(ua.ws->NeedsToSend()) toWrite.push_back(&ua.conn.get());
             else toRead.push_back(&ua.conn.get());
         }
-    });
+    }
 }
 
 
@@ -34,32 +35,25 @@ void AbstractWSServer::Refresh(std::vector<Network::SocketInterface*> &toRead, s
     }
     else {
         pushing.clear();
-        auto destroy = [this](asizei &index) {
-            clients[index].ws.reset();
-            network.CloseConnection(clients[index].conn);
-            clients.erase(clients.begin() + index);
-            index--;
+        auto destroy = [this](std::map<const Network::SocketInterface*, ClientState>::iterator &client) {
+            CloseConnection(client->second);
+            client = clients.erase(client);
         };
-        for(asizei loop = 0; loop < clients.size(); loop++) {
-            ClientState &client(clients[loop]);
-            if(client.initializer) {
-                client.initializer.reset();
-                network.CloseConnection(client.conn);
-                clients.erase(clients.begin() + loop);
-                loop--;
-            }
+        for(auto client = clients.begin(); client != clients.end(); ) {
+            if(client->second.initializer) destroy(client);
             else { // client.ws
-                switch(client.ws->GetStatus()) {
-                case ws::Connection::wss_operational: client.ws->EnqueueClose(ws::Connection::cr_away); break;
-                case ws::Connection::wss_closed: destroy(loop); break;
+                switch(client->second.ws->GetStatus()) {
+                case ws::Connection::wss_operational: client->second.ws->EnqueueClose(ws::Connection::cr_away); break;
+                case ws::Connection::wss_closed: destroy(client); continue;
                 }
+                ++client;
             }
         }
         ReadWrite(toRead, toWrite); // We still have to send all the close requests and get their confirms...
 
         // Oh wait! Above we played nice. But if a peer is not nice to us, we are not nice to it and kill TCP conn.
         if(shutdownInitiated < std::chrono::system_clock::now() - std::chrono::seconds(5)) {
-            for(asizei loop = clients.size() - 1; loop < clients.size(); loop--) destroy(loop);
+            for(auto client = clients.begin(); client != clients.end(); ) destroy(client);
         }
         if(clients.size() == 0) { // Now all the clients are gone, shut down the listening socket.
             network.CloseServiceSocket(*landing);
@@ -73,6 +67,9 @@ void AbstractWSServer::Refresh(std::vector<Network::SocketInterface*> &toRead, s
 
 void AbstractWSServer::Listen() {
     if(!landing) {
+        #if defined(_DEBUG)
+        CheckDeltaPushes();
+        #endif
         landing = &network.NewServiceSocket(port, maxClients);
         shutdownInitiated = TimePoint();
         if(serviceStateCallback) serviceStateCallback(true);
@@ -81,42 +78,36 @@ void AbstractWSServer::Listen() {
 
 
 void AbstractWSServer::ReadWrite(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
-    // First thing to do: serve already connected websockets. We first consume, then send.
+    // Sockets are looked up by handle, the lists can be long when many clients are connected. We first consume, then send.
     for(const auto &skt : toRead) {
-        auto el = std::find(clients.begin(), clients.end(), skt);
-        if(el == clients.cend()) continue; // either not mine or landing socket
-        if(el->initializer) continue; // Upgrading socket state later.
-        std::vector<ws::Connection::Message> msg;
-        if(!el->ws->Read(msg)) continue;
-        Mangle(*el, msg, *skt);
-    }
-    for(const auto &skt : toWrite) {
-        auto el = std::find(clients.begin(), clients.end(), skt);
-        if(el == clients.cend()) continue;
-        if(el->initializer) continue;
-        if(el->ws->NeedsToSend()) el->ws->Send();
-    }
-    // Now same read-write thing for sockets handshaking.
-    for(auto &client : clients) {
-        auto r = std::find(toRead.begin(), toRead.end(), &client.conn.get());
-        auto w = std::find(toWrite.begin(), toWrite.end(), &client.conn.get());
-        if(r == toRead.end() && w == toWrite.end()) continue;
-        if(client.ws) continue; // this one is for HTTP->WS upgrade, already mangled above
+        auto el = clients.find(skt);
+        if(el == clients.end()) continue; // either not mine or landing socket
+        if(el->second.initializer) el->second.initializer->Receive(); // HTTP->WS upgrade, mangled later
         else {
-            if(r != toRead.end()) client.initializer->Receive();
-            if(w != toWrite.end()) client.initializer->Send();
+            std::vector<ws::Connection::Message> msg;
+            if(!el->second.ws->Read(msg)) continue;
+            Mangle(el->second, msg, *skt);
         }
     }
+    for(const auto &skt : toWrite) {
+        auto el = clients.find(skt);
+        if(el == clients.end()) continue;
+        if(el->second.initializer) el->second.initializer->Send();
+        else if(el->second.ws->NeedsToSend()) el->second.ws->Send();
+    }
 }
 
 
 void AbstractWSServer::UpgradeConnect(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
-    std::for_each(clients.begin(), clients.end(), [this](ClientState &client) {
+    for(auto &entry : clients) {
+        ClientState &client(entry.second);
         if(client.initializer && client.initializer->Upgraded()) {
             client.ws.reset(new ws::Connection(client.conn, true));
+            client.ws->EnableDeflate(client.initializer->GetDeflate());
+            client.binary = binaryProtocol.length() && client.initializer->GetProtocol() == binaryProtocol;
             client.initializer.reset();
         }
-    });
+    }
     // Last pick up new connections (only if not shutting down).
     auto newPeer = std::find(toRead.begin(), toRead.end(), landing);
     if(newPeer != toRead.end()) {
@@ -124,9 +115,9 @@ void AbstractWSServer::UpgradeConnect(std::vector<Network::SocketInterface*> &to
         if(clients.size() >= maxClients || shutdownInitiated != TimePoint()) network.CloseConnection(pipe); // or maybe I could not even allow it - I would keep getting waken up
         else {
             ScopedFuncCall destroy([&pipe, this]() { network.CloseConnection(pipe); });
-            std::unique_ptr<ws::HandShaker> init(new ws::HandShaker(pipe, wsProtocol.c_str(), resURI.c_str()));
-            clients.push_back(ClientState(pipe));
-            clients.back().initializer = std::move(init);
+            std::unique_ptr<ws::HandShaker> init(new ws::HandShaker(pipe, wsProtocol.c_str(), resURI.c_str(), deflateLevel, deflateThreshold, binaryProtocol));
+            auto added(clients.insert(std::make_pair(&pipe, ClientState(pipe))));
+            added.first->second.initializer = std::move(init);
             destroy.Dont();
             if(this->clientConnectionCallback) this->clientConnectionCallback(1, clients.size());
         }
@@ -137,39 +128,37 @@ void AbstractWSServer::UpgradeConnect(std::vector<Network::SocketInterface*> &to
 void AbstractWSServer::Unsubscribe(const std::string &commandName, const std::string &stream) {
     const Network::SocketInterface *processing = this->processing;
     if(!processing) return; // impossible
-    auto list = std::find_if(pushing.begin(), pushing.end(), [processing](const PushList &test) { return test.dst == processing; });
-    if(list == pushing.end()) return; // this client had no pushes active
     auto cmdMatch = commands.find(commandName);
     if(cmdMatch == commands.cend()) return; // maybe this would be worth an exception?
-    const commands::AbstractCommand *command = cmdMatch->second.get();
-    for(asizei loop = 0; loop < list->active.size(); loop++) {
-        if(list->active[loop]->originator != command) continue;
-        if(stream.empty() || stream == list->active[loop]->name) {
-            list->active.erase(list->active.begin() + loop);
-            loop--;
-            if(stream.length()) break;
-        }
-    }
+    DropSubscriber(processing, cmdMatch->second.get(), stream);
+}
+
 
+void AbstractWSServer::DropSubscriber(const Network::SocketInterface *dst, const commands::AbstractCommand *originator, const std::string &stream) {
+    for(asizei loop = pushing.size() - 1; loop < pushing.size(); loop--) {
+        NamedPush &push(*pushing[loop]);
+        if(originator && push.originator != originator) continue;
+        auto gone = std::remove_if(push.subscribers.begin(), push.subscribers.end(), [dst, &stream](const Subscriber &test) {
+            return test.dst == dst && (stream.empty() || stream == test.name);
+        });
+        push.subscribers.erase(gone, push.subscribers.end());
+        if(push.subscribers.empty()) pushing.erase(pushing.begin() + loop);
+    }
 }
 
 
 void AbstractWSServer::PurgeClosedConnections() {
     // First of all, no matter what, get the rid of all sockets which are closed: they would piss off our logic big way.
-    for(asizei loop = clients.size() - 1; loop < clients.size(); loop--) {
-        bool garbage = clients[loop].ws && clients[loop].ws->GetStatus() == ws::Connection::wss_closed;
-        garbage |= clients[loop].conn.get().Works() == false;
+    for(auto client = clients.begin(); client != clients.end(); ) {
+        bool garbage = client->second.ws && client->second.ws->GetStatus() == ws::Connection::wss_closed;
+        garbage |= client->second.conn.get().Works() == false;
         if(garbage) {
-            for(asizei rem = 0; rem < pushing.size(); rem++) {
-                if(pushing[rem].dst == &clients[loop].conn.get()) {
-                    pushing.erase(pushing.begin() + rem);
-                    break;
-                }
-            }
-            network.CloseConnection(clients[loop].conn);
-            clients.erase(clients.begin() + loop);
+            DropSubscriber(client->first, nullptr, std::string());
+            CloseConnection(client->second);
+            client = clients.erase(client);
             if(clientConnectionCallback) clientConnectionCallback(-1, clients.size());
         }
+        else ++client;
     }
     //! \todo The handshake can also fail... but I have no way to know currently.
     //! In fact, I should consider it failing after a while even if the handshake is not really failing...
@@ -178,34 +167,228 @@ void AbstractWSServer::PurgeClosedConnections() {
 
 
 void AbstractWSServer::EnqueuePushData() {
-    // Now give all the possibility to produce new data... which will never be sent if we closed but who cares!
-    std::for_each(pushing.cbegin(), pushing.cend(), [this](const PushList &mangle) {
-        using namespace rapidjson;
-        for(asizei loop = 0; loop < mangle.active.size(); loop++) {
-            Document send;
-            if(mangle.active[loop]->pusher->Refresh(send)) {
-                Document ret;
-                ret.SetObject();
-                const std::string &ori(mangle.active[loop]->originator->name);
-                ret.AddMember("pushing", StringRef(ori.c_str()), ret.GetAllocator());
-                if(mangle.active[loop]->originator->GetMaxPushing() > 1) ret.AddMember("stream", StringRef(mangle.active[loop]->name.c_str()), ret.GetAllocator());
-                ret.AddMember("payload", send, ret.GetAllocator());
-                auto sink = std::find_if(clients.cbegin(), clients.cend(), [&mangle](const ClientState &test) {
-                    return &test.conn.get() == mangle.dst && test.ws.get();
-                });
-                if(sink != clients.cend()) {
-                    rapidjson::StringBuffer pretty;
-                    #if _DEBUG
-                    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(pretty, nullptr);
-                    #else
-                    rapidjson::Writer<rapidjson::StringBuffer> writer(pretty, nullptr);
-                    #endif
-                    ret.Accept(writer);
-                    sink->ws->EnqueueTextMessage(pretty.GetString(), pretty.GetSize());
+    // Each pusher is refreshed once, its payload serialized once per encoding and then copied to all its subscribers.
+    using namespace rapidjson;
+    const TimePoint now(std::chrono::system_clock::now());
+    for(const auto &push : pushing) {
+        if(now < push->lastSent + push->minInterval) continue; // not refreshed so changes accumulate till next time
+        std::unique_ptr<Document> send(new Document);
+        Document diff;
+        const bool changed = Pull(*push, *send, diff);
+        bool resync = false, text = false, binary = false;
+        for(const auto &dst : push->subscribers) {
+            resync |= dst.full;
+            (dst.binary? binary : text) = true;
+        }
+        resync = push->delta? resync : changed;
+        for(auto &delta : variants) {
+            for(auto &encoding : delta) encoding.clear();
+        }
+        if(resync && text) variants[0][0].payload = Serialize(*send);
+        if(resync && binary) commands::cbor::Encode(variants[0][1].payload, *send);
+        if(push->delta && changed && text) variants[1][0].payload = Serialize(diff);
+        if(push->delta && changed && binary) commands::cbor::Encode(variants[1][1].payload, diff);
+        if(push->delta) push->last = std::move(send);
+        if(!resync && !changed) continue; // refreshed but nothing really changed
+        push->lastSent = now;
+        const bool named = push->originator->GetMaxPushing() > 1;
+        if(!named) {
+            for(aint delta = 0; delta < 2; delta++) {
+                for(aint bin = 0; bin < 2; bin++) {
+                    PushVariant &build(variants[delta][bin]);
+                    if(build.payload.length()) build.message = PushMessage(push->originator->name, nullptr, delta != 0, build.payload, bin != 0);
                 }
             }
         }
-    });
+        for(auto &dst : push->subscribers) {
+            const bool full = dst.full || !push->delta;
+            dst.full = false;
+            if(full? !resync : !changed) continue;
+            auto sink = clients.find(dst.dst);
+            if(sink == clients.end() || !sink->second.ws) continue;
+            PushVariant &use(variants[full? 0 : 1][dst.binary? 1 : 0]);
+            if(named) {
+                const std::string message(PushMessage(push->originator->name, &dst.name, !full, use.payload, dst.binary));
+                sink->second.ws->EnqueueMessage(dst.binary? ws::Connection::ft_user_binary : ws::Connection::ft_user_text, message);
+            }
+            else EnqueueShared(*sink->second.ws, use.message, use.frames, dst.binary);
+        }
+    }
+}
+
+
+bool AbstractWSServer::Pull(NamedPush &push, rapidjson::Document &now, rapidjson::Document &patch) {
+    if(!push.delta) return push.pusher->Refresh(now, false);
+    // Pushers usually only produce what changed since their previous output, which is not a state to diff against.
+    push.pusher->Refresh(now, true);
+    return push.last && Diff(patch, *push.last, now, patch.GetAllocator());
+}
+
+
+#if defined(_DEBUG)
+void AbstractWSServer::CheckDeltaPushes() {
+    // Behaves like the real pushers: only what changed unless asked for the whole state.
+    struct Counters : commands::PushInterface {
+        aint values[3] = { 1, 2, 3 };
+        aint sent[3] = { 0, 0, 0 };
+        bool Refresh(rapidjson::Document &out, bool whole) {
+            const char *names[3] = { "a", "b", "c" };
+            out.SetObject();
+            for(asizei loop = 0; loop < 3; loop++) {
+                if(!whole && values[loop] == sent[loop]) continue;
+                out.AddMember(rapidjson::StringRef(names[loop]), values[loop], out.GetAllocator());
+                sent[loop] = values[loop];
+            }
+            return out.MemberCount() != 0;
+        }
+    };
+    NamedPush push;
+    push.delta = true;
+    push.pusher.reset(new Counters);
+    Counters &src(static_cast<Counters&>(*push.pusher));
+    push.last.reset(new rapidjson::Document);
+    src.Refresh(*push.last, true); // the reply
+    for(aint round = 0; round < 2; round++) {
+        src.values[1] += 10;
+        std::unique_ptr<rapidjson::Document> now(new rapidjson::Document);
+        rapidjson::Document patch;
+        const bool changed = Pull(push, *now, patch);
+        if(!changed || patch.MemberCount() != 1 || !patch.HasMember("b") || patch["b"] != src.values[1]) {
+            throw std::exception("Delta pushes: a single changed field must produce a single key patch.");
+        }
+        if(now->MemberCount() != 3) throw std::exception("Delta pushes: the state to send to new subscribers is not complete.");
+        push.last = std::move(now);
+    }
+    rapidjson::Document same, patch;
+    if(Pull(push, same, patch)) throw std::exception("Delta pushes: nothing changed but a patch was produced.");
+}
+#endif
+
+
+void AbstractWSServer::EnqueueShared(ws::Connection &conn, const std::string &message, SharedFrames &frames, bool binary) {
+    const ws::Connection::FrameType type = binary? ws::Connection::ft_user_binary : ws::Connection::ft_user_text;
+    const aubyte *bytes = reinterpret_cast<const aubyte*>(message.c_str());
+    const ws::DeflateParams &deflate(conn.GetDeflate());
+    if(!deflate.enabled || message.length() < deflate.threshold) {
+        if(frames.raw.empty()) ws::Connection::BuildFrame(frames.raw, type, bytes, message.length());
+        conn.EnqueueFrames(frames.raw, message.length());
+    }
+    else if(!deflate.serverNoContextTakeover || deflate.serverMaxWindowBits < 15) conn.EnqueueMessage(type, message);
+    else {
+        if(frames.deflated.empty()) {
+            if(!sharedDeflater) sharedDeflater.reset(new ws::Deflater(deflateLevel, 15, false));
+            compressed.clear();
+            sharedDeflater->Compress(compressed, bytes, message.length());
+            ws::Connection::BuildFrame(frames.deflated, type, compressed.data(), compressed.size(), true);
+        }
+        conn.EnqueueFrames(frames.deflated, message.length());
+    }
+}
+
+
+std::string AbstractWSServer::PushMessage(const std::string &command, const std::string *stream, bool delta, const std::string &payload, bool binary) {
+    using namespace commands::cbor;
+    if(!binary) { // Command names and stream identifiers are plain identifiers, no need to escape them.
+        std::string ret("{\"pushing\":\"" + command + '"');
+        if(stream) ret += ",\"stream\":\"" + *stream + '"';
+        if(delta) ret += ",\"delta\":true";
+        return ret + ",\"payload\":" + payload + '}';
+    }
+    std::string ret;
+    EncodeHead(ret, mt_map, 2 + (stream? 1 : 0) + (delta? 1 : 0));
+    EncodeText(ret, "pushing");
+    EncodeText(ret, command);
+    if(stream) {
+        EncodeText(ret, "stream");
+        EncodeText(ret, *stream);
+    }
+    if(delta) {
+        EncodeText(ret, "delta");
+        ret += char(0xF5);
+    }
+    EncodeText(ret, "payload");
+    return ret + payload;
+}
+
+
+std::string AbstractWSServer::ErrorReply(const std::string &what, bool binary) {
+    const std::string error("!!ERROR: " + what + "!!");
+    if(!binary) return error;
+    std::string ret;
+    commands::cbor::EncodeText(ret, error);
+    return ret;
+}
+
+
+std::string AbstractWSServer::Serialize(const rapidjson::Value &value) {
+    rapidjson::StringBuffer payload;
+    #if _DEBUG
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(payload, nullptr);
+    #else
+    rapidjson::Writer<rapidjson::StringBuffer> writer(payload, nullptr);
+    #endif
+    value.Accept(writer);
+    return std::string(payload.GetString(), payload.GetSize());
+}
+
+
+bool AbstractWSServer::Diff(rapidjson::Value &patch, const rapidjson::Value &was, const rapidjson::Value &now, rapidjson::Document::AllocatorType &alloc) {
+    using namespace rapidjson;
+    if(was.IsObject() && now.IsObject()) {
+        patch.SetObject();
+        for(auto el = now.MemberBegin(); el != now.MemberEnd(); ++el) {
+            Value::ConstMemberIterator prev(was.FindMember(el->name));
+            Value changed;
+            if(prev == was.MemberEnd()) changed.CopyFrom(el->value, alloc);
+            else if(!Diff(changed, prev->value, el->value, alloc)) continue;
+            patch.AddMember(Value(el->name, alloc), changed, alloc);
+        }
+        for(auto el = was.MemberBegin(); el != was.MemberEnd(); ++el) {
+            if(now.FindMember(el->name) == now.MemberEnd()) patch.AddMember(Value(el->name, alloc), Value(), alloc);
+        }
+        return patch.MemberCount() != 0;
+    }
+    if(was.IsArray() && now.IsArray() && was.Size() == now.Size()) {
+        patch.SetObject();
+        for(SizeType loop = 0; loop < now.Size(); loop++) {
+            Value changed;
+            if(!Diff(changed, was[loop], now[loop], alloc)) continue;
+            const std::string index(std::to_string(loop));
+            patch.AddMember(Value(index.c_str(), SizeType(index.length()), alloc), changed, alloc);
+        }
+        return patch.MemberCount() != 0;
+    }
+    if(was == now) return false;
+    patch.CopyFrom(now, alloc);
+    return true;
+}
+
+
+void AbstractWSServer::CloseConnection(ClientState &client) {
+    if(client.ws) {
+        const ws::Connection::Traffic &traffic(client.ws->GetTraffic());
+        closedTraffic.messages += traffic.messages;
+        closedTraffic.raw += traffic.raw;
+        closedTraffic.sent += traffic.sent;
+    }
+    client.ws.reset();
+    client.initializer.reset();
+    network.CloseConnection(client.conn);
+}
+
+
+commands::monitor::WebTrafficCMD::Totals AbstractWSServer::GetTraffic() const {
+    commands::monitor::WebTrafficCMD::Totals ret(closedTraffic);
+    ret.clients = clients.size();
+    for(const auto &entry : clients) {
+        if(!entry.second.ws) continue;
+        const ws::Connection::Traffic &traffic(entry.second.ws->GetTraffic());
+        ret.messages += traffic.messages;
+        ret.raw += traffic.raw;
+        ret.sent += traffic.sent;
+        if(entry.second.ws->GetDeflate().enabled) ret.deflating++;
+    }
+    return ret;
 }
 
 
@@ -214,10 +397,13 @@ void AbstractWSServer::Mangle(ClientState &state, std::vector<ws::Connection::Me
     ScopedFuncCall clearProcessing{ [this]() { this->processing = nullptr; } };
     for(asizei loop = 0; loop < msg.size(); loop++) {
         rapidjson::Document object;
-        msg[loop].push_back(0); // string must be zero terminated for parse
-        //! \todo figure out how to limit rapidjson parsing!
-        object.ParseInsitu(reinterpret_cast<char*>(msg[loop].data()));
-        if(object.HasParseError()) throw std::exception("Invalid JSON received.");
+        if(state.binary) commands::cbor::Decoder::Decode(object, msg[loop].data(), msg[loop].size());
+        else {
+            msg[loop].push_back(0); // string must be zero terminated for parse
+            //! \todo figure out how to limit rapidjson parsing!
+            object.ParseInsitu(reinterpret_cast<char*>(msg[loop].data()));
+            if(object.HasParseError()) throw std::exception("Invalid JSON received.");
+        }
         rapidjson::Value::ConstMemberIterator cmdIter(object.FindMember("command"));
         if(cmdIter == object.MemberEnd() || cmdIter->value.IsString() == false) throw std::exception("Not a command object.");
         const rapidjson::Value &cmd(cmdIter->value);
@@ -225,35 +411,65 @@ void AbstractWSServer::Mangle(ClientState &state, std::vector<ws::Connection::Me
         auto matched = commands.find(command.c_str());
         std::string reply;
         std::unique_ptr<commands::PushInterface> stream;
-        if(matched == commands.cend()) reply = "!!ERROR: no such command \"" + command + "\"!!";
-        else if(matched->second->Mangle(reply, stream, object) == false) {
+        std::unique_ptr<rapidjson::Document> replied;
+        if(matched == commands.cend()) reply = ErrorReply("no such command \"" + command + '"', state.binary);
+        else if(matched->second->Mangle(reply, stream, object, state.binary, &replied) == false) {
             throw std::exception("Impossible, code out of sync. Command name already matched!");
         }
         if(!reply.length()) {
             throw std::exception("Invalid zero-length reply.");
         }
-        if(stream) {
-            auto list = std::find_if(pushing.begin(), pushing.end(), [&state](const PushList &test) { return test.dst == &state.conn.get(); });
-            std::unique_ptr<NamedPush> dataPush(new NamedPush);
-            dataPush->pusher = std::move(stream);
-            if(matched->second->GetMaxPushing() > 1) dataPush->name = std::to_string(numberedPushers);
-            else numberedPushers--;
-            dataPush->originator = matched->second.get();
-            if(list == pushing.end()) {
-                PushList add;
-                add.dst = &state.conn.get();
-                add.active.push_back(std::move(dataPush));
-                pushing.push_back(std::move(add));
-            }
-            else {
-                if(list->active.size() + 1 == matched->second->GetMaxPushing()) {
-                    reply = "!!ERROR: max amount of pushers reached!!";
-                    numberedPushers--;
-                }
-                else list->active.push_back(std::move(dataPush));
-            }
-            numberedPushers++;
-        }
-        state.ws->EnqueueTextMessage(reply);
+        if(stream) Subscribe(state, object, *matched->second, stream, replied, reply);
+        state.ws->EnqueueMessage(state.binary? ws::Connection::ft_user_binary : ws::Connection::ft_user_text, reply);
+    }
+}
+
+
+void AbstractWSServer::Subscribe(ClientState &client, const rapidjson::Value &request, commands::AbstractCommand &originator, std::unique_ptr<commands::PushInterface> &stream,
+                                 std::unique_ptr<rapidjson::Document> &replied, std::string &reply) {
+    const rapidjson::Value::ConstMemberIterator delta(request.FindMember("delta"));
+    const rapidjson::Value::ConstMemberIterator interval(request.FindMember("minInterval"));
+    if(delta != request.MemberEnd() && delta->value.IsBool() == false) {
+        reply = ErrorReply(".delta subfield must be a boolean.", client.binary);
+        return;
+    }
+    if(interval != request.MemberEnd() && interval->value.IsUint() == false) {
+        reply = ErrorReply(".minInterval subfield must be an amount of milliseconds.", client.binary);
+        return;
+    }
+    rapidjson::StringBuffer minified;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(minified, nullptr);
+    request.Accept(writer);
+    const std::string key(minified.GetString(), minified.GetSize());
+    const Network::SocketInterface *dst = &client.conn.get();
+    asizei already = 0;
+    for(const auto &push : pushing) {
+        if(push->originator != &originator) continue;
+        for(const auto &test : push->subscribers) already += test.dst == dst? 1 : 0;
+    }
+    if(already >= originator.GetMaxPushing()) {
+        reply = ErrorReply("max amount of pushers reached", client.binary);
+        return;
+    }
+    Subscriber add;
+    add.dst = dst;
+    add.binary = client.binary;
+    if(originator.GetMaxPushing() > 1) add.name = std::to_string(numberedPushers++);
+    auto shared = std::find_if(pushing.begin(), pushing.end(), [&originator, &key](const std::unique_ptr<NamedPush> &test) {
+        return test->originator == &originator && test->key == key;
+    });
+    if(shared == pushing.end()) { // the new pusher has been used to produce the reply so it's up to date, otherwise it's just dropped
+        std::unique_ptr<NamedPush> dataPush(new NamedPush);
+        dataPush->key = key;
+        dataPush->originator = &originator;
+        dataPush->pusher = std::move(stream);
+        dataPush->delta = delta != request.MemberEnd() && delta->value.GetBool();
+        if(interval != request.MemberEnd()) dataPush->minInterval = std::chrono::milliseconds(interval->value.GetUint());
+        dataPush->lastSent = std::chrono::system_clock::now();
+        if(dataPush->delta) dataPush->last = std::move(replied); // the reply is the first state the client gets, parsing it back would not be exact
+        pushing.push_back(std::move(dataPush));
+        shared = pushing.end() - 1;
     }
+    else add.full = (*shared)->delta;
+    (*shared)->subscribers.push_back(std::move(add));
 }
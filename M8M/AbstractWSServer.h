@@ -9,17 +9,21 @@
 #include <algorithm>
 #include "commands/UnsubscribeCMD.h"
 #include "commands/ExtensionState.h"
+#include "commands/Monitor/WebTrafficCMD.h"
 #include <chrono>
 
 
-class AbstractWSServer : public commands::UnsubscribeCMD::PusherOwnerInterface {
+class AbstractWSServer : public commands::UnsubscribeCMD::PusherOwnerInterface,
+                         public commands::monitor::WebTrafficCMD::TrafficSourceInterface {
 public:
 	const aushort port;
 	const std::string resURI, wsProtocol;
-	const static auint maxClients;
+	const auint maxClients; //!< connections beyond this are accepted and immediately closed
+	const static auint MAX_CLIENTS_LIMIT; //!< maxClients is clamped to this, sockets are not free and the select backend has a fixed size
 
-	AbstractWSServer(NetworkInterface &netAPI, aushort servicePort, const char *httpRes, const char *wsProtoString)
-		: network(netAPI), landing(nullptr), numberedPushers(0), port(servicePort), processing(nullptr), resURI(httpRes), wsProtocol(wsProtoString) { }
+	AbstractWSServer(NetworkInterface &netAPI, aushort servicePort, const char *httpRes, const char *wsProtoString, auint clientLimit = 5)
+		: network(netAPI), landing(nullptr), numberedPushers(0), port(servicePort), processing(nullptr), resURI(httpRes), wsProtocol(wsProtoString),
+		  maxClients(clientLimit < MAX_CLIENTS_LIMIT? clientLimit : MAX_CLIENTS_LIMIT) { }
 	void FillSleepLists(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
 	void Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
 	void RegisterCommand(std::unique_ptr<commands::AbstractCommand> &cmd) {
@@ -35,6 +39,23 @@ public:
 
     asizei GetNumClients() const { return clients.size(); }
 
+	/*! Offer permessage-deflate to clients connecting from now on. Level 0 disables it.
+	Messages shorter than threshold bytes are sent uncompressed, they would not shrink anyway. */
+	void SetDeflate(aint level, asizei threshold) {
+		deflateLevel = level < 0? 0 : (level > 9? 9 : level);
+		deflateThreshold = threshold;
+		sharedDeflater.reset();
+	}
+
+	/*! Clients listing this subprotocol in the handshake get the same replies and pushes encoded as CBOR in binary messages
+	and must send their requests in CBOR as well. Errors are CBOR text strings. Empty disables it. */
+	void SetBinaryProtocol(const std::string &name) { binaryProtocol = name; }
+	commands::monitor::WebTrafficCMD::Totals GetTraffic() const;
+
+	/*! Pushers are polled for new data and shutdown has a timeout so Refresh must be called periodically even if no socket
+	is ready while this is true. Otherwise the server only reacts to I/O. */
+	bool NeedsPolling() const { return landing && (pushing.size() || shutdownInitiated != TimePoint()); }
+
 	/*! This function is called after a client connection has been dropped or added.
 	The 1st parameter is 1 if a client was added, -1 if it was removed.
 	2nd parameter is the number of clients currently connected. */
@@ -56,8 +77,9 @@ private:
 		std::reference_wrapper<NetworkInterface::ConnectedSocketInterface> conn;
 		std::unique_ptr<ws::HandShaker> initializer; //!< \note Perhaps I should limit this to one initializer per host as in the WS spec. One singleton?
 		std::unique_ptr<ws::Connection> ws;
-		ClientState(NetworkInterface::ConnectedSocketInterface &tcp) : conn(tcp) { }
-		ClientState(ClientState &&other) : conn(other.conn) {
+		bool binary; //!< negotiated binaryProtocol, decided on upgrade
+		ClientState(NetworkInterface::ConnectedSocketInterface &tcp) : conn(tcp), binary(false) { }
+		ClientState(ClientState &&other) : conn(other.conn), binary(other.binary) {
 			initializer = std::move(other.initializer);
 			ws = std::move(other.ws);
 		}
@@ -66,32 +88,49 @@ private:
 				conn = std::move(other.conn);
 				initializer = std::move(other.initializer);
 				ws = std::move(other.ws);
+				binary = other.binary;
 			}
 			return *this;
 		}
-		operator NetworkInterface::SocketInterface*() { return &conn.get(); }
 	};
 
-    struct NamedPush {
-        std::string name;
+	struct Subscriber {
+		const Network::SocketInterface *dst; //!< not ConnectedSocketInterface as it must compare to wait list entry
+		std::string name; //!< stream identifier, only sent if originator allows more than one push
+		bool full = false; //!< joined a delta stream, its reply is newer than NamedPush::last so it needs the whole state once
+		bool binary = false; //!< copy of ClientState::binary
+	};
+
+	/*! Clients subscribing to the same command with the same request would get the same data so they share a single pusher.
+	Its output is serialized and framed once for all the subscribers.
+	Two optional request fields change how pushes are sent, being part of the request they also select the NamedPush:
+	- "delta": true sends only what changed since the previous push, marked by "delta":true next to "payload".
+	  The payload is a JSON merge patch (RFC 7386) with an extension: an object patching an array of the same length
+	  has the changed indices as keys. Arrays are replaced when their length changes, removed members are null.
+	- "minInterval": milliseconds, changes happening faster than this are coalesced in a single push. */
+	struct NamedPush {
+		std::string key; //!< the request as received, minified
 		commands::AbstractCommand *originator;
-        std::unique_ptr<commands::PushInterface> pusher;
-		NamedPush() : originator(nullptr) { }
+		std::unique_ptr<commands::PushInterface> pusher;
+		std::vector<Subscriber> subscribers;
+		bool delta = false;
+		std::chrono::milliseconds minInterval;
+		TimePoint lastSent;
+		std::unique_ptr<rapidjson::Document> last; //!< whole state known by subscribers, delta streams only
+		NamedPush() : originator(nullptr), minInterval(0) { }
 	};
 
-	struct PushList {
-		const Network::SocketInterface *dst; //!< not ConnectedSocketInterface as it must compare to wait list entry
-		std::vector< std::unique_ptr<NamedPush> > active;
-
-		PushList() : dst(nullptr) { }
-		PushList(PushList &&other) : dst(other.dst), active(std::move(other.active)) { }
-		PushList& operator=(PushList &&other) {
-			if(this != &other) {
-				dst = other.dst;
-				active = std::move(other.active);
-			}
-			return *this;
-		}
+	//! A message sent to many connections is framed once and compressed at most once, see EnqueueShared.
+	struct SharedFrames {
+		std::vector<aubyte> raw, deflated;
+		void clear() { raw.clear(); deflated.clear(); }
+	};
+
+	//! Each push can go out whole or as delta, in JSON or CBOR. Each combination is built at most once, only if somebody gets it.
+	struct PushVariant {
+		std::string payload, message; //!< message is the whole push, only for commands with a single stream
+		SharedFrames frames;
+		void clear() { payload.clear(); message.clear(); frames.clear(); }
 	};
 
 
@@ -101,14 +140,40 @@ private:
 	void PurgeClosedConnections();
 	void EnqueuePushData();
     void Mangle(ClientState &client, std::vector<ws::Connection::Message> &msg, Network::SocketInterface &skt);
+	void Subscribe(ClientState &client, const rapidjson::Value &request, commands::AbstractCommand &originator, std::unique_ptr<commands::PushInterface> &stream,
+	               std::unique_ptr<rapidjson::Document> &replied, std::string &reply);
+	void EnqueueShared(ws::Connection &conn, const std::string &message, SharedFrames &frames, bool binary);
+	static std::string Serialize(const rapidjson::Value &value);
+	//! Wraps a serialized payload in the push message. If stream is not null, it is the identifier of a command supporting many pushes.
+	static std::string PushMessage(const std::string &command, const std::string *stream, bool delta, const std::string &payload, bool binary);
+	static std::string ErrorReply(const std::string &what, bool binary);
+	//! Builds in patch what changed going from was to now, see NamedPush. Returns false if they are the same.
+	static bool Diff(rapidjson::Value &patch, const rapidjson::Value &was, const rapidjson::Value &now, rapidjson::Document::AllocatorType &alloc);
+	/*! Refreshes the pusher in now. Delta streams get the whole state and what changed since NamedPush::last in patch, last is not updated.
+	Returns true if there's something to send to subscribers already up to date. */
+	static bool Pull(NamedPush &push, rapidjson::Document &now, rapidjson::Document &patch);
+#if defined(_DEBUG)
+	static void CheckDeltaPushes(); //!< throws if consecutive pushes with a single changed field do not produce a single key patch
+#endif
+	void DropSubscriber(const Network::SocketInterface *dst, const commands::AbstractCommand *originator, const std::string &stream);
+	void CloseConnection(ClientState &client); //!< also keeps its traffic in the totals
 
 	NetworkInterface &network;
 	NetworkInterface::ServiceSocketInterface *landing; //!< A simple pointer is sufficient since the network blasts it anyway, we just have to de-register it.
 	TimePoint shutdownInitiated; //!< if connections are not shut down after a few seconds, they get blasted, 0 --> running no shutdown requested
 	asizei numberedPushers;
-	std::vector<ClientState> clients;
+	std::map<const Network::SocketInterface*, ClientState> clients; //!< by socket, there can be thousands of those
 	std::map<std::string, std::unique_ptr<commands::AbstractCommand>> commands;
-	std::vector<PushList> pushing;
+	std::vector< std::unique_ptr<NamedPush> > pushing; //!< few of those, one for each different subscription request
+	PushVariant variants[2][2]; //!< [delta][binary] push messages being fanned out, reused to avoid reallocations
+	std::string binaryProtocol;
+	aint deflateLevel = 0;
+	asizei deflateThreshold = 64;
+	/*! Clients which negotiated server_no_context_takeover can all inflate the same compressed frame so it is built once for them.
+	Clients keeping the context (the default) need their own compressor as the output depends on what they got before. */
+	std::unique_ptr<ws::Deflater> sharedDeflater;
+	std::vector<aubyte> compressed;
+	commands::monitor::WebTrafficCMD::Totals closedTraffic; //!< connections already gone, clients counts unused
 	/*! This is to support unsubscribe as it has no way to know which client requested unsubscribe.
 	Sure, I keep an unique string of stream identifiers but if there's no stream id there's no use for it.
 	NormalNetworkIO sets this in a loop using an ad-hoc object so this is guaranteed to match the client owning commands or be nullptr. */
@@ -44,6 +44,14 @@ void AlgoSourcesLoader::Load(const std::wstring &algoDescFile, const std::string
             if(ver->value.IsString() == false) throw std::exception("Algorithm-implementation versioning must be a string");
             std::string verString(ver->value.GetString(), ver->value.GetStringLength());
             if(verString.empty()) throw std::exception("Algorithm-implementation versioning string is empty!");
+
+            auto bake = impl->value.FindMember("bakeImmediates");
+            if(bake != impl->value.MemberEnd()) {
+                if(bake->value.IsArray() == false) throw std::exception("\"bakeImmediates\" must be an array.");
+                for(auto name = bake->value.Begin(); name != bake->value.End(); ++name) {
+                    if(name->IsString() == false) throw std::exception("\"bakeImmediates\" must be an array of strings.");
+                }
+            }
         }
         if(!verification || !canon) {
             const std::string name(algo->value.GetString(), algo->value.GetStringLength());
@@ -116,7 +124,7 @@ void AlgoSourcesLoader::Load(const std::wstring &algoDescFile, const std::string
             id.algorithm = algorithm;
             id.implementation = std::move(implName);
             id.version = std::string(ver->value.GetString(), ver->value.GetStringLength());
-            auto signature = ComputeVersionedHash(id, kernels->value);
+            auto signature = ComputeVersionedHash(id, impl->value);
             auto &implArray(container->get()->impl);
             auto uniqueness = std::find_if(implArray.cbegin(), implArray.cend(), [&id](const std::unique_ptr<AlgoFamily::Implementation> &test) {
                 return test->name == id.implementation;
@@ -139,6 +147,14 @@ void AlgoSourcesLoader::Load(const std::wstring &algoDescFile, const std::string
             if(intScale->value.IsUint() == false) throw std::exception("\"intensityScaling\" must be uint.");
             add->intensityScale = intScale->value.GetUint();
 
+            auto midstate = impl->value.FindMember("midstate");
+            if(midstate != impl->value.MemberEnd()) {
+                if(midstate->value.IsString() == false) throw std::exception("\"midstate\" must be a string.");
+                const std::string kind(midstate->value.GetString(), midstate->value.GetStringLength());
+                if(_stricmp(kind.c_str(), "sha256") == 0) add->midstate = AbstractAlgorithm::MidstateKind::sha256;
+                else if(_stricmp(kind.c_str(), "none")) throw std::exception(("Unknown midstate function \"" + kind + "\".").c_str());
+            }
+
             auto linearSizes = impl->value.FindMember("linearSizes");
             if(linearSizes != impl->value.MemberEnd()) {
                 if(linearSizes->value.IsObject()) {
@@ -159,6 +175,10 @@ void AlgoSourcesLoader::Load(const std::wstring &algoDescFile, const std::string
                     add->DeclareResource(name, res->value, cryptoConstants);
                 }
             }
+            auto bake = impl->value.FindMember("bakeImmediates");
+            if(bake != impl->value.MemberEnd()) { // validated already
+                for(auto name = bake->value.Begin(); name != bake->value.End(); ++name) add->BakeImmediate(std::string(name->GetString(), name->GetStringLength()));
+            }
             for(auto kern = kernels->value.Begin(); kern != kernels->value.End(); ++kern) add->DeclareKernel(*kern);
             implArray.push_back(std::move(add));
         }
@@ -196,9 +216,15 @@ std::pair<const char*, asizei> AlgoSourcesLoader::GetSourceBuffer(std::vector<st
 }
 
 
-aulong AlgoSourcesLoader::ComputeVersionedHash(const AlgoIdentifier &identifier, const rapidjson::Value &kerns) const {
+aulong AlgoSourcesLoader::ComputeVersionedHash(const AlgoIdentifier &identifier, const rapidjson::Value &impl) const {
     std::string sign(identifier.algorithm + '.' + identifier.implementation + '.' + identifier.version + '\n');
     auto mkString = [](const rapidjson::Value &strval) { return std::string(strval.GetString(), strval.GetStringLength()); };
+    // Baked immediates produce different programs so they must be part of the signature. Their values are not, as other immediates.
+    auto bake = impl.FindMember("bakeImmediates");
+    if(bake != impl.MemberEnd()) {
+        for(auto name = bake->value.Begin(); name != bake->value.End(); ++name) sign += "-D " + mkString(*name) + '\n';
+    }
+    const rapidjson::Value &kerns(impl["kernels"]);
     for(rapidjson::SizeType step = 0; step < kerns.Size(); step++) {
         auto filename(mkString(kerns[step][0u]));
         sign += ">>>>" + filename + ':' + mkString(kerns[step][1]) + '(' + mkString(kerns[step][2]) + ')' + '\n';
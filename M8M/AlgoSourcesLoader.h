@@ -99,7 +99,8 @@ private:
     //! of files to load, if unique.
     static void ValidateExtractFile(std::vector<std::string> &uniques, const rapidjson::Value &entry);
 
-    aulong ComputeVersionedHash(const AlgoIdentifier &desc, const rapidjson::Value &kernArray) const;
+    //! \param impl The algorithm-implementation object, its kernels have been validated already.
+    aulong ComputeVersionedHash(const AlgoIdentifier &desc, const rapidjson::Value &impl) const;
     static BlockVerifierInterface* NewVerifier(const rapidjson::Value &desc);
 
     //! A block verifier build by interpreting data. It could be called DataDrivenBlockVerifier but I'm using a different nomenclature to avoid confusion.
@@ -3,6 +3,7 @@
  * For conditions of distribution and use, see the LICENSE or hit the web.
  */
 #include "DataDrivenAlgoFactory.h"
+#include <sstream>
 
 
 void DataDrivenAlgoFactory::Resources(std::vector<AbstractAlgorithm::ResourceRequest> &res, KnownConstantProvider &K) const {
@@ -125,6 +126,7 @@ bool DataDrivenAlgoFactory::ParseImmediate(const rapidjson::Value &arr, std::str
         target.bytes = match->second;
         ParseValue(target.imValue, sizeof(target.imValue), type, arr, name);
         target.immediate = true;
+        target.literal = MakeLiteral(target.imValue, type);
     }
     else {
         if(arr.IsArray() == false) throw std::string("Immediate \"") + name + '"' + " should be an array";
@@ -183,6 +185,20 @@ void DataDrivenAlgoFactory::ParseValue(aubyte *dst, asizei rem, const std::strin
 }
 
 
+std::string DataDrivenAlgoFactory::MakeLiteral(const aubyte *value, const std::string &type) {
+    // ParseValue already validated type so I can just reinterpret the bytes.
+    if(type == "uint") return std::to_string(*reinterpret_cast<const auint*>(value)) + 'u';
+    if(type == "int") return '(' + std::to_string(*reinterpret_cast<const aint*>(value)) + ')';
+    if(type == "ulong") return std::to_string(*reinterpret_cast<const aulong*>(value)) + "ul";
+    if(type == "long") return '(' + std::to_string(*reinterpret_cast<const along*>(value)) + "l)";
+    std::stringstream build;
+    build.precision(std::numeric_limits<adouble>::digits10 + 2);
+    if(type == "double") build<<'('<<*reinterpret_cast<const adouble*>(value)<<')';
+    else build<<"((float)"<<*reinterpret_cast<const asingle*>(value)<<')';
+    return build.str();
+}
+
+
 void DataDrivenAlgoFactory::ParseCustom(const rapidjson::Value &arr, std::string &name) {
     rapidjson::SizeType p = 0;
     MetaResource target;
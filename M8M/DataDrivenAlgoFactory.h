@@ -6,6 +6,7 @@
 #include "clAlgoFactories.h"
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 /*! Since algorithms are now built by ResourceRequest and KernelRequest arrays, we must provide a way to mangle settings and produce those arrays accordingly.
 The DataDrivenAlgoFactory is therefore misnomed as it really creates those arrays, which the DataDrivenAlgorithm then mangles, self-building itself. */
@@ -22,6 +23,9 @@ struct DataDrivenAlgoFactory : AbstractAlgoFactory {
     In the latter case, the name-value correspondance is kept there. */
     std::vector<std::pair<std::string, auint>> linearSize;
 
+    /*! If kernels use the $midstate special value, this selects how the host computes it. */
+    AbstractAlgorithm::MidstateKind midstate = AbstractAlgorithm::MidstateKind::none;
+
     void DeclareResource(std::string &name, const rapidjson::Value &desc, KnownConstantProvider &cryptoConstants) {
         if(ParseSpecial(desc, name, cryptoConstants)) return;
         if(ParseImmediate(desc, name)) return;
@@ -37,9 +41,26 @@ struct DataDrivenAlgoFactory : AbstractAlgoFactory {
         gen.compileFlags = mkString(stage[2]);
         gen.groupSize = ParseGroupSize(stage[3]);
         gen.params = mkString(stage[4]);
+        const auto params(AbstractAlgorithm::SplitParams(gen.params));
+        for(const auto &res : resources) {
+            if(res.baked == false) continue;
+            if(std::find(params.cbegin(), params.cend(), res.name) != params.cend()) gen.compileFlags += " -D " + res.name + '=' + res.literal;
+        }
         kernels.push_back(gen);
     }
 
+    /*! Immediates are normally passed to kernels as parameters. This is flexible but the compiler cannot do anything with them.
+    Baking an immediate causes its value to be also passed as a -D NAME=value definition to each kernel referencing it, kernels can then
+    use the definition (if existing) to unroll or otherwise specialize themselves. The parameter is still bound so kernel signatures are
+    not affected; kernels not knowing about the definition work as usual.
+    Must be called after the resource has been declared and before DeclareKernel. Only scalar immediates can be baked. */
+    void BakeImmediate(const std::string &name) {
+        auto match(std::find_if(resources.begin(), resources.end(), [&name](const MetaResource &test) { return test.name == name; }));
+        if(match == resources.end()) throw std::string("Cannot bake \"") + name + "\", no such resource.";
+        if(match->immediate == false) throw std::string("Cannot bake \"") + name + "\", only scalar immediates can be baked.";
+        match->baked = true;
+    }
+
     //! AbstractAlgoFactory - - - - - - - - - - - - - - - - - - - - - -
     void Resources(std::vector<AbstractAlgorithm::ResourceRequest> &res, KnownConstantProvider &K) const;
     void Kernels(std::vector<AbstractAlgorithm::KernelRequest> &kern) const {
@@ -48,6 +69,7 @@ struct DataDrivenAlgoFactory : AbstractAlgoFactory {
     }
     asizei GetHashCount() const { return linearIntensity * intensityScale; }
     asizei GetNumUintsPerCandidate() const { return candHashUints; }
+    AbstractAlgorithm::MidstateKind GetMidstateKind() const { return midstate; }
     // SignedAlgoIdentifier GetAlgoIdentifier() const = 0;
     asizei GetIntensityMultiplier() const { return intensityScale; }
     asizei GetBiggestBufferSize(asizei hashCount) const {
@@ -64,6 +86,8 @@ struct DataDrivenAlgoFactory : AbstractAlgoFactory {
 private:
     struct MetaResource : AbstractAlgorithm::ResourceRequest {
         bool linearIndex = false; //!< When this is true, the byte footprint is not real but rather the index of the hashCount multiplier to use.
+        bool baked = false; //!< Only for immediates, also produce a compile-time definition, see BakeImmediate.
+        std::string literal; //!< Only for scalar immediates, the value as an OpenCL C literal.
     };
     std::vector<MetaResource> resources;
     std::vector<std::pair<asizei, std::unique_ptr<aubyte[]>>> persistentBlobs;
@@ -73,6 +97,7 @@ private:
     static cl_mem_flags ParseMemFlags(const rapidjson::Value &string);
     bool ParseImmediate(const rapidjson::Value &arr, std::string &name);
     void ParseValue(aubyte *dst, asizei rem, const std::string &type, const rapidjson::Value &im, const std::string &name);
+    static std::string MakeLiteral(const aubyte *value, const std::string &type);
     void ParseCustom(const rapidjson::Value &arr, std::string &name);
     static AbstractAlgorithm::WorkGroupDimensionality ParseGroupSize(const rapidjson::Value &arr);
 };
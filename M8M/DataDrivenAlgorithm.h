@@ -12,6 +12,17 @@ public:
     }
     SignedAlgoIdentifier identifier;
     SignedAlgoIdentifier Identify() const { return identifier; }
+    MidstateKind midstate = MidstateKind::none;
+
+    bool Midstate(std::array<auint, 8> &state, const std::array<aubyte, 80> &header) const {
+        if(midstate == MidstateKind::none) return false;
+        hashing::SHA256 partial;
+        partial.BlockProcessing(header.data());
+        hashing::SHA256::Digest words;
+        partial.GetHashLE(words); // that is, host order words
+        memcpy_s(state.data(), sizeof(state), words.data(), sizeof(words));
+        return true;
+    }
 
 
     /*! Performs all the heavy duty required to create the resources to run the algorithm. Returns a list of all errors encountered.
@@ -19,7 +30,7 @@ public:
     Call this immediately after CTOR. Must be called before Tick, GetEvents, GetResults.
     \note The easiest way to implement this is to call DescribeResources and return before PrepareResources. */
     std::vector<std::string> Init(AbstractSpecialValuesProvider &specials, SourceCodeBufferGetterFunc loader, const std::vector<ResourceRequest> &res, const std::vector<KernelRequest> &kern) {
-        auto errors(PrepareResources(res, specials));
+        auto errors(PrepareResources(res, kern, specials));
         if(errors.size()) return errors;
         return PrepareKernels(kern, specials, loader);
     }
@@ -27,17 +38,24 @@ public:
 private:
     /*! Derived classes are expected to call this somewhere in their ctor. It deals with allocating memory and eventually initializing it in a
     data-driven way. Note special resources cannot be created using this, at least in theory. Just create them in the ctor before PrepareKernels.
-    While this is allowed to throw, it is suggested to produce a list of errors to be returned by Init(). */
-    std::vector<std::string> PrepareResources(const std::vector<ResourceRequest> &resources, const AbstractSpecialValuesProvider &prov) {
+    While this is allowed to throw, it is suggested to produce a list of errors to be returned by Init().
+    Buffers with non-overlapping lifetimes share their allocation, see PlanAliasing. Each name still holds its own reference. */
+    std::vector<std::string> PrepareResources(const std::vector<ResourceRequest> &resources, const std::vector<KernelRequest> &kernels, const AbstractSpecialValuesProvider &prov) {
         std::vector<std::string> errors;
-        for(const auto &res : resources) {
+        const auto aliasing(PlanAliasing(resources, kernels));
+        std::vector<bool> aliased(resources.size());
+        for(const auto &group : aliasing) {
+            for(asizei loop = 1; loop < group.members.size(); loop++) aliased[group.members[loop]] = true;
+        }
+        for(asizei index = 0; index < resources.size(); index++) {
+            const auto &res(resources[index]);
             if(resHandles.find(res.name) != resHandles.cend()) throw std::string("Duplicated resource name \"" + res.name + '"');
             if(prov.SpecialValue(res.name)) {
                 errors.push_back("Trying to allocate special resource \"" + res.name + "\" from algorithm, invalid operation.");
                 continue;
             }
             resRequests.push_back(res);
-            if(res.immediate) continue; // nothing to allocate here
+            if(res.immediate || aliased[index]) continue; // nothing to allocate here
             ScopedFuncCall popLast([this]() { resRequests.pop_back(); });
             cl_mem build = 0;
             ScopedFuncCall relMem([&build]() { if(build) clReleaseMemObject(build); });
@@ -72,6 +90,14 @@ private:
             relMem.Dont();
             popLast.Dont();
         }
+        if(errors.size()) return errors;
+        for(const auto &group : aliasing) {
+            cl_mem shared = resHandles[resources[group.members[0]].name];
+            for(asizei loop = 1; loop < group.members.size(); loop++) {
+                clRetainMemObject(shared);
+                resHandles.insert(std::make_pair(resources[group.members[loop]].name, shared));
+            }
+        }
         return errors;
     }
 
@@ -94,9 +120,18 @@ private:
         // Or, I might just Sleep one second. Not bad either but I cannot be bothered in getting a sleep call here.
         // By the way, CL spec reads as error: "CL_INVALID_OPERATION if the build of a program executable for any of the devices listed in device_list by a previous
         // call to clBuildProgram for program has not completed." So this is really non concurrent?
+        // Kernels often come from the same file with the same options (especially when immediates are baked), there's no need to build those
+        // multiple times: programs are cached by source and options, progs[i] is the program to use for kernels[i].
         std::vector<cl_program> progs(kernels.size());
-        ScopedFuncCall clearProgs([&progs]() { for(auto el : progs) { if(el) clReleaseProgram(el); } });
+        std::map<std::pair<std::string, std::string>, cl_program> built;
+        ScopedFuncCall clearProgs([&built]() { for(auto &el : built) { if(el.second) clReleaseProgram(el.second); } });
         for(asizei loop = 0; loop < kernels.size(); loop++) {
+            auto key(std::make_pair(kernels[loop].fileName, kernels[loop].compileFlags));
+            auto cached(built.find(key));
+            if(cached != built.cend()) {
+                progs[loop] = cached->second;
+                continue;
+            }
             const char *str = sources[loop].first;
             const asizei len = sources[loop].second;
             cl_int err = 0;
@@ -106,6 +141,7 @@ private:
                 continue;
             }
             progs[loop] = created;
+            built.insert(std::make_pair(std::move(key), created));
 
             err = clBuildProgram(created, NULL, 0, kernels[loop].compileFlags.c_str(), NULL, NULL);
             std::string errString;
@@ -150,6 +150,12 @@ int main(int argc, char **argv) {
             std::unique_ptr<Settings> config(application.LoadSettings(start.configFile, start.configSpecified, start.algo.size()? start.algo.c_str() : nullptr));
             if(config) { // pool setup
                 application.SetReconnectDelay(config->reconnDelay);
+                application.SetHotStandby(config->hotStandby);
+                application.SetStaleWorkTimeout(config->staleWork);
+                application.SetPoolScheduling(config->scheduling);
+                application.SetMonitorClients(config->monitorClients);
+                application.SetWebDeflate(config->webDeflateLevel, config->webDeflateThreshold);
+                if(config->metricsPort) application.StartMetrics(config->metricsPort);
                 for(asizei init = 0; init < config->pools.size(); init++) {
                     if(application.AddPool(*config->pools[init], application.GetCanonicalAlgoInfo(config->pools[init]->algo)) == false) {
                         application.Error(L"Unknown pool[" + std::to_wstring(init) + L"] algorithm");
@@ -166,9 +172,8 @@ int main(int argc, char **argv) {
             while(run = application.KeepRunning()) {
                 std::vector<Network::SocketInterface*> toRead, toWrite;
                 application.FillSleepLists(toRead, toWrite);
-                const std::chrono::milliseconds tickTime(200);
-                if(toRead.size() || toWrite.size()) networkWrapper.SleepOn(toRead, toWrite, tickTime.count());
-                else std::this_thread::sleep_for(tickTime);
+                // Sleep until something happens: socket I/O, a timer expiring or another thread calling Wake.
+                networkWrapper.SleepOn(toRead, toWrite, application.GetSleepTime());
                 application.Refresh(toRead, toWrite);
             }
             reboot = application.Reboot();
@@ -79,6 +79,12 @@ std::unique_ptr<PoolInfo> M8MConfiguredApp::ParsePoolExtended(std::unique_ptr<Po
     const auto diffMul(load.FindMember("diffMultipliers"));
     const auto merkleMode(load.FindMember("merkleMode"));
     const auto diffMode(load.FindMember("diffMode"));
+    const auto recvCeiling(load.FindMember("recvCeiling"));
+    const auto xnsub(load.FindMember("extranonceSubscribe"));
+    const auto shareRate(load.FindMember("targetShareRate"));
+    const auto diffHint(load.FindMember("difficultyHint"));
+    const auto quota(load.FindMember("quota"));
+    const auto devices(load.FindMember("devices"));
     if(proto != load.MemberEnd() && proto->value.IsString()) add->appLevelProtocol = MakeString(proto->value);
     if(diffMul == load.MemberEnd()) {
         errors.push_back(std::string("pools[") + std::to_string(index) + "].diffMultipliers not found, old config file?");
@@ -126,5 +132,53 @@ std::unique_ptr<PoolInfo> M8MConfiguredApp::ParsePoolExtended(std::unique_ptr<Po
         else if(mmode == "neoScrypt") add->diffMode = PoolInfo::dm_neoScrypt;
         else throw std::string("Unknown difficulty calculation mode: \"" + mmode + "\".");
     }
+    if(recvCeiling != load.MemberEnd()) {
+        if(recvCeiling->value.IsUint() == false || recvCeiling->value.GetUint() < 4096) {
+            errors.push_back(std::string("pools[") + std::to_string(index) + "].recvCeiling must be an amount of bytes, at least 4096.");
+            return empty;
+        }
+        add->recvCeiling = recvCeiling->value.GetUint();
+    }
+    if(xnsub != load.MemberEnd()) {
+        if(xnsub->value.IsBool() == false) {
+            errors.push_back(std::string("pools[") + std::to_string(index) + "].extranonceSubscribe must be a boolean.");
+            return empty;
+        }
+        add->extranonceSubscribe = xnsub->value.GetBool();
+    }
+    if(shareRate != load.MemberEnd()) {
+        if(shareRate->value.IsNumber() == false || shareRate->value.GetDouble() <= .0) {
+            errors.push_back(std::string("pools[") + std::to_string(index) + "].targetShareRate must be a number of shares per minute > 0.");
+            return empty;
+        }
+        add->targetShareRate = shareRate->value.GetDouble();
+    }
+    if(diffHint != load.MemberEnd()) {
+        const std::string mode(diffHint->value.IsString()? MakeString(diffHint->value) : "");
+        if(mode == "suggest") add->diffHint = PoolInfo::dh_suggest;
+        else if(mode == "password") add->diffHint = PoolInfo::dh_password;
+        else {
+            errors.push_back(std::string("pools[") + std::to_string(index) + "].difficultyHint must be \"suggest\" or \"password\".");
+            return empty;
+        }
+    }
+    if(quota != load.MemberEnd()) {
+        if(quota->value.IsUint() == false || quota->value.GetUint() == 0) {
+            errors.push_back(std::string("pools[") + std::to_string(index) + "].quota must be an integer > 0.");
+            return empty;
+        }
+        add->scheduling.quota = quota->value.GetUint();
+    }
+    if(devices != load.MemberEnd()) {
+        bool good = devices->value.IsArray();
+        for(rapidjson::SizeType loop = 0; good && loop < devices->value.Size(); loop++) {
+            good = devices->value[loop].IsUint();
+            if(good) add->scheduling.devices.push_back(devices->value[loop].GetUint());
+        }
+        if(!good) {
+            errors.push_back(std::string("pools[") + std::to_string(index) + "].devices must be an array of device linear indices.");
+            return empty;
+        }
+    }
     return std::move(add);
 }
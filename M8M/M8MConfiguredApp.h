@@ -17,6 +17,13 @@ struct Settings {
 	std::vector< unique_ptr<PoolInfo> > pools;
 	std::string driver, algo;
     std::chrono::seconds reconnDelay = std::chrono::seconds(120);
+    asizei hotStandby = asizei(-1); //!< backup pools to keep connected, all by default
+    std::chrono::seconds staleWork = std::chrono::seconds(0);
+    PoolScheduling scheduling = ps_failover;
+    auint monitorClients = 5; //!< concurrent web monitor connections
+    aint webDeflateLevel = 6; //!< permessage-deflate compression level for web sockets, 0 disables it
+    auint webDeflateThreshold = 64; //!< shorter messages are never compressed
+    aushort metricsPort = 0; //!< OpenMetrics exporter for scrapers, 0 keeps it off
 	rapidjson::Document implParams;
 };
 
@@ -101,6 +108,13 @@ private:
 		    Value::ConstMemberIterator driver = root.FindMember("driver");
 		    Value::ConstMemberIterator defAlgo = root.FindMember("algo");
             Value::ConstMemberIterator reconnDelay = root.FindMember("reconnectDelay");
+            Value::ConstMemberIterator hotStandby = root.FindMember("hotStandby");
+            Value::ConstMemberIterator staleWork = root.FindMember("staleWorkTimeout");
+            Value::ConstMemberIterator scheduling = root.FindMember("poolScheduling");
+            Value::ConstMemberIterator monitorClients = root.FindMember("monitorClients");
+            Value::ConstMemberIterator webDeflateLevel = root.FindMember("webDeflateLevel");
+            Value::ConstMemberIterator webDeflateThreshold = root.FindMember("webDeflateThreshold");
+            Value::ConstMemberIterator metricsPort = root.FindMember("metricsPort");
 		    if(driver != root.MemberEnd() && driver->value.IsString()) ret->driver = MakeString(driver->value);
             if(algoSelected) ret->algo = algoSelected;
             else if(defAlgo == root.MemberEnd()) {
@@ -112,6 +126,38 @@ private:
                 if(reconnDelay->value.IsUint()) ret->reconnDelay = std::chrono::seconds(reconnDelay->value.GetUint());
                 else throw std::string("\"reconnectDelay\", value ") + std::to_string(reconnDelay->value.GetUint()) + " is invalid.";
             }
+            if(hotStandby != root.MemberEnd()) {
+                if(hotStandby->value.IsUint()) ret->hotStandby = hotStandby->value.GetUint();
+                else throw std::string("\"hotStandby\" must be the number of backup pools to keep connected.");
+            }
+            if(staleWork != root.MemberEnd()) {
+                if(staleWork->value.IsUint()) ret->staleWork = std::chrono::seconds(staleWork->value.GetUint());
+                else throw std::string("\"staleWorkTimeout\" must be an amount of seconds.");
+            }
+            if(scheduling != root.MemberEnd()) {
+                const std::string policy(scheduling->value.IsString()? MakeString(scheduling->value) : std::string());
+                if(policy == "failover") ret->scheduling = ps_failover;
+                else if(policy == "quota") ret->scheduling = ps_quota;
+                else if(policy == "roundRobin") ret->scheduling = ps_roundRobin;
+                else if(policy == "lowestReject") ret->scheduling = ps_lowestReject;
+                else throw std::string("Unknown \"poolScheduling\" policy: \"" + policy + "\".");
+            }
+            if(monitorClients != root.MemberEnd()) {
+                if(monitorClients->value.IsUint() && monitorClients->value.GetUint()) ret->monitorClients = monitorClients->value.GetUint();
+                else throw std::string("\"monitorClients\" must be the maximum number of web monitor connections.");
+            }
+            if(webDeflateLevel != root.MemberEnd()) {
+                if(webDeflateLevel->value.IsUint() && webDeflateLevel->value.GetUint() <= 9) ret->webDeflateLevel = webDeflateLevel->value.GetUint();
+                else throw std::string("\"webDeflateLevel\" must be a compression level from 0 (disabled) to 9.");
+            }
+            if(webDeflateThreshold != root.MemberEnd()) {
+                if(webDeflateThreshold->value.IsUint()) ret->webDeflateThreshold = webDeflateThreshold->value.GetUint();
+                else throw std::string("\"webDeflateThreshold\" must be an amount of bytes.");
+            }
+            if(metricsPort != root.MemberEnd()) {
+                if(metricsPort->value.IsUint() && metricsPort->value.GetUint() <= 0xFFFF) ret->metricsPort = aushort(metricsPort->value.GetUint());
+                else throw std::string("\"metricsPort\" must be a TCP port or 0 to disable the metrics exporter.");
+            }
 	    }
 	    Value::ConstMemberIterator implParams = root.FindMember("implParams");
 	    if(implParams != root.MemberEnd()) ret->implParams.CopyFrom(implParams->value, ret->implParams.GetAllocator());
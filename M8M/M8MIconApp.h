@@ -40,6 +40,7 @@ public:
         icon->AddMenuSeparator();
         icon->AddMenuSeparator();
         icon->AddMenuItem(L"Exit ASAP", [this]() { run = false; });
+        icon->SetCommandWakeup([this]() { Wakeup(); });
         ChangeIcon(STATE_ICON_NORMAL);
         ChangeState(STATE_INIT, true);
         icon->BuildMenu();
@@ -73,6 +74,9 @@ protected:
 
     virtual void AddMenuItems(AbstractNotifyIcon &icon) { }
 
+    //! Called by the icon thread when a menu command is waiting for Tick. Make the main loop run, from any thread.
+    virtual void Wakeup() { }
+
     void ChangeIcon(const char *use, bool update = false) {
         if(icon) {
             compositer->SetCurrentIcon(use);
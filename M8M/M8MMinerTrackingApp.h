@@ -7,6 +7,7 @@
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/prettywriter.h>
 #include "MiningPerformanceWatcher.h"
+#include "ScanTimeHistory.h"
 #include "commands/Monitor/DeviceShares.h"
 #include "commands/Monitor/ScanTime.h"
 #include "commands/Monitor/RejectReasonCMD.h"
@@ -34,6 +35,12 @@ public:
     /*! Performance monitoring callback, called asynchronously by the miner thread(s). */
     void IterationCompleted(asizei devIndex, bool found, std::chrono::microseconds elapsed) {
         perfStats.Completed(devIndex, found, elapsed);
+        scanHistory.Record(devIndex, elapsed);
+    }
+
+    void BeginIterationTracking(asizei numDevices) {
+        scanHistory.SetNumDevices(numDevices);
+        timers.Every(std::chrono::seconds(1), [this]() { scanHistory.Tick(std::chrono::system_clock::now()); });
     }
 
     /*! Stuff returned from a mining device. Validated but potentially stale. Not sent to pool yet! */
@@ -43,8 +50,9 @@ public:
         dst.found += found.Total();
         dst.bad += found.wrong;
         dst.discarded += found.discarded;
+        dst.overflowed += found.overflowed;
         dst.last = std::chrono::system_clock::now();
-        if(dst.found == found.Total()) dst.first = dst.last;
+        if(found.Total() && dst.found == found.Total()) dst.first = dst.last;
         // Stale not updated here but rather from SendResults
         //dst.stale += ...
         for(auto &res : found.nonces) dst.totalDiff += res.diff;
@@ -70,6 +78,7 @@ protected:
     std::vector<std::vector<DeviceRejection>> devRejects;
 
     SyncMiningPerformanceWatcher perfStats;
+    ScanTimeHistory scanHistory;
 
     struct TimeLapseShareStats : commands::monitor::DeviceShares::ShareStats {
         std::chrono::time_point<std::chrono::system_clock> first;
@@ -78,6 +87,18 @@ protected:
         explicit TimeLapseShareStats() : totalDiff(0) { }
     };
     std::vector<TimeLapseShareStats> deviceShares;
+
+    adouble GetHashrate() const {
+        adouble sum = .0;
+        for(asizei loop = 0; loop < perfStats.GetNumDevices(); loop++) {
+            MiningPerformanceWatcherInterface::DevStats stats;
+            AbstractAlgorithm::ConfigDesc res;
+            if(perfStats.GetPerformance(stats, loop) == false || stats.avg.count() == 0) continue;
+            if(GetResources(res, auint(loop)) == false) continue;
+            sum += adouble(res.hashCount) * 1000000.0 / stats.avg.count();
+        }
+        return sum;
+    }
 private:
     // commands::monitor::DeviceShares::ValueSourceInterface ////////////////////////////////////////////////
     bool GetDeviceShareStats(commands::monitor::DeviceShares::ShareStats &out, asizei devLinearIndex) {
@@ -108,11 +108,17 @@ asizei M8MMiningApp::StartMining(const std::string &algo, const rapidjson::Value
     for(const auto &plat : computeNodes) { // we could limit this to only used devices or only used by this miner, but handy to have
         for(const auto &dev : plat.devices) miner->linearDevice.insert(std::make_pair(dev.clid, dev.linearIndex));
     }
+    BeginIterationTracking(GetNumDevices());
     miner->onIterationCompleted = [this](asizei devIndex, bool found, std::chrono::microseconds elapsed) {
         IterationCompleted(devIndex, found, elapsed);
     };
+    miner->onFailover = [this](asizei devIndex, const void *from, const void *to, std::chrono::microseconds gap) {
+        Failover(devIndex, from, to, gap);
+    };
+    miner->onResults = [this]() { Wakeup(); };
     // Before creating the miners let's register the pools. It could be done anywhere but I like to validate some configuration first.
-    for(asizei loop = 0; loop < GetNumServers(); loop++) miner->RegisterWorkProvider(GetPool(loop));
+    for(asizei loop = 0; loop < GetNumServers(); loop++) miner->RegisterWorkProvider(GetPool(loop), GetServerInfo(loop).scheduling);
+    miner->SetPoolScheduling(scheduling);
     // Ok, now we're ready. Almost. I will now have to iterate the devices and configs once again.
     // Yes, I take it easy. It's a fast operation anyway, how many devices can you have?
     asizei launched = 0;
@@ -124,27 +130,28 @@ asizei M8MMiningApp::StartMining(const std::string &algo, const rapidjson::Value
         }
     }
     this->miner = std::move(miner);
+    timers.Every(std::chrono::minutes(1), [this]() { CheckMinerStatus(); });
+    timers.Every(std::chrono::seconds(10), [this]() { UpdatePoolRates(); });
+    UpdatePoolRates(); // take a first hash count so the first rate is over the whole period
+    if(sources.Flushed() == false) {
+        flushCheck = timers.Every(std::chrono::seconds(30), [this]() {
+            for(asizei check = 0; check < this->miner->GetNumWorkQueues()[1]; check++) {
+                auto stat(this->miner->GetTerminationReason(check));
+                if(std::get<1>(stat) != this->miner->s_created) sources.Initialized(check);
+            }
+        });
+    }
     return launched;
 }
 
 
 void M8MMiningApp::Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
     if(miner) TickMiner();
-    if(sources.Flushed() == false) {
-        if(miner) {
-            using namespace std::chrono;
-            static const seconds pollInterval(30);
-            static system_clock::time_point lastCheck;
-            if(lastCheck == system_clock::time_point()) lastCheck = system_clock::now();
-            else if(system_clock::now() >= lastCheck + pollInterval) {
-                for(asizei check = 0; check < miner->GetNumWorkQueues()[1]; check++) {
-                    auto stat(miner->GetTerminationReason(check));
-                    if(std::get<1>(stat) != miner->s_created) sources.Initialized(check);
-                }
-                lastCheck = system_clock::now();
-            }
+    if(sources.Flushed() == false) { // miner initialization is polled by a timer, see StartMining
+        if(sources.GetNumRegisteredConsumers() == sources.GetNumInitializedConsumers() || !miner) {
+            sources.Flush();
+            timers.Cancel(flushCheck);
         }
-        if(sources.GetNumRegisteredConsumers() == sources.GetNumInitializedConsumers() || !miner) sources.Flush();
     }
     M8MPoolMonitoringApp::Refresh(toRead, toWrite);
 }
@@ -242,8 +249,7 @@ void M8MMiningApp::TickMiner() {
     NonceOriginIdentifier from;
     VerifiedNonces sharesFound;
     using namespace std::chrono;
-    static system_clock::time_point nextStatusCheck;
-    if(miner->ResultsFound(from, sharesFound)) {
+    while(miner->ResultsFound(from, sharesFound)) { // they are signaled by onResults so get them all now
         if(firstNonce == system_clock::time_point()) {
             firstNonce = system_clock::now();
             std::wstring msg(L"Found my first result!\n");
@@ -260,26 +266,43 @@ void M8MMiningApp::TickMiner() {
         UpdateDeviceStats(sharesFound); // this one goes to a derived class
         SendResults(from, sharesFound); // this to a base class
     }
+}
 
-    if(nextStatusCheck == system_clock::time_point()) nextStatusCheck = system_clock::now() + minutes(1);
-    else if(nextStatusCheck < system_clock::now()) {
-        nextStatusCheck += minutes(1);
-        auto status(miner->GetNumWorkQueues());
-        if(status[0] == status[1]) Error(L"All miners failed!");
-        else if(status[0]) Error(std::to_wstring(status[0]) + L"miner" + (status[0] > 1? L"s" : L"") + L" failed!");
-        else {
-            asizei slow = 0;
-            for(asizei loop = 0; loop < status[1]; loop++) {
-                auto probe(miner->GetTerminationReason(loop));
-                if(std::get<1>(probe) == miner->s_created) continue; // not very likely considering a result has been already found by somebody else
-                auto lastWU(miner->GetLastWUGenTime(loop));
-                if(lastWU + minutes(5) < std::chrono::system_clock::now()) slow++;
-                // In theory this should be a function of block time so for BTC we need at least 10 minutess to force a change by changing block.
-                // Everybody else use shorter blocks (BSTY being a notable exception) we should be rolling work anyway if we run out of nonce2 bits.
-                // Soooo... this is cutting it short. But I don't care.
-            }
-            if(slow) Error(L"Some miners are not generating any work!");
+
+void M8MMiningApp::CheckMinerStatus() {
+    using namespace std::chrono;
+    auto status(miner->GetNumWorkQueues());
+    if(status[0] == status[1]) Error(L"All miners failed!");
+    else if(status[0]) Error(std::to_wstring(status[0]) + L"miner" + (status[0] > 1? L"s" : L"") + L" failed!");
+    else {
+        asizei slow = 0;
+        for(asizei loop = 0; loop < status[1]; loop++) {
+            auto probe(miner->GetTerminationReason(loop));
+            if(std::get<1>(probe) == miner->s_created) continue; // not very likely considering a result has been already found by somebody else
+            auto lastWU(miner->GetLastWUGenTime(loop));
+            if(lastWU + minutes(5) < std::chrono::system_clock::now()) slow++;
+            // In theory this should be a function of block time so for BTC we need at least 10 minutess to force a change by changing block.
+            // Everybody else use shorter blocks (BSTY being a notable exception) we should be rolling work anyway if we run out of nonce2 bits.
+            // Soooo... this is cutting it short. But I don't care.
         }
+        if(slow) Error(L"Some miners are not generating any work!");
+    }
+}
+
+
+void M8MMiningApp::UpdatePoolRates() {
+    using namespace std::chrono;
+    const auto now(system_clock::now());
+    const adouble elapsed = poolRatesUpdated == system_clock::time_point()? .0 : duration_cast<milliseconds>(now - poolRatesUpdated).count() / 1000.0;
+    poolRatesUpdated = now;
+    poolRates.resize(GetNumServers());
+    for(asizei loop = 0; loop < GetNumServers(); loop++) {
+        const aulong hashes = miner->GetHashCount(GetPool(loop));
+        if(elapsed > .0) poolRates[loop].rate = (hashes - poolRates[loop].hashes) / elapsed;
+        poolRates[loop].hashes = hashes;
+        // Also feed the pool scheduler with up to date share responses.
+        commands::monitor::PoolStats::ShareStats shares;
+        if(GetPoolShareStats(shares, loop)) miner->SetShareCounts(GetPool(loop), shares.accepted, shares.rejected);
     }
 }
 
@@ -333,7 +356,8 @@ void M8MMiningApp::GenQueue(Device &dev, cl_context ctx, const rapidjson::Value
     build.ctx = ctx;
     build.dev = dev.clid;
     build.identifier = factory->GetAlgoIdentifier();
-    AbstractAlgorithm::DescribeResources(dev.resources.memUsage, build.res);
+    build.midstate = factory->GetMidstateKind();
+    dev.resources.aliasingSavings = AbstractAlgorithm::DescribeResources(dev.resources.memUsage, build.res, build.kern);
     // At this point we used to init this work queue. This is now just matters of adding an entry and spawning a thread.
     const std::string algoFamily(factory->GetAlgoIdentifier().algorithm);
     auto lambda = [this](std::vector<std::string> &errors, const std::string &kernFile) -> std::pair<const char*, asizei> {
@@ -40,6 +40,9 @@ public:
     but - surprise - it just isn't worth it. */
     asizei StartMining(const std::string &algo, const rapidjson::Value &allConfigs);
 
+    //! How devices are spread across pools. Only considered by StartMining, default is ps_failover.
+    void SetPoolScheduling(PoolScheduling policy) { scheduling = policy; }
+
     void Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
 
     ~M8MMiningApp() {
@@ -60,6 +63,17 @@ private:
     bool validConfigSelected = false;
     std::string miningAlgorithm;
     std::unique_ptr<NonceFindersInterface> miner;
+    PoolScheduling scheduling = ps_failover;
+
+    //! Hashes per second for each pool, updated every 10 seconds by a timer as hash counts are cumulative.
+    struct PoolRate {
+        aulong hashes = 0; //!< at last update
+        adouble rate = .0;
+    };
+    std::vector<PoolRate> poolRates;
+    std::chrono::system_clock::time_point poolRatesUpdated;
+    void UpdatePoolRates();
+    adouble GetPoolHashrate(asizei poolIndex) const { return poolIndex < poolRates.size()? poolRates[poolIndex].rate : .0; }
     struct Device {
         cl_device_id clid = 0;
         auint linearIndex = 0;
@@ -130,6 +144,8 @@ private:
     KnownConstantProvider cryptoConstants;
 
     void TickMiner();
+    void CheckMinerStatus(); //!< every minute, complain if miners died or stopped getting work
+    TimerQueue::TimerID flushCheck = 0; //!< polls miner initialization until algorithm sources can be released
 
     //! Helper function to StartMining
     bool GenFactory(std::vector<std::pair<const char*, AbstractAlgoFactory*>> &factories, std::unique_ptr<AbstractNonceFindersBuild> &miner,
@@ -143,6 +159,9 @@ protected:
     /*! Why is the given device not mapped to to the given config? Again, temporary objects here. */
     virtual void AddDeviceReject(asizei config, std::string &utf8, asizei devIndex) = 0;
 
+    /*! Called by StartMining before miner threads are created, anything IterationCompleted writes to can be sized there. */
+    virtual void BeginIterationTracking(asizei numDevices) = 0;
+
     /*! Performance monitoring callback, called asynchronously by the miner thread(s). */
     virtual void IterationCompleted(asizei devIndex, bool found, std::chrono::microseconds elapsed) = 0;
 
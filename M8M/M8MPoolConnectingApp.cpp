@@ -10,6 +10,8 @@ bool M8MPoolConnectingApp::AddPool(const PoolInfo &copy, const CanonicalInfo &al
     pools.back().source = std::make_unique<WorkSource>(copy.name, algoInfo, std::make_pair(copy.diffMode, copy.diffMul), copy.merkleMode);
     auto &source(*pools.back().source);
     source.AddCredentials(copy.user, copy.pass);
+    source.SetReceiveCeiling(copy.recvCeiling);
+    source.SetExtranonceSubscribe(copy.extranonceSubscribe);
     source.errorCallback = [this](const AbstractWorkSource &owner, asizei i, int errorCode, const std::string &message) {
         StratumError(owner, i, errorCode, message);
     };
@@ -25,6 +27,7 @@ bool M8MPoolConnectingApp::AddPool(const PoolInfo &copy, const CanonicalInfo &al
 
 asizei M8MPoolConnectingApp::BeginPoolActivation(const char *algo) {
     asizei activated = 0;
+    activeAlgo = algo;
     for(auto &entry : pools) {
         if(_stricmp(entry.config.algo.c_str(), algo)) { // different algos get disabled.
             if(entry.route) {
@@ -43,20 +46,8 @@ asizei M8MPoolConnectingApp::BeginPoolActivation(const char *algo) {
             // Or perhaps not, if connection fails but that's nothing I can fix there!
             activated++; // they still count however.
         }
-        else {
-            const char *port = entry.config.explicitPort.length()? entry.config.explicitPort.c_str() : entry.config.service.c_str();
-            auto conn(network.BeginConnection(entry.config.host.c_str(), port));
-            if(conn.first == nullptr) {
-                ConnectionState(*entry.source, MapError(conn.second));
-                // A failing connection is a very bad thing. It probably just makes sense to bail out but in case it's transient,
-                // let's retry with a multiple of retry delay. It's really odd so give it quite some time to clear out.
-                entry.nextReconnect = std::chrono::system_clock::now() + reconnectDelay * 4;
-            }
-            else {
-                entry.route = conn.first;
-                activated++;
-                ConnectionState(*entry.source, ce_connecting);
-            }
+        else if(activated <= hotStandby) {
+            if(Connect(entry)) activated++;
             // note pool is not activated yet; they are activated in Refresh() when their connection is ready.
         }
     }
@@ -76,24 +67,17 @@ void M8MPoolConnectingApp::FillSleepLists(std::vector<Network::SocketInterface*>
 
 void M8MPoolConnectingApp::Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
     M8MConfiguredApp::Tick();
+    timers.Fire();
     // First of all, shut down pools whose connection has gone down.
     auto goodbye = [this](Network::SocketInterface *test) {
         if(!test) return; // this happens as Network::SleepOn clears dormient sockets.
         if(test->Works()) return;
         auto entry(std::find_if(pools.begin(), pools.end(), [test](Pool &entry) { return entry.route == test; }));
         if(entry == pools.end()) return; // this could be for example a mini-server web socket
-        ConnectionState(*entry->source, ce_failed);
-        entry->source->Disconnected();
-        network.CloseConnection(*entry->route);
-        entry->route = nullptr;
-
-        auto zero = std::chrono::system_clock::time_point();
-        if(entry->activated != zero) {
-            auto now(std::chrono::system_clock::now());
-            entry->totalTime += now - entry->activated;
-            entry->activated = zero;
-            entry->nextReconnect = now + reconnectDelay;
-        }
+        // Name resolution is asynchronous so a connection can fail before even trying, tell that from losing it.
+        auto error = entry->source->Ready()? NetworkInterface::ce_ok : network.GetConnectionError(*entry->route);
+        if(error != NetworkInterface::ce_ok) ConnectFailed(*entry, error);
+        else ConnectionLost(*entry);
     };
     for(auto entry : toRead) goodbye(entry);
     for(auto entry : toWrite) goodbye(entry);
@@ -113,7 +97,12 @@ void M8MPoolConnectingApp::Refresh(std::vector<Network::SocketInterface*> &toRea
         else {
             if(happens.bytesReceived) PoolCommand(pool);
             if(happens.diffChanged) DiffChange(pool, pool.GetCurrentDiff());
-            if(happens.newWork) WorkChange(pool, std::unique_ptr<stratum::AbstractWorkFactory>(pool.GenWork()));
+            if(happens.newWork) {
+                entry.lastWork = std::chrono::system_clock::now();
+                entry.stale = false;
+                std::unique_ptr<stratum::AbstractWorkFactory> work(pool.GenWork());
+                WorkChange(pool, work);
+            }
         }
     }
     // Then initialize pools which have just connected.
@@ -123,10 +112,27 @@ void M8MPoolConnectingApp::Refresh(std::vector<Network::SocketInterface*> &toRea
         if(!activated(toWrite, entry.route)) continue;
         entry.activated = std::chrono::system_clock::now();
         entry.numActivations++;
+        entry.lastConnectTime = std::chrono::duration_cast<std::chrono::microseconds>(entry.activated - entry.connectStarted);
+        entry.totalConnectTime += entry.lastConnectTime;
+        entry.lastWork = std::chrono::system_clock::time_point();
+        entry.stale = false;
+        entry.suggestedDiff = .0;
+        if(entry.config.diffHint == PoolInfo::dh_password) { // no estimate yet --> keep what was sent last time, if anything
+            const adouble diff = GetWantedDiff(entry);
+            if(diff > .0) entry.source->SetPasswordDifficulty(diff);
+        }
         entry.source->Use(entry.route); // what if connection failed? Nothing. We try anyway and then bail out.
+        if(entry.config.diffHint == PoolInfo::dh_suggest) { // best sent before the pool decides a starting difficulty by itself
+            entry.suggestedDiff = GetWantedDiff(entry);
+            if(entry.suggestedDiff > .0) entry.source->SuggestDifficulty(entry.suggestedDiff);
+            entry.lastSuggestion = entry.activated;
+        }
         ConnectionState(*entry.source, ce_ready);
     }
+    // Those also keep their timers up to date with what happened above. Difficulty suggestions only go by timer.
+    CheckStaleWork();
     AttemptReconnections();
+    BalanceStandby();
 }
 
 
@@ -170,23 +176,140 @@ void M8MPoolConnectingApp::AttemptReconnections() {
     asizei restarted = 0;
     auto now(std::chrono::system_clock::now());
     auto zero = std::chrono::system_clock::time_point(); // for some reason writing this with init syntax makes Intellisense think it's a function
+    auto earliest(zero);
     for(auto &entry : pools) {
         if(entry.nextReconnect == zero) continue;
-        if(entry.nextReconnect > now) continue;
-
-        const char *port = entry.config.explicitPort.length()? entry.config.explicitPort.c_str() : entry.config.service.c_str();
-        auto conn(network.BeginConnection(entry.config.host.c_str(), port));
-        if(conn.first == nullptr) {
-            ConnectionState(*entry.source, MapError(conn.second));
-            // A failing connection is a very bad thing. It probably just makes sense to bail out but in case it's transient,
-            // let's retry with a multiple of retry delay. It's really odd so give it quite some time to clear out.
-            entry.nextReconnect = std::chrono::system_clock::now() + reconnectDelay * 4;
+        if(entry.nextReconnect <= now && Connect(entry)) restarted++;
+        else if(earliest == zero || entry.nextReconnect < earliest) earliest = entry.nextReconnect; // not yet or failed again
+    }
+    if(earliest == zero) timers.Cancel(reconnectTimer);
+    else timers.Reschedule(reconnectTimer, earliest, [this]() {
+        AttemptReconnections();
+        BalanceStandby();
+    });
+}
+
+
+bool M8MPoolConnectingApp::Connect(Pool &entry) {
+    const char *port = entry.config.explicitPort.length()? entry.config.explicitPort.c_str() : entry.config.service.c_str();
+    auto conn(network.BeginConnection(entry.config.host.c_str(), port));
+    if(conn.first == nullptr) {
+        ConnectFailed(entry, conn.second);
+        return false;
+    }
+    entry.route = conn.first;
+    entry.connectStarted = std::chrono::system_clock::now();
+    entry.nextReconnect = std::chrono::system_clock::time_point();
+    ConnectionState(*entry.source, ce_connecting);
+    return true;
+}
+
+
+void M8MPoolConnectingApp::ConnectFailed(Pool &entry, NetworkInterface::ConnectionError error) {
+    ConnectionState(*entry.source, MapError(error));
+    if(entry.route) {
+        network.CloseConnection(*entry.route);
+        entry.route = nullptr;
+    }
+    // A failing connection is a very bad thing. It probably just makes sense to bail out but in case it's transient,
+    // let's retry with a multiple of retry delay. It's really odd so give it quite some time to clear out.
+    entry.nextReconnect = std::chrono::system_clock::now() + reconnectDelay * 4;
+}
+
+
+void M8MPoolConnectingApp::ConnectionLost(Pool &entry) {
+    ConnectionState(*entry.source, ce_failed);
+    entry.source->Disconnected();
+    network.CloseConnection(*entry.route);
+    entry.route = nullptr;
+
+    auto zero = std::chrono::system_clock::time_point();
+    if(entry.activated != zero) {
+        auto now(std::chrono::system_clock::now());
+        entry.totalTime += now - entry.activated;
+        entry.activated = zero;
+        entry.nextReconnect = now + reconnectDelay;
+    }
+}
+
+
+void M8MPoolConnectingApp::Deactivate(Pool &entry) {
+    ConnectionState(*entry.source, ce_closing);
+    entry.source->Shutdown();
+    network.CloseConnection(*entry.route);
+    entry.route = nullptr;
+
+    auto zero = std::chrono::system_clock::time_point();
+    if(entry.activated != zero) {
+        entry.totalTime += std::chrono::system_clock::now() - entry.activated;
+        entry.activated = zero;
+    }
+}
+
+
+void M8MPoolConnectingApp::BalanceStandby() {
+    if(hotStandby == asizei(-1) || activeAlgo.empty()) return;
+    auto zero = std::chrono::system_clock::time_point();
+    asizei live = 0, connecting = 0; // only pools producing work can replace a backup, the others just avoid connecting more
+    for(auto &entry : pools) {
+        if(_stricmp(entry.config.algo.c_str(), activeAlgo.c_str())) continue;
+        if(entry.route) {
+            if(live > hotStandby) Deactivate(entry); // a better pool came back, this is not needed anymore
+            else if(entry.source->Ready() == false || entry.lastWork == zero) connecting++; // the backup keeps mining meanwhile
+            else if(entry.stale == false) live++; // stale pools are about to be dropped, a backup for them is needed
         }
-        else {
-            entry.route = conn.first;
-            restarted++;
-            entry.nextReconnect = zero;
-            ConnectionState(*entry.source, ce_connecting);
+        else if(entry.nextReconnect == zero && live + connecting <= hotStandby) {
+            if(Connect(entry)) connecting++;
+        }
+    }
+}
+
+
+void M8MPoolConnectingApp::CheckStaleWork() {
+    if(staleWork.count() == 0) return;
+    const auto now(std::chrono::system_clock::now());
+    const auto zero = std::chrono::system_clock::time_point();
+    auto earliest(zero);
+    for(auto &entry : pools) {
+        if(entry.route == nullptr || entry.source->Ready() == false) continue;
+        const auto since(entry.lastWork != zero? entry.lastWork : entry.activated);
+        if(now >= since + staleWork && entry.stale == false) {
+            entry.stale = true;
+            std::unique_ptr<stratum::AbstractWorkFactory> nothing;
+            WorkChange(*entry.source, nothing);
+            ConnectionState(*entry.source, ce_stale);
+        }
+        else if(now >= since + staleWork * 2) { // maybe the connection died without us noticing
+            ConnectionLost(entry);
+            continue;
         }
+        const auto deadline(since + staleWork * (entry.stale? 2 : 1));
+        if(earliest == zero || deadline < earliest) earliest = deadline;
+    }
+    if(earliest == zero) timers.Cancel(staleTimer);
+    else timers.Reschedule(staleTimer, earliest, [this]() { CheckStaleWork(); });
+}
+
+
+adouble M8MPoolConnectingApp::GetWantedDiff(const Pool &pool) const {
+    if(pool.config.targetShareRate <= .0) return .0;
+    const adouble hashrate = GetPoolHashrate(&pool - pools.data());
+    if(hashrate <= .0) return .0;
+    const adouble hashesPerShare = hashrate * 60.0 / pool.config.targetShareRate;
+    return hashesPerShare / pool.source->GetHashesPerShare(1.0);
+}
+
+
+void M8MPoolConnectingApp::SuggestDifficulties() {
+    const auto now(std::chrono::system_clock::now());
+    for(auto &entry : pools) {
+        if(entry.config.diffHint != PoolInfo::dh_suggest) continue;
+        if(entry.source->Ready() == false) continue;
+        const adouble diff = GetWantedDiff(entry);
+        if(diff <= .0) continue;
+        if(entry.suggestedDiff > .0 && diff > entry.suggestedDiff * .75 && diff < entry.suggestedDiff * 1.25) continue;
+        entry.source->SuggestDifficulty(diff);
+        entry.suggestedDiff = diff;
+        entry.lastSuggestion = now;
     }
 }
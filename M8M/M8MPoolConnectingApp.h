@@ -7,6 +7,7 @@
 #include "M8MConfiguredApp.h"
 #include "commands/Monitor/PoolCMD.h"
 #include "../Common/WorkSource.h"
+#include "../Common/TimerQueue.h"
 #include "NonceStructs.h"
 
 /*! Managing pool connections was originally part of the "Connections" object, later renamed "PoolManager".
@@ -19,7 +20,9 @@ The main problem is that pools have (had) a serious quirk: they needed an algori
 So I'm taking the chance to refactor a bit more extensively and get the rid of that shit. */
 class M8MPoolConnectingApp : public M8MConfiguredApp, protected commands::monitor::PoolCMD::PoolEnumeratorInterface {
 public:
-    M8MPoolConnectingApp(NetworkInterface &factory) : network(factory) { }
+    M8MPoolConnectingApp(NetworkInterface &factory) : network(factory) {
+        timers.Every(std::chrono::seconds(60), [this]() { SuggestDifficulties(); });
+    }
     /*! Takes ownership of pointer and generates persistent state about the pool.
     \returns False if pool uses an unknown algorithm. */
     bool AddPool(const PoolInfo &copy, const CanonicalInfo &algoInfo);
@@ -32,12 +35,32 @@ public:
 
     void SetReconnectDelay(std::chrono::seconds retry) { reconnectDelay = retry; }
 
+    /*! By default all the pools using the current algorithm are connected at once so miners can move to the next one as soon as the
+    current one goes down. This limits the amount of pools kept connected in addition to the first working one, in config order.
+    When a connected pool goes down the next one is pulled up right away so there are always count backup pools ready to go, their
+    latest job already fetched. When a better pool comes back, the last one is shut down. asizei(-1) to connect everything. */
+    void SetHotStandby(asizei count) { hotStandby = count; }
+
+    /*! Pools can stay connected and still stop sending new jobs. If no mining.notify arrives for this long, the pool work is withdrawn
+    so miners move to the next pool. If nothing arrives for twice as long, the connection is considered dead and closed.
+    0 (default) to trust pools forever. */
+    void SetStaleWorkTimeout(std::chrono::seconds timeout) { staleWork = timeout; }
+
 	virtual void FillSleepLists(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
     virtual void Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
 
+    //! Milliseconds the main loop can sleep before a timer expires, asizei(-1) if none. Pass to SleepOn.
+    asizei GetSleepTime() const { return timers.Timeout(); }
+
 protected:
     NetworkInterface &network;
 
+    /*! Everything which has to happen at a given time rather than as a reaction to I/O goes there and gets called by Refresh.
+    Stuff happening in other threads calls Wakeup instead. */
+    TimerQueue timers;
+
+    void Wakeup() { network.Wake(); }
+
     //! Most of the time, this is called before ShareResponse, signaling reject.
     virtual void StratumError(const AbstractWorkSource &owner, asizei i, int errorCode, const std::string &message) = 0;
 
@@ -59,6 +82,7 @@ protected:
         ce_ready,
         ce_closing,
         ce_failed,
+        ce_stale, //!< still connected but not producing new work, see SetStaleWorkTimeout
 
         // Those are generated when the pool socket attempts connection. See NetworkInterface::ConnectionError
         ce_failedResolve,
@@ -92,6 +116,14 @@ protected:
         });
     }
 
+    /*! Time from starting a connection to the socket being ready for the stratum handshake, name resolution included.
+    \param average If true, averaged across all successful connections, otherwise the last one. 0 if never connected. */
+    std::chrono::microseconds GetConnectLatency(asizei index, bool average) const {
+        const Pool &pool(pools[index]);
+        if(average == false || pool.numActivations == 0) return pool.lastConnectTime;
+        return pool.totalConnectTime / pool.numActivations;
+    }
+
     struct ShareIdentifier {
         const AbstractWorkSource *owner;
         asizei shareIndex;
@@ -114,6 +146,10 @@ protected:
 
     virtual void BadHashes(const AbstractWorkSource &owner, asizei linDevice, asizei badCount) = 0;
 
+    /*! Hashes per second computed by all devices using work from the pool, 0 if not known yet.
+    Used to suggest difficulty to pools with targetShareRate and by the poolStats command. */
+    virtual adouble GetPoolHashrate(asizei poolIndex) const = 0;
+
     // PoolEnumeratorInterface ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     asizei GetNumServers() const { return pools.size(); }
     const PoolInfo& GetServerInfo(asizei i) const { return pools[i].config; }
@@ -134,6 +170,12 @@ private:
         asizei numActivations = 0;
         std::chrono::system_clock::duration totalTime; //!< When a pool is deactivated this gets incremented. Watch out to fix active pools.
         std::chrono::system_clock::time_point nextReconnect; //!< mostly 0. Set to a future time point when a connection goes down.
+        std::chrono::system_clock::time_point lastWork; //!< last time the pool sent a job on current connection, 0 if none
+        bool stale = false; //!< work has been withdrawn as lastWork is too old, see SetStaleWorkTimeout
+        adouble suggestedDiff = .0; //!< last value sent by mining.suggest_difficulty on current connection, 0 if none
+        std::chrono::system_clock::time_point lastSuggestion;
+        std::chrono::system_clock::time_point connectStarted; //!< last time BeginConnection was called for this
+        std::chrono::microseconds lastConnectTime { 0 }, totalConnectTime { 0 }; //!< see GetConnectLatency
 
         std::unique_ptr<WorkSource> source; //!< This is created when InitPools for the corresponding algo is called and then stays persistent.
         Network::ConnectedSocketInterface *route = nullptr; //!< Created when Activate is called
@@ -142,7 +184,15 @@ private:
             config = std::move(other.config);
             activated = std::move(other.activated);
             numActivations = other.numActivations;
-            totalTime = std::move(totalTime);
+            totalTime = std::move(other.totalTime);
+            nextReconnect = std::move(other.nextReconnect);
+            lastWork = std::move(other.lastWork);
+            stale = other.stale;
+            suggestedDiff = other.suggestedDiff;
+            lastSuggestion = std::move(other.lastSuggestion);
+            connectStarted = std::move(other.connectStarted);
+            lastConnectTime = other.lastConnectTime;
+            totalConnectTime = other.totalConnectTime;
             source = std::move(other.source);
             route = other.route;
             other.route = nullptr;
@@ -152,5 +202,40 @@ private:
     };
     std::vector<Pool> pools;
     std::chrono::seconds reconnectDelay = std::chrono::seconds(30);
+    asizei hotStandby = asizei(-1);
+    std::chrono::seconds staleWork = std::chrono::seconds(0);
+    std::string activeAlgo; //!< last passed to BeginPoolActivation
     void AttemptReconnections();
+
+    /*! Start connecting to the pool, the stratum handshake takes place in Refresh when the socket becomes writable.
+    \returns false if the connection could not even be started, in that case a reconnection is scheduled after a while. */
+    bool Connect(Pool &entry);
+
+    /*! The connection never got to work: name not resolved, no reachable address... Report the error and retry much later,
+    it's unlikely to clear out quickly. Also used when the connection could not even be started, then entry has no route. */
+    void ConnectFailed(Pool &entry, NetworkInterface::ConnectionError error);
+
+    //! Close the connection of an active pool and book keep its time. The pool will be reconnected after reconnectDelay.
+    void ConnectionLost(Pool &entry);
+
+    //! Close the connection of an active pool because it's not needed anymore, it won't be reconnected.
+    void Deactivate(Pool &entry);
+
+    /*! Only does something when hotStandby is set. Walks the pools in config order and makes sure the first hotStandby + 1 not
+    waiting for reconnection are connected, deactivating the others. A pool still connecting or waiting for its first job does not
+    count yet so the backup it will replace keeps mining until then. */
+    void BalanceStandby();
+
+    //! Withdraw work from pools not producing new jobs and eventually drop their connection. \sa SetStaleWorkTimeout
+    void CheckStaleWork();
+
+    /*! Difficulty producing config.targetShareRate shares per minute at current hashrate.
+    Only the devices mining for this pool are considered, not the whole rig.
+    \returns 0 if the pool does not want this or its hashrate is unknown. */
+    adouble GetWantedDiff(const Pool &pool) const;
+
+    /*! Pools wanting mining.suggest_difficulty get it sent every once in a while, as hashrate settles.
+    To avoid spamming, only changes of at least 25% are sent. */
+    void SuggestDifficulties();
+    TimerQueue::TimerID reconnectTimer = 0, staleTimer = 0;
 };
@@ -131,6 +131,9 @@ void M8MPoolMonitoringApp::ConnectionState(const AbstractWorkSource &owner, Conn
             }
         }
         break;
+    case ce_stale:
+        cout<<"not sending new work, standing by.";
+        break;
     case ce_failedResolve:
         cout<<" !! Error connecting, could not resolve URL !!";
         Warning(L"Failed to resolve a pool URL");
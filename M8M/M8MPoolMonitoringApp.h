@@ -7,13 +7,32 @@
 #include "commands/Monitor/PoolStats.h"
 #include <iostream>
 #include <chrono>
+#include <mutex>
 
 class M8MPoolMonitoringApp : public M8MPoolConnectingApp,
                              protected commands::monitor::PoolStats::ValueSourceInterface {
 public:
     M8MPoolMonitoringApp(NetworkInterface &factory) : M8MPoolConnectingApp(factory) { }
 
+protected:
+    /*! Called asynchronously by the mining threads when a device leaves a pool which withdrew its work, see AbstractNonceFindersBuild::onFailover.
+    Pools are passed as opaque keys, they are only compared to the AbstractWorkSource addresses. */
+    void Failover(asizei linearDevice, const void *from, const void *to, std::chrono::microseconds gap) {
+        std::unique_lock<std::mutex> lock(failoverGuard);
+        auto &dst(failovers[from]);
+        dst.count++;
+        dst.last = gap;
+        if(gap > dst.longest) dst.longest = gap;
+    }
+
 private:
+    struct FailoverStats {
+        auint count = 0;
+        std::chrono::microseconds last { 0 }, longest { 0 };
+    };
+    std::map<const void*, FailoverStats> failovers; //!< not in TimeLapsePoolStats as it's written by the mining threads
+    std::mutex failoverGuard;
+
     struct TimeLapsePoolStats : commands::monitor::PoolStats::ShareStats {
         std::chrono::time_point<std::chrono::system_clock> first;
         adouble acceptedDiff;
@@ -43,10 +62,26 @@ private:
 	    so, counting the separator they'll still be 5 chars unless the value is still big enough to not require decimals (2) so you'll get 4 chars total. */
     static std::string Suffixed(double value);
 
+protected:
     // commands::monitor::PoolShares::ValueSourceInterface //////////////////////////////////////////////////
     bool GetPoolShareStats(commands::monitor::PoolStats::ShareStats &out, asizei poolIndex) {
         if(poolIndex >= poolShares.size()) return false;
         out = poolShares[poolIndex];
+        out.hashrate = GetPoolHashrate(poolIndex);
+        out.lastConnectLatency = GetConnectLatency(poolIndex, false);
+        out.avgConnectLatency = GetConnectLatency(poolIndex, true);
+        if(poolShares[poolIndex].src) {
+            const auto recv(poolShares[poolIndex].src->GetReceiveStats());
+            out.recvBuffered = recv.buffered;
+            out.recvCopied = recv.copied;
+            std::unique_lock<std::mutex> lock(failoverGuard);
+            const auto gaps(failovers.find(poolShares[poolIndex].src));
+            if(gaps != failovers.cend()) {
+                out.failovers = gaps->second.count;
+                out.lastFailoverGap = gaps->second.last;
+                out.longestFailoverGap = gaps->second.longest;
+            }
+        }
         return true;
     }
 };
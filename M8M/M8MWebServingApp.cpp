@@ -5,6 +5,9 @@
 #include "M8MWebServingApp.h"
 
 
+const std::chrono::seconds M8MWebServingApp::METRICS_PERIOD(1);
+
+
 void M8MWebServingApp::Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
     // Rather than driving the icon on events in callbacks, look at server states and figure out what to do each time.
     // It is way less efficient but this is not a performance path and this is much cleaner.
@@ -23,6 +26,18 @@ void M8MWebServingApp::Refresh(std::vector<Network::SocketInterface*> &toRead, s
     };
     webTick(monitor.server);
     webTick(admin.server);
+    if(metrics.server) {
+        metrics.server->Refresh(toRead, toWrite);
+        if(closing) {
+            timers.Cancel(metrics.update);
+            metrics.server.reset();
+        }
+    }
+    auto polling = [](const std::unique_ptr<AbstractWSServer> &server) { return server && server->NeedsPolling(); };
+    if(polling(monitor.server) || polling(admin.server) || (metrics.server && metrics.server->NeedsPolling())) {
+        if(timers.Pending(pollTimer) == false) pollTimer = timers.After(milliseconds(200), [] { }); // waking up is enough
+    }
+    else timers.Cancel(pollTimer);
     asizei listening = 0;
     auto accepting = [](const std::unique_ptr<AbstractWSServer> &server) { return server && server->AreYouListening() && server->AreYouClosing() == false; };
     if(accepting(monitor.server)) listening++;
@@ -54,6 +69,8 @@ void M8MWebServingApp::AddMenuItems(AbstractNotifyIcon &icon) {
     auto onAdminEnableClick = [this, &icon]() {
         if(!admin.server) {
             auto put(std::make_unique<AbstractWSServer>(network, 31001, "admin", "M8M-admin"));
+            put->SetDeflate(admin.init.deflateLevel, admin.init.deflateThreshold);
+            put->SetBinaryProtocol("M8M-admin-cbor");
             put->clientConnectionCallback = [this](aint change, asizei count) {
                 WebConnectionEvent(change, count, "admin");
             };
@@ -77,7 +94,9 @@ void M8MWebServingApp::AddMenuItems(AbstractNotifyIcon &icon) {
 
     auto onMonitorEnableClick = [this, &icon]() {
         if(!monitor.server) {
-            auto put(std::make_unique<AbstractWSServer>(network, 31000, "monitor", "M8M-monitor"));
+            auto put(std::make_unique<AbstractWSServer>(network, 31000, "monitor", "M8M-monitor", monitor.init.maxClients));
+            put->SetDeflate(monitor.init.deflateLevel, monitor.init.deflateThreshold);
+            put->SetBinaryProtocol("M8M-monitor-cbor");
             put->clientConnectionCallback = [this](aint change, asizei count) {
                 WebConnectionEvent(change, count, "monitor");
             };
@@ -99,6 +118,131 @@ void M8MWebServingApp::AddMenuItems(AbstractNotifyIcon &icon) {
 }
 
 
+void M8MWebServingApp::StartMetrics(aushort port) {
+    if(metrics.server) return;
+    metrics.server = std::make_unique<MetricsHTTPServer>(network, port);
+    metrics.server->SetMetrics(BuildMetrics());
+    metrics.server->Listen();
+    metrics.update = timers.Every(METRICS_PERIOD, [this]() { metrics.server->SetMetrics(BuildMetrics()); });
+}
+
+
+std::string M8MWebServingApp::BuildMetrics() {
+    using namespace std::chrono;
+    typedef OpenMetricsText::Labels Labels;
+    auto timestamp = [](system_clock::time_point when) { return duration_cast<microseconds>(when.time_since_epoch()).count() / 1000000.0; };
+    auto toSeconds = [](microseconds elapsed) { return elapsed.count() / 1000000.0; };
+    OpenMetricsText build;
+    build.Family("process_start_time_seconds", "gauge", "Time the program was started, since unix epoch.", "seconds");
+    build.Sample("process_start_time_seconds", nullptr, Labels(), timestamp(startTime.program));
+    build.Family("m8m_hashrate", "gauge", "Hashes per second computed by all devices.");
+    build.Sample("m8m_hashrate", nullptr, Labels(), GetHashrate());
+
+    // Families must be contiguous so all devices are collected first.
+    struct Device {
+        Labels labels;
+        bool timed;
+        MiningPerformanceWatcherInterface::DevStats perf;
+        adouble hashrate = .0;
+    };
+    deviceShares.resize(GetNumDevices());
+    std::vector<Device> devices(deviceShares.size());
+    for(asizei loop = 0; loop < devices.size(); loop++) {
+        Device &dev(devices[loop]);
+        dev.labels.push_back(std::make_pair("device", std::to_string(loop)));
+        dev.timed = perfStats.GetPerformance(dev.perf, loop);
+        AbstractAlgorithm::ConfigDesc res;
+        if(dev.timed && dev.perf.avg.count() && GetResources(res, auint(loop))) dev.hashrate = adouble(res.hashCount) * 1000000.0 / dev.perf.avg.count();
+    }
+    build.Family("m8m_device_scan_seconds", "gauge", "Time taken by an iteration. Average over the last window, last nonce found, min and max.", "seconds");
+    const char *stat[] = { "avg", "last", "min", "max" };
+    for(const auto &dev : devices) {
+        if(dev.timed == false) continue;
+        const microseconds value[] = { dev.perf.avg, dev.perf.last, dev.perf.min, dev.perf.max };
+        for(asizei loop = 0; loop < 4; loop++) {
+            Labels labels(dev.labels);
+            labels.push_back(std::make_pair("stat", stat[loop]));
+            build.Sample("m8m_device_scan_seconds", nullptr, labels, toSeconds(value[loop]));
+        }
+    }
+    /* The histogram has way too many buckets to export them, scrapers get only a few. A bucket of the histogram is counted
+    in a boundary only if all its values are <= boundary so counts are slightly underestimated there. */
+    const char *boundary[] = { "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5", "5", "10" };
+    build.Family("m8m_device_scan_time_seconds", "histogram", "Time taken by each iteration since mining started.", "seconds");
+    std::vector<aulong> snapshot;
+    for(asizei loop = 0; loop < devices.size() && loop < scanHistory.GetNumDevices(); loop++) {
+        aulong sum, count = 0;
+        scanHistory.GetHistogram(snapshot, sum, loop);
+        for(auto el : snapshot) count += el; // not the returned value, buckets would not add up if something was recorded meanwhile
+        for(auto le : boundary) {
+            Labels labels(devices[loop].labels);
+            labels.push_back(std::make_pair("le", std::string(le)));
+            build.Sample("m8m_device_scan_time_seconds", "_bucket", labels, ScanTimeHistogram::CountUpTo(snapshot, aulong(atof(le) * 1000000.0 + .5)));
+        }
+        Labels labels(devices[loop].labels);
+        labels.push_back(std::make_pair("le", "+Inf"));
+        build.Sample("m8m_device_scan_time_seconds", "_bucket", labels, count);
+        build.Sample("m8m_device_scan_time_seconds", "_count", devices[loop].labels, count);
+        build.Sample("m8m_device_scan_time_seconds", "_sum", devices[loop].labels, sum / 1000000.0);
+    }
+    build.Family("m8m_device_hashrate", "gauge", "Hashes per second computed by the device.");
+    for(const auto &dev : devices) build.Sample("m8m_device_hashrate", nullptr, dev.labels, dev.hashrate);
+    struct {
+        const char *name, *help;
+        aulong commands::monitor::DeviceShares::ShareStats::*count;
+    } nonces[] = {
+        { "m8m_device_nonces_found", "Nonces produced by the device, bad ones included.", &TimeLapseShareStats::found },
+        { "m8m_device_nonces_bad", "Nonces not matching their target when verified by the CPU.", &TimeLapseShareStats::bad },
+        { "m8m_device_nonces_discarded", "Valid nonces not meeting the share difficulty.", &TimeLapseShareStats::discarded },
+        { "m8m_device_nonces_stale", "Nonces found on work no more valid.", &TimeLapseShareStats::stale },
+        { "m8m_device_nonces_overflowed", "Nonces lost as the candidate buffer was too small.", &TimeLapseShareStats::overflowed }
+    };
+    for(const auto &family : nonces) {
+        build.Family(family.name, "counter", family.help);
+        for(asizei loop = 0; loop < devices.size(); loop++) build.Sample(family.name, "_total", devices[loop].labels, deviceShares[loop].*family.count);
+    }
+    build.Family("m8m_device_difficulty_per_second", "gauge", "Share difficulty found per second by the device.");
+    for(asizei loop = 0; loop < devices.size(); loop++) build.Sample("m8m_device_difficulty_per_second", nullptr, devices[loop].labels, deviceShares[loop].dsps);
+    build.Family("m8m_device_last_nonce_timestamp_seconds", "gauge", "Time the device produced its last nonce, since unix epoch.", "seconds");
+    for(asizei loop = 0; loop < devices.size(); loop++) {
+        if(deviceShares[loop].last != system_clock::time_point()) build.Sample("m8m_device_last_nonce_timestamp_seconds", nullptr, devices[loop].labels, timestamp(deviceShares[loop].last));
+    }
+
+    std::vector<Labels> poolLabels;
+    std::vector<commands::monitor::PoolStats::ShareStats> pools;
+    for(asizei loop = 0; loop < GetNumServers(); loop++) {
+        commands::monitor::PoolStats::ShareStats stats;
+        if(GetPoolShareStats(stats, loop) == false) continue;
+        Labels labels;
+        labels.push_back(std::make_pair("pool", std::to_string(loop)));
+        labels.push_back(std::make_pair("name", GetServerInfo(loop).name));
+        poolLabels.push_back(std::move(labels));
+        pools.push_back(stats);
+    }
+    auto poolCounter = [&build, &pools, &poolLabels](const char *name, const char *help, std::function<aulong(const commands::monitor::PoolStats::ShareStats&)> value) {
+        build.Family(name, "counter", help);
+        for(asizei loop = 0; loop < pools.size(); loop++) build.Sample(name, "_total", poolLabels[loop], value(pools[loop]));
+    };
+    auto poolGauge = [&build, &pools, &poolLabels](const char *name, const char *help, const char *unit, std::function<adouble(const commands::monitor::PoolStats::ShareStats&)> value) {
+        build.Family(name, "gauge", help, unit);
+        for(asizei loop = 0; loop < pools.size(); loop++) build.Sample(name, nullptr, poolLabels[loop], value(pools[loop]));
+    };
+    typedef commands::monitor::PoolStats::ShareStats PoolShares;
+    poolCounter("m8m_pool_shares_sent", "Shares submitted to the pool.", [](const PoolShares &pool) { return pool.sent; });
+    poolCounter("m8m_pool_shares_accepted", "Shares accepted by the pool.", [](const PoolShares &pool) { return pool.accepted; });
+    poolCounter("m8m_pool_shares_rejected", "Shares rejected by the pool.", [](const PoolShares &pool) { return pool.rejected; });
+    poolGauge("m8m_pool_difficulty_accepted_per_second", "Share difficulty accepted per second by the pool.", nullptr, [](const PoolShares &pool) { return pool.daps; });
+    poolGauge("m8m_pool_hashrate", "Hashes per second computed by devices mining for the pool.", nullptr, [](const PoolShares &pool) { return pool.hashrate; });
+    poolCounter("m8m_pool_failovers", "Times a device had to leave the pool as its work was withdrawn.", [](const PoolShares &pool) { return aulong(pool.failovers); });
+    poolGauge("m8m_pool_failover_gap_longest_seconds", "Longest time spent by devices without work after leaving the pool.", "seconds", [toSeconds](const PoolShares &pool) { return toSeconds(pool.longestFailoverGap); });
+    poolGauge("m8m_pool_connect_latency_last_seconds", "Time from starting the last connection to handshake, resolution included.", "seconds", [toSeconds](const PoolShares &pool) { return toSeconds(pool.lastConnectLatency); });
+    poolGauge("m8m_pool_connect_latency_avg_seconds", "Average time from starting a connection to handshake, resolution included.", "seconds", [toSeconds](const PoolShares &pool) { return toSeconds(pool.avgConnectLatency); });
+    poolCounter("m8m_pool_connection_attempts", "Times the pool connection was started.", [](const PoolShares &pool) { return aulong(pool.numActivationAttempts); });
+    poolGauge("m8m_pool_receive_buffered_bytes", "Bytes received from the pool waiting for a newline.", "bytes", [](const PoolShares &pool) { return adouble(pool.recvBuffered); });
+    return build.Finish();
+}
+
+
 void M8MWebServingApp::RegisterMonitorCommands(AbstractWSServer &server) {
     using namespace commands::monitor;
     RegisterCommand(server, new SystemInfoCMD(*this));
@@ -107,9 +251,12 @@ void M8MWebServingApp::RegisterMonitorCommands(AbstractWSServer &server) {
     RegisterCommand(server, new RejectReasonCMD(*this));
     RegisterCommand(server, new ConfigInfoCMD(*this));
     RegisterCommand(server, new ScanTime(perfStats));
+    RegisterCommand(server, new ScanPercentilesCMD(scanHistory));
+    RegisterCommand(server, new ScanHistoryCMD(scanHistory));
     RegisterCommand(server, new DeviceShares(*this));
     RegisterCommand(server, new PoolStats(*this));
     RegisterCommand(server, new UptimeCMD(*this));
+    RegisterCommand(server, new WebTrafficCMD(server));
     RegisterCommand(server, new commands::VersionCMD);
     RegisterCommand(server, new commands::ExtensionListCMD(extensions));
     RegisterCommand(server, new commands::UpgradeCMD(extensions));
@@ -124,6 +271,8 @@ void M8MWebServingApp::RegisterAdminCommands(AbstractWSServer &server) {
     RegisterCommand(server, new SaveRawConfigCMD(loadInfo.configFile.c_str()));
     RegisterCommand(server, new ReloadCMD([this]() {
         reloadRequested = std::chrono::system_clock::now();
+        timers.After(std::chrono::seconds(1), [] { }); // start closing servers, see Refresh
+        timers.After(std::chrono::seconds(5), [] { }); // give up, see KeepRunning
         return false; // will reload listening?
     }));
 }
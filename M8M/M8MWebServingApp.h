@@ -5,9 +5,13 @@
 #pragma once
 #include "M8MMinerTrackingApp.h"
 #include "AbstractWSServer.h"
+#include "MetricsHTTPServer.h"
 
 #include "commands/Monitor/ConfigInfoCMD.h"
 #include "commands/Monitor/UptimeCMD.h"
+#include "commands/Monitor/WebTrafficCMD.h"
+#include "commands/Monitor/ScanPercentilesCMD.h"
+#include "commands/Monitor/ScanHistoryCMD.h"
 #include "commands/VersionCMD.h"
 #include "commands/ExtensionListCMD.h"
 #include "commands/UpgradeCMD.h"
@@ -38,12 +42,23 @@ public:
         admin.init.resURI = resURI;
         admin.init.wsProtocol = wsProtocol;
     }
+    //! Dashboards can keep many monitor sessions open, see AbstractWSServer::MAX_CLIENTS_LIMIT.
+    void SetMonitorClients(auint count) { monitor.init.maxClients = count; }
+    //! permessage-deflate for both servers, see AbstractWSServer::SetDeflate.
+    void SetWebDeflate(aint level, asizei threshold) {
+        monitor.init.deflateLevel = admin.init.deflateLevel = level;
+        monitor.init.deflateThreshold = admin.init.deflateThreshold = threshold;
+    }
+    /*! Serves OpenMetrics to scrapers on the given port from now on. The exposition is rebuilt every METRICS_PERIOD,
+    scrapes in between get the same bytes. */
+    void StartMetrics(aushort port);
     bool Reboot() const { return reloadRequested != std::chrono::system_clock::time_point(); }
 
     void FillSleepLists(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
         M8MMinerTrackingApp::FillSleepLists(toRead, toWrite);
         if(monitor.server) monitor.server->FillSleepLists(toRead, toWrite);
         if(admin.server) admin.server->FillSleepLists(toRead, toWrite);
+        if(metrics.server) metrics.server->FillSleepLists(toRead, toWrite);
 	}
 
     void Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
@@ -58,17 +73,30 @@ public:
 
 private:
     std::chrono::system_clock::time_point reloadRequested; //!< leave it a couple of seconds to dispatch quit message
+    TimerQueue::TimerID pollTimer = 0; //!< keeps the loop running while servers have pushers or are closing
     std::map<std::string, commands::ExtensionState> extensions; //!< nothing really defined for the time being
 
     struct Service {
         struct InitDesc {
             aushort port;
             const char *resURI, *wsProtocol;
+            auint maxClients = 5;
+            aint deflateLevel = 6;
+            asizei deflateThreshold = 64;
         } init;
         auint openConnMI, closeMI;
         std::unique_ptr<AbstractWSServer> server;
     } monitor, admin;
 
+    const static std::chrono::seconds METRICS_PERIOD;
+    struct {
+        std::unique_ptr<MetricsHTTPServer> server;
+        TimerQueue::TimerID update = 0;
+    } metrics;
+
+    //! Runs on the main thread as everything else reading those values, the miner threads are only involved through perfStats.
+    std::string BuildMetrics();
+
     void AddMenuItems(AbstractNotifyIcon &icon);
 
 
@@ -0,0 +1,192 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#include "MetricsHTTPServer.h"
+#include <cmath>
+#include <algorithm>
+
+
+const asizei MetricsHTTPServer::MAX_REQUEST_BYTES = 4 * 1024;
+const auint MetricsHTTPServer::MAX_CLIENTS = 16;
+const std::chrono::seconds MetricsHTTPServer::CLIENT_TIMEOUT(5);
+
+
+void OpenMetricsText::Family(const char *name, const char *type, const char *help, const char *unit) {
+    text += "# TYPE ";
+    text += name;
+    text += ' ';
+    text += type;
+    text += '\n';
+    if(unit) {
+        text += "# UNIT ";
+        text += name;
+        text += ' ';
+        text += unit;
+        text += '\n';
+    }
+    text += "# HELP ";
+    text += name;
+    text += ' ';
+    text += help;
+    text += '\n';
+}
+
+
+void OpenMetricsText::Begin(const char *name, const char *suffix, const Labels &labels) {
+    text += name;
+    if(suffix) text += suffix;
+    if(labels.size()) {
+        text += '{';
+        for(asizei loop = 0; loop < labels.size(); loop++) {
+            if(loop) text += ',';
+            text += labels[loop].first;
+            text += "=\"";
+            for(char c : labels[loop].second) {
+                switch(c) {
+                case '\\': text += "\\\\"; break;
+                case '"': text += "\\\""; break;
+                case '\n': text += "\\n"; break;
+                default: text += c;
+                }
+            }
+            text += '"';
+        }
+        text += '}';
+    }
+    text += ' ';
+}
+
+
+void OpenMetricsText::Sample(const char *name, const char *suffix, const Labels &labels, adouble value) {
+    Begin(name, suffix, labels);
+    if(value != value) text += "NaN";
+    else if(std::isinf(value)) text += value > 0? "+Inf" : "-Inf";
+    else {
+        char buff[32];
+        snprintf(buff, sizeof(buff), "%.15g", value);
+        text += buff;
+    }
+    text += '\n';
+}
+
+
+void OpenMetricsText::Sample(const char *name, const char *suffix, const Labels &labels, aulong value) {
+    Begin(name, suffix, labels);
+    text += std::to_string(value);
+    text += '\n';
+}
+
+
+std::string OpenMetricsText::Finish() {
+    text += "# EOF\n";
+    std::string ret(std::move(text));
+    text.clear();
+    return ret;
+}
+
+
+void MetricsHTTPServer::Listen() {
+    if(!landing) landing = &network.NewServiceSocket(port, MAX_CLIENTS);
+}
+
+
+void MetricsHTTPServer::Close() {
+    for(auto &client : clients) network.CloseConnection(client.second.conn);
+    clients.clear();
+    if(landing) network.CloseServiceSocket(*landing);
+    landing = nullptr;
+}
+
+
+void MetricsHTTPServer::FillSleepLists(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
+    if(!landing) return;
+    toRead.push_back(landing);
+    for(const auto &entry : clients) {
+        if(entry.second.reply) toWrite.push_back(&entry.second.conn.get());
+        else toRead.push_back(&entry.second.conn.get());
+    }
+}
+
+
+void MetricsHTTPServer::Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite) {
+    if(!landing) return;
+    for(const auto &skt : toRead) {
+        auto el = clients.find(skt);
+        if(el == clients.end() || el->second.reply) continue;
+        ClientState &client(el->second);
+        auto &pipe(client.conn.get());
+        while(pipe.GotData() && client.request.length() <= MAX_REQUEST_BYTES) {
+            aubyte buff[512];
+            const asizei got = pipe.Receive(buff, sizeof(buff));
+            if(got == 0) break;
+            client.request.append(reinterpret_cast<const char*>(buff), got);
+        }
+        client.reply = Reply(client.request);
+    }
+    for(const auto &skt : toWrite) {
+        auto el = clients.find(skt);
+        if(el == clients.end() || !el->second.reply) continue;
+        ClientState &client(el->second);
+        const std::string &reply(*client.reply);
+        client.sent += client.conn.get().Send(reinterpret_cast<const aubyte*>(reply.data() + client.sent), reply.length() - client.sent);
+    }
+    const auto now(std::chrono::steady_clock::now());
+    for(auto client = clients.begin(); client != clients.end(); ) {
+        const ClientState &check(client->second);
+        bool done = check.reply && check.sent == check.reply->length();
+        done |= check.conn.get().Works() == false;
+        done |= check.accepted + CLIENT_TIMEOUT < now;
+        if(done) {
+            network.CloseConnection(check.conn);
+            client = clients.erase(client);
+        }
+        else ++client;
+    }
+    // Last pick up new connections.
+    auto newPeer = std::find(toRead.begin(), toRead.end(), landing);
+    if(newPeer != toRead.end()) {
+        auto &pipe(network.BeginConnection(*landing));
+        if(clients.size() >= MAX_CLIENTS) network.CloseConnection(pipe);
+        else clients.insert(std::make_pair(&pipe, ClientState(pipe)));
+    }
+}
+
+
+void MetricsHTTPServer::SetMetrics(const std::string &exposition) {
+    metrics = Response("200 OK", "application/openmetrics-text; version=1.0.0; charset=utf-8", exposition);
+}
+
+
+std::shared_ptr<const std::string> MetricsHTTPServer::Reply(const std::string &request) const {
+    const auto headerEnd = request.find("\r\n\r\n");
+    if(headerEnd == std::string::npos) {
+        if(request.length() <= MAX_REQUEST_BYTES) return nullptr;
+        return Response("431 Request Header Fields Too Large", "text/plain; charset=utf-8", "Request too big.\n");
+    }
+    // Request-line = Method SP Request-URI SP HTTP-Version CRLF, headers are not interesting.
+    const std::string line(request.substr(0, request.find("\r\n")));
+    const auto methodEnd = line.find(' ');
+    const auto uriEnd = methodEnd == std::string::npos? std::string::npos : line.find(' ', methodEnd + 1);
+    if(uriEnd == std::string::npos || line.compare(uriEnd + 1, 5, "HTTP/") != 0) {
+        return Response("400 Bad Request", "text/plain; charset=utf-8", "Malformed request.\n");
+    }
+    if(line.compare(0, methodEnd, "GET") != 0) return Response("405 Method Not Allowed", "text/plain; charset=utf-8", "Only GET is supported.\n");
+    std::string uri(line.substr(methodEnd + 1, uriEnd - methodEnd - 1));
+    uri = uri.substr(0, uri.find('?')); // scrapers can add parameters, we have nothing to select
+    if(uri != resURI) return Response("404 Not Found", "text/plain; charset=utf-8", "Metrics are at " + resURI + "\n");
+    if(!metrics) return Response("503 Service Unavailable", "text/plain; charset=utf-8", "Metrics not collected yet.\n");
+    return metrics;
+}
+
+
+std::shared_ptr<const std::string> MetricsHTTPServer::Response(const char *status, const char *contentType, const std::string &body) {
+    std::string build("HTTP/1.1 ");
+    build += status;
+    build += "\r\nContent-Type: ";
+    build += contentType;
+    build += "\r\nContent-Length: " + std::to_string(body.length());
+    build += "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n";
+    build += body;
+    return std::make_shared<const std::string>(std::move(build));
+}
@@ -0,0 +1,90 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../Common/Network.h"
+#include <string>
+#include <chrono>
+#include <functional>
+
+
+/*! Builds a text exposition in OpenMetrics format, https://openmetrics.io/. It does not check much: samples must be added
+right after their family and names must be valid, those are all literals in our code anyway. Only label values are escaped. */
+class OpenMetricsText {
+public:
+    typedef std::vector<std::pair<const char*, std::string>> Labels;
+
+    /*! \param type counter, gauge, histogram...
+    \param unit if not nullptr, name must end with it as in "m8m_something_seconds". */
+    void Family(const char *name, const char *type, const char *help, const char *unit = nullptr);
+
+    //! Counters have the _total suffix in their samples, not in their family name. Histograms have _bucket, _count and _sum.
+    void Sample(const char *name, const char *suffix, const Labels &labels, adouble value);
+    void Sample(const char *name, const char *suffix, const Labels &labels, aulong value);
+
+    //! Terminates the exposition and returns it, the object is left empty.
+    std::string Finish();
+
+private:
+    std::string text;
+    void Begin(const char *name, const char *suffix, const Labels &labels);
+};
+
+
+/*! Fleet monitoring scrapes the miner over plain HTTP so it can't use the WebSocket command protocol.
+This is a very small subset of HTTP/1.1: one GET request per connection, replied and closed.
+The exposition is never computed here, the outer code builds it and hands it over with SetMetrics. Scrapes only send bytes and
+never wait on whatever the values come from, the miner threads in particular. */
+class MetricsHTTPServer {
+public:
+    const aushort port;
+    const std::string resURI;
+    const static asizei MAX_REQUEST_BYTES; //!< requests bigger than this are refused, scrapers send a few hundred bytes at most
+    const static auint MAX_CLIENTS; //!< connections beyond this are accepted and immediately closed
+    const static std::chrono::seconds CLIENT_TIMEOUT; //!< peers not completing a request in this time are dropped
+
+    MetricsHTTPServer(NetworkInterface &netAPI, aushort servicePort, const char *httpRes = "/metrics")
+        : port(servicePort), resURI(httpRes), network(netAPI), landing(nullptr) { }
+    ~MetricsHTTPServer() { Close(); }
+
+    //! Create a socket and wait for scrapers to connect. Synchronous as in AbstractWSServer.
+    void Listen();
+    bool AreYouListening() const { return landing != nullptr; }
+
+    //! There's no closing handshake in HTTP, connections still being served are just dropped.
+    void Close();
+
+    void FillSleepLists(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
+    void Refresh(std::vector<Network::SocketInterface*> &toRead, std::vector<Network::SocketInterface*> &toWrite);
+
+    //! Replaces the exposition given to scrapes coming from now on, usually from OpenMetricsText::Finish.
+    void SetMetrics(const std::string &exposition);
+
+    asizei GetNumClients() const { return clients.size(); }
+
+    //! Slow clients are timed out so Refresh must be called periodically while this is true.
+    bool NeedsPolling() const { return clients.size() != 0; }
+
+private:
+    typedef std::chrono::time_point<std::chrono::steady_clock> TimePoint;
+
+    struct ClientState {
+        std::reference_wrapper<NetworkInterface::ConnectedSocketInterface> conn;
+        TimePoint accepted;
+        std::string request;
+        std::shared_ptr<const std::string> reply; //!< headers and body, shared with every other client scraping the same exposition
+        asizei sent = 0;
+        explicit ClientState(NetworkInterface::ConnectedSocketInterface &pipe) : conn(pipe), accepted(std::chrono::steady_clock::now()) { }
+    };
+    std::map<const Network::SocketInterface*, ClientState> clients;
+
+    NetworkInterface &network;
+    NetworkInterface::ServiceSocketInterface *landing;
+    std::shared_ptr<const std::string> metrics; //!< complete HTTP response, built once by SetMetrics
+
+    /*! Returns nullptr if the request is still incomplete. Otherwise, the response to send, possibly an error. */
+    std::shared_ptr<const std::string> Reply(const std::string &request) const;
+
+    static std::shared_ptr<const std::string> Response(const char *status, const char *contentType, const std::string &body);
+};
@@ -31,12 +31,19 @@ public:
     The miner thread will get full ownership of the factory, consider it gone forever. */
     virtual bool SetWorkFactory(const AbstractWorkSource &from, std::unique_ptr<stratum::AbstractWorkFactory> &factory) = 0;
 
+    /*! Pool scheduling policies might consider how pools treat our shares. Call this every once in a while with the totals.
+    \return false if owner is not being mangled by this set of devices. */
+    virtual bool SetShareCounts(const AbstractWorkSource &from, aulong accepted, aulong rejected) = 0;
+
+    //! Total amount of hashes scanned using work from the given pool. 0 if the pool is not known.
+    virtual aulong GetHashCount(const AbstractWorkSource &from) const = 0;
+
     /*! Call this whatever possible to pull out a set of results if found. Those results are guaranteed to be valid and checked to be over provided
     difficulty target however, the generating block might have become stale. Objects implementing this interface should not be concerned about
     filtering stale work, this concern belongs to someone else. Results can accumulate over time which means in theory this shall be called in a loop.
     This returns true even if no nonces are really eligible to send, that it, it reports under-target and "hw errors" by returning an empty VerifiedNonces.
     \param [out] src A value passed to RefreshBlockData, used to identify where to send the produced nonces, if any.
-    \param [out] nonces Results produced. nonces.nonces can have length 0 but nonces.nonces.length() + nonces.discarded + nonces.wrong must be always
+    \param [out] nonces Results produced. nonces.nonces can have length 0 but nonces.Total() or nonces.overflowed must be always
         > 0 on returning true. If this does not hold, just return false and update nothing. */
     virtual bool ResultsFound(NonceOriginIdentifier &src, VerifiedNonces &nonces) = 0;
 
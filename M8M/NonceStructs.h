@@ -32,6 +32,7 @@ struct MinedNonces {
     std::array<aubyte, 80> from;
     std::vector<auint> nonces;
     std::vector<auint> hashes; //!< hashes[i] is the hash produced by nonces[i], so I can test computation is correct.
+    asizei overflowed = 0; //!< candidates found by the device but not stored as the candidate buffer was too small. Lost.
     explicit MinedNonces() = default;
     MinedNonces(const std::array<aubyte, 80> &hashOriginator) : from(hashOriginator) { }
 };
@@ -43,6 +44,7 @@ Nonces might be discarded for being under target or hardware miscomputing. */
 struct VerifiedNonces {
     asizei discarded; //!< those nonces were valid but won't be returned as below target, would get rejected. We have been unlucky.
     asizei wrong; //!< those nonces produce hashes not matching across GPU and CPU validation. Also called "HW" error. Most likely not a transient error.
+    asizei overflowed; //!< those nonces were found by the device but could not be stored, lost. Dispatcher will enlarge its buffer. Not in Total().
     auint nonce2; //!< common to all nonces, assuming nonces.length() > 0, otherwise undefined
     struct Nonce {
         auint nonce; //!< the magic number to send
@@ -54,6 +56,6 @@ struct VerifiedNonces {
     std::vector<Nonce> nonces;
     asizei device; //!< device which produced the nonces for running statistics
     adouble targetDiff; //!< target diff used for the scan which produced this set of nonces.
-    VerifiedNonces() : discarded(0), wrong(0) { }
+    VerifiedNonces() : discarded(0), wrong(0), overflowed(0) { }
     asizei Total() const { return discarded + wrong + nonces.size(); }
 };
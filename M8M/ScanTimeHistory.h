@@ -0,0 +1,189 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../Common/AREN/ArenDataTypes.h"
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <cmath>
+
+
+/*! Iteration times in the spirit of HdrHistogram: values are bucketed by their magnitude (highest bit set) and the SUB_BITS bits
+following it so relative error is bounded at any scale with a fixed amount of buckets, nothing to configure.
+Values are microseconds. Counters are atomic so miner threads can record while the main thread reads. */
+class ScanTimeHistogram {
+public:
+    const static auint SUB_BITS = 6; //!< 64 buckets for each power of two, values are off by 1.6% at most
+    const static auint MAX_BITS = 32; //!< values of 2^32 us (~71 minutes) or more all go in the last bucket
+    const static auint NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    ScanTimeHistogram() {
+        for(auto &el : counts) el.store(0, std::memory_order_relaxed);
+    }
+
+    static auint Bucket(aulong us) {
+        if(us >> MAX_BITS) return NUM_BUCKETS - 1;
+        if(us >> SUB_BITS == 0) return auint(us);
+        auint magnitude = SUB_BITS;
+        while(us >> (magnitude + 1)) magnitude++;
+        return ((magnitude - SUB_BITS + 1) << SUB_BITS) + auint((us >> (magnitude - SUB_BITS)) - (1 << SUB_BITS));
+    }
+
+    //! Smallest value going in the bucket.
+    static aulong Lowest(auint bucket) {
+        const auint block = bucket >> SUB_BITS, sub = bucket & ((1 << SUB_BITS) - 1);
+        if(block == 0) return sub;
+        return aulong((1 << SUB_BITS) + sub) << (block - 1);
+    }
+
+    //! Biggest value going in the bucket, used to report values so they're never underestimated.
+    static aulong Highest(auint bucket) {
+        const auint block = bucket >> SUB_BITS;
+        return Lowest(bucket) + (block == 0? 0 : (aulong(1) << (block - 1)) - 1);
+    }
+
+    //! Lock-free, can be called by any thread.
+    void Record(aulong us) { counts[Bucket(us)].fetch_add(1, std::memory_order_relaxed); }
+
+    //! Copy the counters, the copy is not atomic as a whole so concurrent recordings might be only partially there.
+    void Snapshot(std::vector<aulong> &dst) const {
+        dst.resize(NUM_BUCKETS);
+        for(auint loop = 0; loop < NUM_BUCKETS; loop++) dst[loop] = counts[loop].load(std::memory_order_relaxed);
+    }
+
+    //! \param percentile [0..100] \returns 0 if there are no samples.
+    static aulong Percentile(const std::vector<aulong> &snapshot, adouble percentile) {
+        aulong total = 0;
+        for(auto el : snapshot) total += el;
+        if(total == 0) return 0;
+        aulong rank = aulong(std::ceil(total * (percentile < 0? 0 : (percentile > 100? 100 : percentile)) / 100.0));
+        if(rank == 0) rank = 1;
+        aulong seen = 0;
+        for(auint loop = 0; loop < snapshot.size(); loop++) {
+            seen += snapshot[loop];
+            if(seen >= rank) return Highest(loop);
+        }
+        return Highest(NUM_BUCKETS - 1);
+    }
+
+    //! How many values are <= us. Values in the bucket containing us are only counted if the whole bucket is.
+    static aulong CountUpTo(const std::vector<aulong> &snapshot, aulong us) {
+        aulong count = 0;
+        for(auint loop = 0; loop < snapshot.size() && Highest(loop) <= us; loop++) count += snapshot[loop];
+        return count;
+    }
+
+private:
+    std::atomic<aulong> counts[NUM_BUCKETS];
+};
+
+
+/*! MiningPerformanceWatcher only keeps a few values over a short window, this keeps the whole distribution of iteration times for
+each device and how iteration time evolved over time so stalls, jitter and throttling can be figured out after the fact.
+Miner threads only Record, lock-free. Everything else happens in the main thread, which calls Tick every second to roll the
+values collected so far into the time series. */
+class ScanTimeHistory {
+public:
+    const static asizei SECONDS = 10 * 60; //!< samples in the one second resolution series
+    const static asizei MINUTES = 24 * 60; //!< samples in the one minute resolution series
+
+    struct Sample {
+        std::chrono::system_clock::time_point end; //!< a sample covers the time since the previous one
+        aulong count = 0, sum = 0; //!< iterations completed and microseconds they took
+        aulong min = 0, max = 0; //!< microseconds, 0 if there were no iterations
+    };
+
+    //! Fixed size ring buffer, once full the oldest sample is overwritten.
+    class Series {
+    public:
+        explicit Series(asizei capacity) : ring(capacity) { }
+        asizei size() const { return used; }
+        //! 0 is the oldest sample.
+        const Sample& operator[](asizei i) const { return ring[(next + ring.size() - used + i) % ring.size()]; }
+        void Push(const Sample &add) {
+            ring[next] = add;
+            next = (next + 1) % ring.size();
+            if(used < ring.size()) used++;
+        }
+    private:
+        std::vector<Sample> ring;
+        asizei next = 0, used = 0;
+    };
+
+    //! Not thread safe, call this before miner threads start recording.
+    void SetNumDevices(asizei count) {
+        devices.reset(count? new Device[count] : nullptr);
+        numDevices = count;
+    }
+    asizei GetNumDevices() const { return numDevices; }
+
+    //! Lock-free, called by miner threads. Zero is how MiningPerformanceWatcher is told a device is going idle and it is ignored.
+    void Record(asizei devIndex, std::chrono::microseconds elapsed) {
+        if(devIndex >= numDevices || elapsed.count() <= 0) return;
+        const aulong us = aulong(elapsed.count());
+        Device &dev(devices[devIndex]);
+        dev.histogram.Record(us);
+        dev.total.fetch_add(1, std::memory_order_relaxed);
+        dev.totalSum.fetch_add(us, std::memory_order_relaxed);
+        dev.count.fetch_add(1, std::memory_order_relaxed);
+        dev.sum.fetch_add(us, std::memory_order_relaxed);
+        aulong seen = dev.min.load(std::memory_order_relaxed);
+        while((seen == 0 || us < seen) && !dev.min.compare_exchange_weak(seen, us, std::memory_order_relaxed)) { }
+        seen = dev.max.load(std::memory_order_relaxed);
+        while(us > seen && !dev.max.compare_exchange_weak(seen, us, std::memory_order_relaxed)) { }
+    }
+
+    /*! Main thread, every second. The counters are swapped out one at a time so an iteration recorded meanwhile can have its
+    count in a sample and its time in the next, not a big deal. */
+    void Tick(std::chrono::system_clock::time_point now) {
+        for(asizei loop = 0; loop < numDevices; loop++) {
+            Device &dev(devices[loop]);
+            Sample add;
+            add.end = now;
+            add.count = dev.count.exchange(0, std::memory_order_relaxed);
+            add.sum = dev.sum.exchange(0, std::memory_order_relaxed);
+            add.min = dev.min.exchange(0, std::memory_order_relaxed);
+            add.max = dev.max.exchange(0, std::memory_order_relaxed);
+            dev.seconds.Push(add);
+            Sample &minute(dev.minute);
+            minute.count += add.count;
+            minute.sum += add.sum;
+            if(add.min && (minute.min == 0 || add.min < minute.min)) minute.min = add.min;
+            if(add.max > minute.max) minute.max = add.max;
+            if(++dev.ticks == 60) {
+                minute.end = now;
+                dev.minutes.Push(minute);
+                minute = Sample();
+                dev.ticks = 0;
+            }
+        }
+    }
+
+    //! Main thread only.
+    const Series& GetSeconds(asizei devIndex) const { return devices[devIndex].seconds; }
+    const Series& GetMinutes(asizei devIndex) const { return devices[devIndex].minutes; }
+
+    //! Since mining started. \returns Number of iterations, sum gets their total microseconds.
+    aulong GetHistogram(std::vector<aulong> &snapshot, aulong &sum, asizei devIndex) const {
+        const Device &dev(devices[devIndex]);
+        dev.histogram.Snapshot(snapshot);
+        sum = dev.totalSum.load(std::memory_order_relaxed);
+        return dev.total.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Device {
+        std::atomic<aulong> count, sum, min, max; //!< since last Tick
+        std::atomic<aulong> total, totalSum; //!< since start, _count and _sum of the histogram
+        ScanTimeHistogram histogram;
+        Series seconds, minutes; //!< main thread only, as the following
+        Sample minute;
+        auint ticks;
+        Device() : count(0), sum(0), min(0), max(0), total(0), totalSum(0), seconds(SECONDS), minutes(MINUTES), ticks(0) { }
+    };
+    std::unique_ptr<Device[]> devices;
+    asizei numDevices = 0;
+};
@@ -7,6 +7,7 @@
 #include "AbstractAlgorithm.h"
 #include "AbstractSpecialValuesProvider.h"
 #include <set>
+#include <algorithm>
 
 /*! The stop-n-wait dispatcher takes an algorithm and uses it to drive the GPU 1 unit of work at time.
 It dispatches data and waits for result. It is basically the same thing M8M always did, which is very similar to legacy miners.
@@ -16,13 +17,24 @@ Legacy miners dispatch all the work, force it to finish, then ask for a buffer m
 of out-of-order queues which is not really needed, especially as many algos are single step.
 M8M dispatches all the work, including the map request and then **waits for it until finished**.
 An initial version of Qubit also tried to dispatch one step at time but it was nonsensically overcomplicated for no benefit.
-So in short I avoid a Finish (1) and a blocking read (2). Apparently this produces better interactivity. */
+So in short I avoid a Finish (1) and a blocking read (2). Apparently this produces better interactivity.
+
+Results are not mapped anymore. They are copied with non-blocking reads to a pinned host mirror which is mapped once and stays mapped
+for the whole dispatcher lifetime. The buffer is sized for the worst case but usually holds a few candidates at most so the read is
+split: first the small count header, then only the candidates actually stored. The candidate count is reset in-queue.
+Kernels also write a "generation" value (pulled from $dispatchData[3]) in the result header, so results from a different dispatch can
+be told apart.
+
+The candidate buffer is sized according to the expected amount of results at current target. Its capacity goes to $dispatchData[4]: kernels
+keep counting candidates past capacity but don't store them so overflowing can be detected. The lost candidates are reported and the buffer
+grows for the next dispatch. It shrinks back when difficulty goes up. Because of this, $candidates is bound at dispatch time. */
 class StopWaitDispatcher : private AbstractSpecialValuesProvider {
 public:
     AbstractAlgorithm &algo;
 
     StopWaitDispatcher(AbstractAlgorithm &drive) : algo(drive) {
-        PrepareIOBuffers(algo.context, algo.hashCount);
+        memset(midstateHeader.data(), 0, sizeof(midstateHeader));
+        PrepareIOBuffers(algo.context);
 
         // Bind value names...
         SpecialValueBinding early;
@@ -31,96 +43,136 @@ public:
         specials.push_back(NamedValue("$wuData", early));
         early.resource.buff = dispatchData;
         specials.push_back(NamedValue("$dispatchData", early));
-        early.resource.buff = candidates;
-        specials.push_back(NamedValue("$candidates", early));
+        early.resource.buff = midstate;
+        specials.push_back(NamedValue("$midstate", early));
+        SpecialValueBinding late;
+        late.earlyBound = false;
+        late.resource.index = 0;
+        specials.push_back(NamedValue("$candidates", late));
 
         cl_int err = 0;
         queue = clCreateCommandQueue(algo.context, algo.device, 0, &err);
         if(!queue || err != CL_SUCCESS) throw "Could not create command queue for device!";
+        PrepareCandidates(32);
     }
     ~StopWaitDispatcher() {
-        if(mapping) clReleaseEvent(mapping);
-        if(nonces) clEnqueueUnmapMemObject(queue, candidates, nonces, 0, NULL, NULL);
+        if(reading) {
+            clWaitForEvents(1, &reading);
+            clReleaseEvent(reading);
+        }
+        ReleaseCandidates();
         if(queue) clReleaseCommandQueue(queue);
     }
 
 
     void BlockHeader(const std::array<aubyte, 80> &header) { blockHeader = header; }
-    void TargetBits(aulong reference) { targetBits = reference; }
+    void TargetBits(aulong reference) {
+        if(reference < targetBits) demand = 0; // difficulty went up, previous overflows are no more representative
+        targetBits = reference;
+    }
 
     //! Tries to evolve algorithm state. The only thing that prevents an algorithm to evolve is completion of the mapping operations.
     //! \param [in,out] blockers contains a list of events representing completed operations. If the event I'm waiting for is in the set,
     //! I will remove it from the set of waiting events.
     AlgoEvent Tick(std::vector<cl_event> &blockers) {
         // The first, most important thing to do is to free results so I can start again.
-        if(mapping) {
-            auto matched(std::find(blockers.cbegin(), blockers.cend(), mapping));
+        if(reading) {
+            auto matched(std::find(blockers.cbegin(), blockers.cend(), reading));
             if(matched == blockers.cend()) return AlgoEvent::working;
             blockers.erase(matched);
+            if(readingHeader) { // now I know how many candidates to pull
+                readingHeader = false;
+                clReleaseEvent(reading);
+                reading = 0;
+                const asizei count = StoredCandidates();
+                if(count == 0) return AlgoEvent::results;
+                const asizei entrySize = sizeof(cl_uint) * (1 + algo.uintsPerHash);
+                cl_int err = clEnqueueReadBuffer(queue, candidates, CL_FALSE, 2 * sizeof(cl_uint), count * entrySize, nonces + 2, 0, NULL, &reading);
+                if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " attempting to read back nonce buffer.";
+                return AlgoEvent::working;
+            }
             return AlgoEvent::results;
         }
         if(algo.Overflowing()) return AlgoEvent::exhausted; // nothing to do
 
+        const asizei want = std::max(ExpectedCapacity(), demand);
+        if(want > maxResults || want * 4 <= maxResults) PrepareCandidates(want);
+
         cl_int err = 0;
         err = clEnqueueWriteBuffer(queue, wuData, CL_TRUE, 0, sizeof(blockHeader), blockHeader.data(), 0, NULL, NULL);
         if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " while attempting to update $wuData";
 
+        if(blockHeader != midstateHeader) { // the first 64 bytes don't depend on nonce so there's no need to do this every time
+            std::array<auint, 8> state;
+            if(algo.Midstate(state, blockHeader)) {
+                err = clEnqueueWriteBuffer(queue, midstate, CL_TRUE, 0, sizeof(state), state.data(), 0, NULL, NULL);
+                if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " while attempting to update $midstate";
+            }
+            midstateHeader = blockHeader;
+        }
+
         cl_uint buffer[5]; // taken as is from M8M FillDispatchData... how ugly!
         buffer[0] = 0;
         buffer[1] = static_cast<cl_uint>(targetBits >> 32);
         buffer[2] = static_cast<cl_uint>(targetBits);
-        buffer[3] = 0;
-        buffer[4] = 0;
+        buffer[3] = ++generation;
+        buffer[4] = cl_uint(maxResults);
         err = clEnqueueWriteBuffer(queue, dispatchData, CL_TRUE, 0, sizeof(buffer), buffer, 0, NULL, NULL);
         if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " while attempting to update $dispatchData";
 
-        cl_uint zero = 0;
-        clEnqueueWriteBuffer(queue, candidates, true, 0, sizeof(cl_uint), &zero, 0, NULL, NULL);
+        const cl_uint zero = 0; // in-queue, no need to wait for this
+        err = clEnqueueFillBuffer(queue, candidates, &zero, sizeof(zero), 0, sizeof(zero), 0, NULL, NULL);
+        if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " while attempting to reset $candidates";
 
         algo.RunAlgorithm(queue, algo.hashCount);
         dispatchedHeader = blockHeader;
 
-        nonces = reinterpret_cast<cl_uint*>(clEnqueueMapBuffer(queue, candidates, CL_FALSE, CL_MAP_READ, 0, nonceBufferSize, 0, NULL, &mapping, &err));
-        if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " attempting to map nonce buffers.";
+        err = clEnqueueReadBuffer(queue, candidates, CL_FALSE, 0, 2 * sizeof(cl_uint), nonces, 0, NULL, &reading);
+        if(err != CL_SUCCESS) throw std::string("CL error ") + std::to_string(err) + " attempting to read back nonce buffer header.";
+        readingHeader = true;
 
         return AlgoEvent::dispatched; // this could be ae_working as well but returning ae_dispatched at least once sounds good.
     }
 
 
     void GetEvents(std::vector<cl_event> &events) const {
-        if(mapping) events.push_back(mapping);
+        if(reading) events.push_back(reading);
     }
 
 
     MinedNonces GetResults() {
-        asizei count = *nonces;
-        if(count > maxResults) {
-            //! \todo Resize buffer for next time! This isn't very likely anyway as more results --> higher diff --> less results
-            count = maxResults;
-        }
+        asizei count = StoredCandidates();
         MinedNonces ret(dispatchedHeader);
+        if(count && nonces[0] > maxResults) {
+            ret.overflowed = nonces[0] - maxResults;
+            demand = std::max(demand, asizei(nonces[0]) * 2); // next dispatch will be bigger, provided diff does not change
+        }
         ret.hashes.reserve(count * algo.uintsPerHash);
         ret.nonces.reserve(count);
         auto incremental(nonces);
-        incremental++;
+        incremental += 2; // count, generation
         for(asizei cp = 0; cp < count; cp++) {
             ret.nonces.push_back(*incremental);
             incremental++;
             for(asizei h = 0; h < algo.uintsPerHash; h++) ret.hashes.push_back(incremental[h]);
             incremental += algo.uintsPerHash;
         }
-        clEnqueueUnmapMemObject(queue, candidates, nonces, 0, NULL, NULL);
-        nonces = nullptr;
-        clReleaseEvent(mapping);
-        mapping = 0;
+        if(reading) clReleaseEvent(reading);
+        reading = 0;
         return ret;
     }
 
 
     void Push(LateBinding &slot, asizei valueIndex) {
-        // Do nothing. Stop-n-wait has only early bound buffers.
+        // Only $candidates is late bound as it gets reallocated.
+        slot.buff = candidates;
+        slot.rebind = true;
+        candidateSlots.push_back(&slot);
     }
 
+    //! Amount of candidates the result buffer can currently hold.
+    asizei GetCandidateCapacity() const { return maxResults; }
+
     //! So I have more private stuff.
     AbstractSpecialValuesProvider& AsValueProvider() { return *this; }
 
@@ -135,29 +187,82 @@ public:
     /*! Ideally, restore object state as before the last Tick() happened.
     In practice some nonces get lost. Not such a big problem in the bigger drawing. */
     void Cancel(std::vector<cl_event> &blockers) {
-        if(mapping) {
-            clEnqueueUnmapMemObject(queue, candidates, nonces, 0, NULL, NULL);
-            nonces = nullptr;
-            clReleaseEvent(mapping);
-            auto match(std::find(blockers.begin(), blockers.end(), mapping));
+        if(reading) {
+            // The copy to mirror might be still going on but the queue is in-order so it will be overwritten by the next read anyway.
+            clReleaseEvent(reading);
+            auto match(std::find(blockers.begin(), blockers.end(), reading));
             if(match != blockers.end()) blockers.erase(match); // will always happen but worth a check
-            mapping = 0;
+            reading = 0;
+            readingHeader = false;
         }
     }
 
 private:
     cl_mem wuData = 0, dispatchData = 0;
+    cl_mem midstate = 0; //!< 8 uints, filled by the algorithm precompute hook, if any.
+    std::array<aubyte, 80> midstateHeader; //!< header last used to generate midstate
     cl_mem candidates = 0;
+    cl_mem mirror = 0; //!< pinned host memory, persistently mapped to nonces
     asizei nonceBufferSize = 0;
-    cl_event mapping = 0;
+    cl_event reading = 0; //!< copy of candidates to mirror
+    bool readingHeader = false; //!< reading is the copy of count and generation only, candidates still to be pulled
     cl_command_queue queue = 0;
-    auint *nonces = nullptr;
+    auint *nonces = nullptr; //!< [0] count, [1] generation, then candidates
+    auint generation = 0; //!< incremented every dispatch, kernels copy it from $dispatchData[3]
     std::array<aubyte, 80> dispatchedHeader; //!< block dispatched to last RunAlgorithm
     std::array<aubyte, 80> blockHeader; //!< block to dispatch at NEXT RunAlgorithm!
-    aulong targetBits;
+    aulong targetBits = 0;
     asizei maxResults = 0;
+    asizei demand = 0; //!< minimum capacity required, from last overflow
+    std::vector<LateBinding*> candidateSlots; //!< kernel parameters bound to $candidates, to be updated on resize
+
+    //! Candidates from the last dispatch in the buffer, only valid after the header has been read back.
+    asizei StoredCandidates() const {
+        if(nonces[0] == 0 || nonces[1] != generation) return 0; // stale, should really never happen with in-order queues
+        return std::min(asizei(nonces[0]), maxResults);
+    }
 
-    void PrepareIOBuffers(cl_context context, asizei hashCount){
+    /*! Expected amount of candidates per scan at current target, with some margin.
+    This is an estimate: the true amount is only known after the kernels run. */
+    asizei ExpectedCapacity() const {
+        const adouble chance = (adouble(targetBits) + 1.0) / 18446744073709551616.0; // 2^64, targetBits is compared to the hash high ulong
+        const adouble expected = adouble(algo.hashCount) * chance;
+        asizei want = 32;
+        while(want < expected * 4 && want < algo.hashCount) want *= 2;
+        return want;
+    }
+
+    void ReleaseCandidates() {
+        if(nonces) clEnqueueUnmapMemObject(queue, mirror, nonces, 0, NULL, NULL);
+        nonces = nullptr;
+        if(queue) clFinish(queue);
+        if(mirror) clReleaseMemObject(mirror);
+        if(candidates) clReleaseMemObject(candidates);
+        mirror = candidates = 0;
+    }
+
+    /*! (Re)creates the candidate buffer and its mirror so they can hold the given amount of results.
+    Must not be called while the mirror is being read. */
+    void PrepareCandidates(asizei capacity) {
+        ReleaseCandidates();
+        cl_int error;
+        maxResults = capacity;
+        asizei byteCount = capacity * sizeof(cl_uint) * (1 + algo.uintsPerHash);
+        byteCount += 2 * sizeof(cl_uint); // candidate count, generation
+        nonceBufferSize = byteCount;
+        candidates = clCreateBuffer(algo.context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, byteCount, NULL, &error);
+        if(error) throw std::string("OpenCL error ") + std::to_string(error) + " while trying to resulting nonces buffer.";
+        mirror = clCreateBuffer(algo.context, CL_MEM_ALLOC_HOST_PTR, byteCount, NULL, &error);
+        if(error) throw std::string("OpenCL error ") + std::to_string(error) + " while trying to create nonce mirror buffer.";
+        nonces = reinterpret_cast<cl_uint*>(clEnqueueMapBuffer(queue, mirror, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, nonceBufferSize, 0, NULL, NULL, &error));
+        if(error != CL_SUCCESS) throw std::string("CL error ") + std::to_string(error) + " attempting to map nonce mirror buffer.";
+        for(auto slot : candidateSlots) {
+            slot->buff = candidates;
+            slot->rebind = true;
+        }
+    }
+
+    void PrepareIOBuffers(cl_context context) {
         cl_int error;
         asizei byteCount = 80;
         wuData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, byteCount, NULL, &error);
@@ -165,15 +270,9 @@ private:
         byteCount = 5 * sizeof(cl_uint);
         dispatchData = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, byteCount, NULL, &error);
         if(error != CL_SUCCESS) throw std::string("OpenCL error ") + std::to_string(error) + " while trying to create dispatchData buffer.";
-        // The candidate buffer should really be dependant on difficulty setting but I take it easy.
-        byteCount = hashCount / (16 * 1024);
-        //! \todo pull the whole hash down so I can check mismatches
-        if(byteCount < 32) byteCount = 32;
-        maxResults = byteCount;
-        byteCount *= sizeof(cl_uint) * (1 + algo.uintsPerHash);
-        byteCount += 4; // initial candidate count
-        nonceBufferSize = byteCount;
-        candidates = clCreateBuffer(context, CL_MEM_ALLOC_HOST_PTR, byteCount, NULL, &error);
-        if(error) throw std::string("OpenCL error ") + std::to_string(error) + " while trying to resulting nonces buffer.";
+        byteCount = 8 * sizeof(cl_uint);
+        midstate = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, byteCount, NULL, &error);
+        if(error != CL_SUCCESS) throw std::string("OpenCL error ") + std::to_string(error) + " while trying to create midstate buffer.";
+        // The candidate buffer is created later, when the queue is there, as it must be mapped.
     }
 };
@@ -1,4 +1,5 @@
 #include "ThreadedNonceFinders.h"
+#include "../Common/SHA256Backends.h"
 
 
 std::function<void(ThreadedNonceFinders::MiningThreadParams)> ThreadedNonceFinders::GetMiningMain() {
@@ -23,6 +24,7 @@ std::function<void(ThreadedNonceFinders::MiningThreadParams)> ThreadedNonceFinde
 #endif
             self.algo.reset(algo);
             algo->identifier = std::move(build.identifier);
+            algo->midstate = build.midstate;
             self.dispatcher.reset(new StopWaitDispatcher(*self.algo));
             heap = new ThreadResources;
             self.heapResources.reset(heap);
@@ -64,10 +66,15 @@ void ThreadedNonceFinders::MiningPump(Miner &self, ThreadResources &heap) {
     bool newWork = false, newDiff = false;
     if(heap.myWork == nullptr) {
         std::unique_lock<std::mutex> lock(guard);
-        auto use(psPolicy.Select(owners));
+        auto use(psPolicy->Select(owners, GetDeviceLinearIndex(*self.dispatcher)));
         heap.myWork = use.work;
         heap.owner = use.owner;
         if(heap.myWork) {
+            if(heap.lostOwner) {
+                const auto gap(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - heap.workLost));
+                if(onFailover) onFailover(GetDeviceLinearIndex(*self.dispatcher), heap.lostOwner, heap.owner, gap);
+                heap.lostOwner = nullptr;
+            }
             AddFactory(heap.myWork);
             heap.workValidated = std::chrono::system_clock::now();
             newWork = true;
@@ -97,10 +104,16 @@ void ThreadedNonceFinders::MiningPump(Miner &self, ThreadResources &heap) {
         auto match(std::find_if(owners.cbegin(), owners.cend(), [&heap](const CurrentWork &cw) { return cw.factory == heap.myWork; }));
         if(match != owners.cend()) heap.workValidated = std::chrono::system_clock::now();
         else { // I must get another one; easiest way is to just give up and the policy will get me one next time but handle the ref counting
+            auto mine(std::find_if(owners.cbegin(), owners.cend(), [&heap](const CurrentWork &cw) { return cw.owner == heap.owner; }));
+            if(mine != owners.cend() && mine->factory == nullptr) { // not just a new job, the pool is gone or stale
+                heap.lostOwner = heap.owner;
+                heap.workLost = std::chrono::system_clock::now();
+            }
             auto factory(std::find(usedFactories.begin(), usedFactories.end(), heap.myWork));
             self.dispatcher->Cancel(heap.waiting);
             heap.algoStarted = false;
             heap.myWork = nullptr;
+            heap.prebuilt.clear();
             RemFactory(factory->res.get());
             return;
         }
@@ -142,6 +155,11 @@ void ThreadedNonceFinders::PumpDispatcher(Miner &self, ThreadResources &heap, bo
         } break;
         case AlgoEvent::results: {
             TickStatus(self);
+            {
+                std::unique_lock<std::mutex> lock(guard);
+                auto match(std::find_if(owners.begin(), owners.end(), [&heap](const CurrentWork &cw) { return cw.owner == heap.owner; }));
+                if(match != owners.end()) match->hashes += dispatcher.algo.hashCount;
+            }
             auto produced(dispatcher.GetResults()); // we know header already!
             const auto devLinear(GetDeviceLinearIndex(dispatcher));
             LARGE_INTEGER now;
@@ -157,7 +175,7 @@ void ThreadedNonceFinders::PumpDispatcher(Miner &self, ThreadResources &heap, bo
             auto verified(CheckResults(dispatcher.algo.uintsPerHash, produced, dispatch)); // note with stop-n-wait dispatchers there is only one possible match so a set will suffice
             verified.device = devLinear;
             verified.nonce2 = dispatch.nonce2;
-            if(verified.Total()) Found(dispatch.generator, verified);
+            if(verified.Total() || verified.overflowed) Found(dispatch.generator, verified);
             heap.algoStarted = false;
         } break;
     }
@@ -168,7 +186,13 @@ void ThreadedNonceFinders::Feed(Miner &self, ThreadResources &heap, bool newWork
     adouble netDiff = heap.myWork->GetNetworkDiff();
     bool generated = false;
     if(newWork) {
-        heap.current = heap.myWork->MakeNoncedHeader(self.canon.bigEndian == false, self.canon.diffNumerator);
+        if(heap.prebuilt.empty()) { // merkle roots are built multi-buffer so it's cheaper to make a few headers at once
+            heap.prebuilt.resize(hashing::sha256::GetLaneCount());
+            heap.myWork->MakeNoncedHeaders(heap.prebuilt.data(), heap.prebuilt.size(), self.canon.bigEndian == false, self.canon.diffNumerator);
+            std::reverse(heap.prebuilt.begin(), heap.prebuilt.end());
+        }
+        heap.current = std::move(heap.prebuilt.back());
+        heap.prebuilt.pop_back();
         for(asizei cp = 0; cp < heap.header.size(); cp++) heap.header[cp] = heap.current.header[cp];
 
         self.lastWUGen = std::chrono::system_clock::now();
@@ -190,6 +214,7 @@ void ThreadedNonceFinders::Feed(Miner &self, ThreadResources &heap, bool newWork
 VerifiedNonces ThreadedNonceFinders::CheckResults(asizei uintsPerHash, const MinedNonces &found, const NonceValidation &input) const {
     VerifiedNonces verified;
     verified.targetDiff = input.target;
+    verified.overflowed = found.overflowed;
     auto match = [&input](const CurrentWork &test) { return test.owner == input.generator.owner; };
     std::unique_lock<std::mutex> lock(guard);
     const auto diffMul(std::find_if(owners.cbegin(), owners.cend(), match)->diffMul);
@@ -14,6 +14,17 @@
 
 
 class ThreadedNonceFinders : public AbstractNonceFindersBuild {
+public:
+    void SetPoolScheduling(PoolScheduling policy) {
+        switch(policy) {
+        case ps_failover: psPolicy = std::make_unique<FirstWorkingPool>(); return;
+        case ps_quota: psPolicy = std::make_unique<WeightedQuota>(); return;
+        case ps_roundRobin: psPolicy = std::make_unique<RoundRobin>(); return;
+        case ps_lowestReject: psPolicy = std::make_unique<LowestReject>(); return;
+        }
+        throw std::exception("Impossible, pool scheduling policies out of sync?");
+    }
+
 protected:
     virtual std::array<aubyte, 32> HashHeader(std::array<aubyte, 80> &header, auint nonce) const = 0;
 
@@ -25,19 +36,92 @@ protected:
         WorkInfo(stratum::AbstractWorkFactory *w, stratum::WorkDiff d, const void *o) : work(w), diff(d), owner(o) { }
     };
 
+    /*! Called by the mining threads with guard locked every time they need new work so implementations can keep state without further sync.
+    Pools with no factory or not allowing the device must be skipped. */
     struct PoolSelectionPolicyInterface {
         virtual ~PoolSelectionPolicyInterface() { }
-        virtual WorkInfo Select(const std::vector<CurrentWork> &pools) = 0;
+        virtual WorkInfo Select(const std::vector<CurrentWork> &pools, asizei device) = 0;
     };
 
     struct FirstWorkingPool : PoolSelectionPolicyInterface {
-        WorkInfo Select(const std::vector<CurrentWork> &pools) {
+        WorkInfo Select(const std::vector<CurrentWork> &pools, asizei device) {
             for(auto &pool : pools) {
-                if(pool.factory) return WorkInfo(pool.factory, pool.workDiff, pool.owner);
+                if(pool.factory && pool.Allows(device)) return WorkInfo(pool.factory, pool.workDiff, pool.owner);
             }
             return WorkInfo();
         }
-    } psPolicy;
+    };
+
+    /*! Hashes are counted over a window of a few minutes so a pool coming back after a long time does not get all the devices
+    until it catches up. */
+    struct WeightedQuota : PoolSelectionPolicyInterface {
+        WorkInfo Select(const std::vector<CurrentWork> &pools, asizei device) {
+            const auto now(std::chrono::system_clock::now());
+            if(base.size() != pools.size() || now >= windowStart + std::chrono::minutes(5)) {
+                base.resize(pools.size());
+                for(asizei cp = 0; cp < pools.size(); cp++) base[cp] = pools[cp].hashes;
+                windowStart = now;
+            }
+            adouble totalQuota = .0, totalHashes = .0;
+            for(asizei loop = 0; loop < pools.size(); loop++) {
+                if(!pools[loop].factory) continue;
+                totalQuota += pools[loop].scheduling.quota;
+                totalHashes += adouble(pools[loop].hashes - base[loop]);
+            }
+            const CurrentWork *best = nullptr;
+            adouble bestDeficit = .0;
+            for(asizei loop = 0; loop < pools.size(); loop++) {
+                const auto &pool(pools[loop]);
+                if(!pool.factory || !pool.Allows(device)) continue;
+                const adouble got = totalHashes > .0? adouble(pool.hashes - base[loop]) / totalHashes : .0;
+                const adouble deficit = pool.scheduling.quota / totalQuota - got;
+                if(!best || deficit > bestDeficit) {
+                    best = &pool;
+                    bestDeficit = deficit;
+                }
+            }
+            return best? WorkInfo(best->factory, best->workDiff, best->owner) : WorkInfo();
+        }
+    private:
+        std::vector<aulong> base;
+        std::chrono::system_clock::time_point windowStart;
+    };
+
+    //! Every device keeps track of the last pool used and moves to the next one with work.
+    struct RoundRobin : PoolSelectionPolicyInterface {
+        WorkInfo Select(const std::vector<CurrentWork> &pools, asizei device) {
+            if(device >= last.size()) last.resize(device + 1, asizei(-1));
+            for(asizei loop = 1; loop <= pools.size(); loop++) {
+                const asizei index = (last[device] + loop) % pools.size();
+                if(!pools[index].factory || !pools[index].Allows(device)) continue;
+                last[device] = index;
+                return WorkInfo(pools[index].factory, pools[index].workDiff, pools[index].owner);
+            }
+            return WorkInfo();
+        }
+    private:
+        std::vector<asizei> last;
+    };
+
+    /*! Pools with no replies yet are considered as good as the others: ratio is smoothed as (rejected + 1) / (total + 2).
+    On ties, config order wins. */
+    struct LowestReject : PoolSelectionPolicyInterface {
+        WorkInfo Select(const std::vector<CurrentWork> &pools, asizei device) {
+            const CurrentWork *best = nullptr;
+            adouble bestRatio = .0;
+            for(auto &pool : pools) {
+                if(!pool.factory || !pool.Allows(device)) continue;
+                const adouble ratio = (pool.rejected + 1.0) / (pool.accepted + pool.rejected + 2.0);
+                if(!best || ratio < bestRatio) {
+                    best = &pool;
+                    bestRatio = ratio;
+                }
+            }
+            return best? WorkInfo(best->factory, best->workDiff, best->owner) : WorkInfo();
+        }
+    };
+
+    std::unique_ptr<PoolSelectionPolicyInterface> psPolicy { std::make_unique<FirstWorkingPool>() };
 
 
 private:
@@ -51,7 +135,10 @@ private:
 
         stratum::AbstractWorkFactory *myWork = nullptr;
         const void *owner = nullptr;
+        const void *lostOwner = nullptr; //!< set when owner withdraws work, cleared when new work is acquired
+        std::chrono::system_clock::time_point workLost;
         stratum::Work current;
+        std::vector<stratum::Work> prebuilt; //!< next headers from myWork, used from the back
         stratum::WorkDiff diff;
         std::array<aubyte, 80> header; //!< header to dispatch at next Feed. It is kept so when diff changes we don't regen.
 
@@ -91,8 +178,11 @@ private:
     VerifiedNonces CheckResults(asizei uintsPerHash, const MinedNonces &found, const NonceValidation &input) const;
 
     void Found(const NonceOriginIdentifier &owner, VerifiedNonces &magic) {
-        std::unique_lock<std::mutex> lock(guard);
-        results.push(std::make_pair(owner, std::move(magic)));
+        {
+            std::unique_lock<std::mutex> lock(guard);
+            results.push(std::make_pair(owner, std::move(magic)));
+        }
+        if(onResults) onResults();
     }
 
     void BadThings(Miner &self, Status status, const char *msg) {
@@ -74,6 +74,7 @@ public:
     virtual asizei GetHashCount() const = 0;
     virtual asizei GetNumUintsPerCandidate() const = 0;
     virtual SignedAlgoIdentifier GetAlgoIdentifier() const = 0;
+    virtual AbstractAlgorithm::MidstateKind GetMidstateKind() const { return AbstractAlgorithm::MidstateKind::none; }
 
 protected:
     asizei linearIntensity; //!< I'm pretty sure this one will be common to all algorithms.
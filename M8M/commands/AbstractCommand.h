@@ -9,6 +9,7 @@
 #include <rapidjson/stringbuffer.h>
 #include <string>
 #include "PushInterface.h"
+#include "CBOR.h"
 
 namespace commands {
 
@@ -32,8 +33,11 @@ public:
 	When non-empty string is returned, string is sent as is.
 	Implementations must set the resulting reply only if they recognize their own properties.
 	Implementations are suggested to produce a push streamer only if after result has been set. Push streamers with no reply produced
-	are dropped anyway. */
-	bool Mangle(std::string &result, std::unique_ptr<PushInterface> &streamer, const rapidjson::Value &input) {
+	are dropped anyway.
+	\param binary Produce CBOR instead of JSON text, errors become CBOR text strings.
+	\param replied If not null and a push streamer is produced, gets the document the reply was serialized from. */
+	bool Mangle(std::string &result, std::unique_ptr<PushInterface> &streamer, const rapidjson::Value &input, bool binary = false,
+	            std::unique_ptr<rapidjson::Document> *replied = nullptr) {
 		using namespace rapidjson;
 		#if defined(_DEBUG)
 		StringBuffer nice;
@@ -43,15 +47,20 @@ public:
 		#endif
 		const Value &command(input["command"]);
 		if(command.IsString() == false ||  std::string(command.GetString(), command.GetStringLength()) != name) return false;
-		Document reply;
+		std::unique_ptr<Document> reply(new Document);
 		std::unique_ptr<PushInterface> ret;
+		auto error = [&result, binary](const std::string &what) {
+			result.clear();
+			if(binary) cbor::EncodeText(result, what);
+			else result = what;
+		};
 		try {
-			ret.reset(Parse(reply, input));
+			ret.reset(Parse(*reply, input));
 		} catch(std::string &what) {
-			result = std::string("!!ERROR: ") + what + "!!";
+			error(std::string("!!ERROR: ") + what + "!!");
 			return true;
 		} catch(std::exception &what) {
-			result = std::string("!!ERROR: ") + what.what() + "!!";
+			error(std::string("!!ERROR: ") + what.what() + "!!");
 			return true;
 		}
 		const Value::ConstMemberIterator &push(input.FindMember("push"));
@@ -59,19 +68,26 @@ public:
 		else if(push->value.IsBool() == false) throw  std::exception("!!ERROR: .push subfield must be a boolean.");
 		else if(push->value.GetBool()) {
 			if(ret.get() == nullptr) {
-				result = std::string("!!ERROR: push requested but command produced no pusher!!");
+				error(std::string("!!ERROR: push requested but command produced no pusher!!"));
 				return true;
 			}
 			streamer = std::move(ret);
 		}
-		StringBuffer buff;
-		#if defined(_DEBUG)
-		PrettyWriter<StringBuffer> writer(buff, nullptr);
-		#else
-		Writer<StringBuffer> writer(buff, nullptr);
-		#endif
-		reply.Accept(writer);
-		result.assign(buff.GetString(), buff.GetSize());
+		if(binary) {
+			result.clear();
+			cbor::Encode(result, *reply);
+		}
+		else {
+			StringBuffer buff;
+			#if defined(_DEBUG)
+			PrettyWriter<StringBuffer> writer(buff, nullptr);
+			#else
+			Writer<StringBuffer> writer(buff, nullptr);
+			#endif
+			reply->Accept(writer);
+			result.assign(buff.GetString(), buff.GetSize());
+		}
+		if(replied && streamer) *replied = std::move(reply);
 		return true;
 	}
 	virtual ~AbstractCommand() { }
@@ -39,14 +39,15 @@ protected:
 			RefreshAndReply(out, true);
 		}
 
-		bool Refresh(rapidjson::Document &out) {
-			return RefreshAndReply(out, false);
+		bool Refresh(rapidjson::Document &out, bool whole) {
+			return RefreshAndReply(out, whole);
 		}
 
 		/*! Given current state (what to monitor) tick internal logic to refresh your values. If those values changed, produce output.
 		Because a reply must always be given when input from user is received, you must consider this a change in itself and give output in that case.
 		This is also called by the command generating this PUSH when replying to a request.
-		To avoid expensive copies, build directly in the result and return false to discard that value. */
+		To avoid expensive copies, build directly in the result and return false to discard that value.
+		When forcedOutput is true the whole state must be produced, not only what changed since the last call. */
 		virtual bool RefreshAndReply(rapidjson::Document &result, bool forcedOutput) = 0;
 
 	protected:
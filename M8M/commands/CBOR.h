@@ -0,0 +1,253 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../../Common/AREN/ArenDataTypes.h"
+#include <rapidjson/document.h>
+#include <string>
+#include <cstring>
+#include <cmath>
+
+namespace commands {
+
+/*! Concise Binary Object Representation, RFC 7049. Commands build their replies as rapidjson values anyway so instead of inventing
+a schema for each of them the binary protocol just encodes the very same values in CBOR: numbers go out as numbers instead of text
+and clients don't have to parse anything. Bytes are kept in std::string as that's what the JSON path uses for replies. */
+namespace cbor {
+
+enum MajorType {
+    mt_unsigned,
+    mt_negative,
+    mt_bytes,
+    mt_text,
+    mt_array,
+    mt_map,
+    mt_tag,
+    mt_simple
+};
+
+
+inline void EncodeHead(std::string &dst, MajorType major, aulong value) {
+    const char type = char(major << 5);
+    if(value < 24) dst += char(type | value);
+    else if(value <= 0xFF) {
+        dst += char(type | 24);
+        dst += char(value);
+    }
+    else if(value <= 0xFFFF) {
+        dst += char(type | 25);
+        for(aint shift = 8; shift >= 0; shift -= 8) dst += char(value >> shift);
+    }
+    else if(value <= 0xFFFFFFFFull) {
+        dst += char(type | 26);
+        for(aint shift = 24; shift >= 0; shift -= 8) dst += char(value >> shift);
+    }
+    else {
+        dst += char(type | 27);
+        for(aint shift = 56; shift >= 0; shift -= 8) dst += char(value >> shift);
+    }
+}
+
+
+inline void EncodeText(std::string &dst, const char *text, asizei len) {
+    EncodeHead(dst, mt_text, len);
+    dst.append(text, len);
+}
+
+
+inline void EncodeText(std::string &dst, const std::string &text) { EncodeText(dst, text.c_str(), text.length()); }
+
+
+//! Appends value to dst. Integers keep their exact value, other numbers are sent as single precision floats if that's lossless.
+inline void Encode(std::string &dst, const rapidjson::Value &value) {
+    using namespace rapidjson;
+    switch(value.GetType()) {
+    case kNullType: dst += char(0xF6); return;
+    case kFalseType: dst += char(0xF4); return;
+    case kTrueType: dst += char(0xF5); return;
+    case kStringType: EncodeText(dst, value.GetString(), value.GetStringLength()); return;
+    case kArrayType:
+        EncodeHead(dst, mt_array, value.Size());
+        for(SizeType loop = 0; loop < value.Size(); loop++) Encode(dst, value[loop]);
+        return;
+    case kObjectType:
+        EncodeHead(dst, mt_map, value.MemberCount());
+        for(auto el = value.MemberBegin(); el != value.MemberEnd(); ++el) {
+            EncodeText(dst, el->name.GetString(), el->name.GetStringLength());
+            Encode(dst, el->value);
+        }
+        return;
+    }
+    if(value.IsUint64()) EncodeHead(dst, mt_unsigned, value.GetUint64());
+    else if(value.IsInt64()) EncodeHead(dst, mt_negative, aulong(-1 - value.GetInt64()));
+    else {
+        const adouble real = value.GetDouble();
+        const float single = float(real);
+        if(adouble(single) == real || real != real) {
+            auint bits;
+            memcpy(&bits, &single, sizeof(single));
+            dst += char(0xFA);
+            for(aint shift = 24; shift >= 0; shift -= 8) dst += char(bits >> shift);
+        }
+        else {
+            aulong bits;
+            memcpy(&bits, &real, sizeof(real));
+            dst += char(0xFB);
+            for(aint shift = 56; shift >= 0; shift -= 8) dst += char(bits >> shift);
+        }
+    }
+}
+
+
+class Decoder {
+public:
+    const static auint MAX_DEPTH = 32;
+
+    /*! Parses a single item taking all the bytes. Throws std::exception if input is not valid CBOR or cannot be represented in JSON:
+    byte strings and non-text map keys are refused as the commands would not know what to do with them. */
+    static void Decode(rapidjson::Document &dst, const aubyte *src, asizei len) {
+        Decoder parse(src, len);
+        parse.Item(dst, dst.GetAllocator(), 0);
+        if(parse.next != parse.end) throw std::exception("CBOR message has trailing bytes.");
+    }
+
+private:
+    const aubyte *next, *end;
+    Decoder(const aubyte *src, asizei len) : next(src), end(src + len) { }
+
+    aubyte Byte() {
+        if(next == end) throw std::exception("CBOR message is truncated.");
+        return *next++;
+    }
+
+    //! Returns the argument of the head, true in indefinite is set for length 31 which is only allowed for strings and containers.
+    aulong Argument(aubyte info, bool &indefinite) {
+        indefinite = false;
+        if(info < 24) return info;
+        aulong ret = 0;
+        switch(info) {
+        case 24: return Byte();
+        case 25: for(auint loop = 0; loop < 2; loop++) ret = (ret << 8) | Byte(); return ret;
+        case 26: for(auint loop = 0; loop < 4; loop++) ret = (ret << 8) | Byte(); return ret;
+        case 27: for(auint loop = 0; loop < 8; loop++) ret = (ret << 8) | Byte(); return ret;
+        case 31: indefinite = true; return 0;
+        }
+        throw std::exception("CBOR reserved additional information.");
+    }
+
+    bool Break() {
+        if(next == end) throw std::exception("CBOR message is truncated.");
+        if(*next != 0xFF) return false;
+        next++;
+        return true;
+    }
+
+    void Text(std::string &dst, aubyte info) {
+        bool indefinite;
+        const aulong len = Argument(info, indefinite);
+        if(!indefinite) {
+            if(len > aulong(end - next)) throw std::exception("CBOR message is truncated.");
+            dst.append(reinterpret_cast<const char*>(next), asizei(len));
+            next += len;
+            return;
+        }
+        while(!Break()) { // chunks must be definite length strings of the same type
+            const aubyte chunk = Byte();
+            if((chunk >> 5) != mt_text || (chunk & 0x1F) == 31) throw std::exception("CBOR invalid text string chunk.");
+            Text(dst, chunk & 0x1F);
+        }
+    }
+
+    void Item(rapidjson::Value &dst, rapidjson::Document::AllocatorType &alloc, auint depth) {
+        using namespace rapidjson;
+        if(depth > MAX_DEPTH) throw std::exception("CBOR message nested too deep.");
+        const aubyte initial = Byte();
+        const aubyte info = initial & 0x1F;
+        bool indefinite = false;
+        switch(initial >> 5) {
+        case mt_unsigned: dst.SetUint64(Argument(info, indefinite)); break;
+        case mt_negative: {
+            const aulong magnitude = Argument(info, indefinite);
+            if(magnitude > aulong(INT64_MAX)) dst.SetDouble(-1.0 - adouble(magnitude));
+            else dst.SetInt64(-1 - along(magnitude));
+            break;
+        }
+        case mt_bytes: throw std::exception("CBOR byte strings are not supported.");
+        case mt_text: {
+            std::string build;
+            Text(build, info);
+            dst.SetString(build.c_str(), SizeType(build.length()), alloc);
+            return;
+        }
+        case mt_array: {
+            const aulong count = Argument(info, indefinite);
+            dst.SetArray();
+            for(aulong loop = 0; indefinite? !Break() : loop < count; loop++) {
+                Value el;
+                Item(el, alloc, depth + 1);
+                dst.PushBack(el, alloc);
+            }
+            return;
+        }
+        case mt_map: {
+            const aulong count = Argument(info, indefinite);
+            dst.SetObject();
+            for(aulong loop = 0; indefinite? !Break() : loop < count; loop++) {
+                const aubyte key = Byte();
+                if((key >> 5) != mt_text) throw std::exception("CBOR map keys must be text strings.");
+                std::string name;
+                Text(name, key & 0x1F);
+                Value el;
+                Item(el, alloc, depth + 1);
+                dst.AddMember(Value(name.c_str(), SizeType(name.length()), alloc), el, alloc);
+            }
+            return;
+        }
+        case mt_tag: // semantic tags are not meaningful to commands, the tagged item is used as is
+            Argument(info, indefinite);
+            Item(dst, alloc, depth + 1);
+            return;
+        case mt_simple:
+            switch(info) {
+            case 20: dst.SetBool(false); return;
+            case 21: dst.SetBool(true); return;
+            case 22:
+            case 23: dst.SetNull(); return;
+            case 25: {
+                const auint half = (auint(Byte()) << 8) | Byte();
+                const aint exp = (half >> 10) & 0x1F;
+                const adouble mant = half & 0x3FF;
+                adouble val;
+                if(exp == 0) val = ldexp(mant, -24);
+                else if(exp != 31) val = ldexp(mant + 1024, exp - 25);
+                else val = mant == 0? HUGE_VAL : NAN;
+                dst.SetDouble(half & 0x8000? -val : val);
+                return;
+            }
+            case 26: {
+                auint bits = 0;
+                for(auint loop = 0; loop < 4; loop++) bits = (bits << 8) | Byte();
+                float real;
+                memcpy(&real, &bits, sizeof(real));
+                dst.SetDouble(real);
+                return;
+            }
+            case 27: {
+                aulong bits = 0;
+                for(auint loop = 0; loop < 8; loop++) bits = (bits << 8) | Byte();
+                adouble real;
+                memcpy(&real, &bits, sizeof(real));
+                dst.SetDouble(real);
+                return;
+            }
+            }
+            throw std::exception("CBOR simple value not supported.");
+        }
+        if(indefinite) throw std::exception("CBOR indefinite length on a number.");
+    }
+};
+
+
+}
+}
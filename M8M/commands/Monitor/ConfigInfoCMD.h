@@ -56,7 +56,7 @@ public:
                 Value entry;
                 if(el.rejectReasons.size()) {
                     Value reasons(kArrayType);
-                    for(auto &str : el.rejectReasons) reasons.PushBack(StringRef(str.c_str()), alloc);
+                    for(auto &str : el.rejectReasons) reasons.PushBack(Value(str.c_str(), SizeType(str.length()), alloc), alloc); // el goes away before serializing
                     entry.SetObject();
                     entry.AddMember("rejectReasons", reasons, alloc);
                     Document copy;
@@ -74,6 +74,7 @@ public:
                         spec.AddMember("device", dev, alloc);
                         spec.AddMember("hashCount", info.hashCount, alloc);
                         spec.AddMember("memUsage", Describe(info.memUsage, alloc), alloc);
+                        spec.AddMember("aliasingSavings", info.aliasingSavings, alloc);
                         devArr.PushBack(spec, alloc);
                     }
                     entry.AddMember("active", devArr, alloc);
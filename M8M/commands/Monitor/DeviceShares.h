@@ -13,12 +13,13 @@ class DeviceShares : public AbstractStreamingCommand {
 public:
 	struct ShareStats {
 		aulong found, bad, discarded, stale;
+        aulong overflowed; //!< found by device but lost as the candidate buffer was too small
         std::chrono::time_point<std::chrono::system_clock> last;
         adouble dsps; //!< this is akin to work utility in legacy miners but not quite!
 
-		ShareStats() : found(0), bad(0), stale(0), discarded(0), dsps(.0) { }
+		ShareStats() : found(0), bad(0), stale(0), discarded(0), overflowed(0), dsps(.0) { }
         bool operator!=(const ShareStats &other) const {
-            return found != other.found || bad != other.bad || discarded != other.discarded || stale != other.stale || dsps != other.dsps;
+            return found != other.found || bad != other.bad || discarded != other.discarded || stale != other.stale || overflowed != other.overflowed || dsps != other.dsps;
         }
 	};
 	class ValueSourceInterface {
@@ -62,6 +63,7 @@ private:
 			Value &bad(mkSizedArr("bad"));
 			Value &discarded(mkSizedArr("discarded"));
 			Value &stale(mkSizedArr("stale"));
+			Value &overflowed(mkSizedArr("overflowed"));
 			Value &dsps(mkSizedArr("dsps"));
 			Value &lastResult(mkSizedArr("lastResult"));
 			for(asizei loop = 0; loop < poll.size(); loop++) {
@@ -75,6 +77,7 @@ private:
 					bad.PushBack(poll[loop].bad, build.GetAllocator());
 					discarded.PushBack(poll[loop].discarded, build.GetAllocator());
 					stale.PushBack(poll[loop].stale, build.GetAllocator());
+					overflowed.PushBack(poll[loop].overflowed, build.GetAllocator());
 					dsps.PushBack(poll[loop].dsps, build.GetAllocator());
                     auto sinceEpochLast = std::chrono::duration_cast<std::chrono::seconds>(poll[loop].last.time_since_epoch());
 					lastResult.PushBack(sinceEpochLast.count(), build.GetAllocator());
@@ -21,13 +21,21 @@ public:
         auint numActivationAttempts = 0;
         std::chrono::system_clock::duration cumulatedTime;
         std::chrono::system_clock::time_point lastSubmitReply, lastActivity;
+        asizei recvBuffered = 0, recvCopied = 0; //!< bytes waiting for a newline and bytes moved by the receive buffer, see AbstractWorkSource::ReceiveStats
+        adouble hashrate = .0; //!< hashes per second computed by devices mining for this pool
+        auint failovers = 0; //!< how many times a device had to leave this pool as its work was withdrawn
+        std::chrono::microseconds lastFailoverGap { 0 }, longestFailoverGap { 0 }; //!< time spent by devices without work after leaving this pool
+        std::chrono::microseconds lastConnectLatency { 0 }, avgConnectLatency { 0 }; //!< from starting a connection to handshake, resolution included
 
 		ShareStats() : sent(0), accepted(0), rejected(0), daps(.0) { }
         bool operator!=(const ShareStats &other) const {
             return sent != other.sent || accepted != other.accepted || rejected != other.rejected || daps != other.daps ||
                 lastActivated != other.lastActivated || lastConnDown != other.lastConnDown ||
                 numActivationAttempts != other.numActivationAttempts || cumulatedTime != other.cumulatedTime ||
-                lastSubmitReply != other.lastSubmitReply || lastActivity != other.lastActivity;
+                lastSubmitReply != other.lastSubmitReply || lastActivity != other.lastActivity ||
+                recvBuffered != other.recvBuffered || recvCopied != other.recvCopied ||
+                hashrate != other.hashrate || failovers != other.failovers || lastFailoverGap != other.lastFailoverGap || longestFailoverGap != other.longestFailoverGap ||
+                lastConnectLatency != other.lastConnectLatency || avgConnectLatency != other.avgConnectLatency;
         }
 	};
 	class ValueSourceInterface {
@@ -96,6 +104,22 @@ private:
                         auto howMuch(duration_cast<seconds>(out.cumulatedTime));
                         add.AddMember("cumulatedTime", howMuch.count(), alloc);
                     }
+                    if(out.recvBuffered != sent[check].recvBuffered || changes) add.AddMember("recvBuffered", aulong(out.recvBuffered), alloc);
+                    if(out.recvCopied != sent[check].recvCopied || changes) add.AddMember("recvCopied", aulong(out.recvCopied), alloc);
+                    if(out.hashrate != sent[check].hashrate || changes) add.AddMember("hashrate", out.hashrate, alloc);
+                    if(out.failovers != sent[check].failovers || changes) add.AddMember("failovers", out.failovers, alloc);
+                    if(out.lastFailoverGap != sent[check].lastFailoverGap || changes) {
+                        add.AddMember("lastFailoverGap", duration_cast<milliseconds>(out.lastFailoverGap).count(), alloc);
+                    }
+                    if(out.longestFailoverGap != sent[check].longestFailoverGap || changes) {
+                        add.AddMember("longestFailoverGap", duration_cast<milliseconds>(out.longestFailoverGap).count(), alloc);
+                    }
+                    if(out.lastConnectLatency != sent[check].lastConnectLatency || changes) {
+                        add.AddMember("lastConnectLatency", duration_cast<milliseconds>(out.lastConnectLatency).count(), alloc);
+                    }
+                    if(out.avgConnectLatency != sent[check].avgConnectLatency || changes) {
+                        add.AddMember("avgConnectLatency", duration_cast<milliseconds>(out.avgConnectLatency).count(), alloc);
+                    }
                     sent[check] = out;
                     build.PushBack(add, alloc);
                 }
@@ -0,0 +1,75 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../AbstractCommand.h"
+#include "../../ScanTimeHistory.h"
+
+namespace commands {
+namespace monitor {
+
+/*! Iteration time over the last 10 minutes at one second resolution or the last 24 hours at one minute resolution.
+.params.resolution is "seconds" (default) or "minutes". .params.since is optional, seconds from epoch: only samples ending after it
+are returned so a client can poll for new samples only.
+Reply has the resolution in seconds and for each device parallel arrays, oldest sample first: "end" seconds from epoch,
+"count" iterations completed and "avg", "min", "max" microseconds. Those are 0 if the device did no iterations in that time. */
+class ScanHistoryCMD : public AbstractCommand {
+public:
+    ScanHistoryCMD(const ScanTimeHistory &src) : history(src), AbstractCommand("scanHistory") { }
+
+
+private:
+    const ScanTimeHistory &history;
+
+    PushInterface* Parse(rapidjson::Document &build, const rapidjson::Value &input) {
+        using namespace rapidjson;
+        using namespace std::chrono;
+        bool minutes = false;
+        aulong since = 0;
+        const Value::ConstMemberIterator params(input.FindMember("params"));
+        if(params != input.MemberEnd() && params->value.IsObject()) {
+            const Value::ConstMemberIterator resolution(params->value.FindMember("resolution"));
+            const Value::ConstMemberIterator after(params->value.FindMember("since"));
+            if(resolution != params->value.MemberEnd()) {
+                const std::string name(resolution->value.IsString()? resolution->value.GetString() : "");
+                if(name == "minutes") minutes = true;
+                else if(name != "seconds") throw std::exception("\"scanHistory\", .params.resolution must be \"seconds\" or \"minutes\".");
+            }
+            if(after != params->value.MemberEnd()) {
+                if(after->value.IsUint64() == false) throw std::exception("\"scanHistory\", .params.since must be seconds from epoch.");
+                since = after->value.GetUint64();
+            }
+        }
+        build.SetObject();
+        build.AddMember("resolution", minutes? 60 : 1, build.GetAllocator());
+        Value devices(kArrayType);
+        for(asizei loop = 0; loop < history.GetNumDevices(); loop++) {
+            const ScanTimeHistory::Series &series(minutes? history.GetMinutes(loop) : history.GetSeconds(loop));
+            Value end(kArrayType), count(kArrayType), avg(kArrayType), lowest(kArrayType), highest(kArrayType);
+            for(asizei sample = 0; sample < series.size(); sample++) {
+                const ScanTimeHistory::Sample &el(series[sample]);
+                const aulong when = aulong(duration_cast<seconds>(el.end.time_since_epoch()).count());
+                if(when <= since) continue;
+                end.PushBack(uint64_t(when), build.GetAllocator());
+                count.PushBack(uint64_t(el.count), build.GetAllocator());
+                avg.PushBack(uint64_t(el.count? el.sum / el.count : 0), build.GetAllocator());
+                lowest.PushBack(uint64_t(el.min), build.GetAllocator());
+                highest.PushBack(uint64_t(el.max), build.GetAllocator());
+            }
+            Value dev(kObjectType);
+            dev.AddMember("end", end, build.GetAllocator());
+            dev.AddMember("count", count, build.GetAllocator());
+            dev.AddMember("avg", avg, build.GetAllocator());
+            dev.AddMember("min", lowest, build.GetAllocator());
+            dev.AddMember("max", highest, build.GetAllocator());
+            devices.PushBack(dev, build.GetAllocator());
+        }
+        build.AddMember("devices", devices, build.GetAllocator());
+        return nullptr;
+    }
+};
+
+
+}
+}
@@ -0,0 +1,67 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../AbstractCommand.h"
+#include "../../ScanTimeHistory.h"
+
+namespace commands {
+namespace monitor {
+
+/*! Iteration time percentiles of each device since mining started, in microseconds.
+Optional .params.percentiles is an array of numbers in [0..100], by default 50, 90, 99, 99.9 and 100.
+Reply has the percentiles used and an entry for each device, null if the device never completed an iteration. Values are never
+underestimated but can be a bit bigger than the real ones, see ScanTimeHistogram. */
+class ScanPercentilesCMD : public AbstractCommand {
+public:
+    ScanPercentilesCMD(const ScanTimeHistory &src) : history(src), AbstractCommand("scanPercentiles") { }
+
+
+private:
+    const ScanTimeHistory &history;
+
+    PushInterface* Parse(rapidjson::Document &build, const rapidjson::Value &input) {
+        using namespace rapidjson;
+        std::vector<adouble> percentiles;
+        const Value::ConstMemberIterator params(input.FindMember("params"));
+        if(params != input.MemberEnd() && params->value.IsObject()) {
+            const Value::ConstMemberIterator list(params->value.FindMember("percentiles"));
+            if(list != params->value.MemberEnd()) {
+                if(list->value.IsArray() == false || list->value.Size() == 0) throw std::exception("\"scanPercentiles\", .params.percentiles must be a non-empty array.");
+                for(SizeType loop = 0; loop < list->value.Size(); loop++) {
+                    const Value &el(list->value[loop]);
+                    if(el.IsNumber() == false || el.GetDouble() < 0 || el.GetDouble() > 100) throw std::exception("\"scanPercentiles\", percentiles must be numbers in [0..100].");
+                    percentiles.push_back(el.GetDouble());
+                }
+            }
+        }
+        if(percentiles.empty()) percentiles = { 50, 90, 99, 99.9, 100 };
+        build.SetObject();
+        Value used(kArrayType);
+        for(auto el : percentiles) used.PushBack(el, build.GetAllocator());
+        build.AddMember("percentiles", used, build.GetAllocator());
+        Value devices(kArrayType);
+        std::vector<aulong> snapshot;
+        for(asizei loop = 0; loop < history.GetNumDevices(); loop++) {
+            aulong sum;
+            const aulong count = history.GetHistogram(snapshot, sum, loop);
+            if(count == 0) {
+                devices.PushBack(Value(kNullType), build.GetAllocator());
+                continue;
+            }
+            Value dev(kObjectType), values(kArrayType);
+            for(auto el : percentiles) values.PushBack(uint64_t(ScanTimeHistogram::Percentile(snapshot, el)), build.GetAllocator());
+            dev.AddMember("count", uint64_t(count), build.GetAllocator());
+            dev.AddMember("avg", uint64_t(sum / count), build.GetAllocator());
+            dev.AddMember("values", values, build.GetAllocator());
+            devices.PushBack(dev, build.GetAllocator());
+        }
+        build.AddMember("devices", devices, build.GetAllocator());
+        return nullptr;
+    }
+};
+
+
+}
+}
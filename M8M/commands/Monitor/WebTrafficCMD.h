@@ -0,0 +1,49 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+#pragma once
+#include "../AbstractCommand.h"
+
+namespace commands {
+namespace monitor {
+
+/*! How many bytes the web server has sent so far and how much it saved by compressing them.
+Only text messages are counted, frame headers and control frames are not. */
+class WebTrafficCMD : public AbstractCommand {
+public:
+    struct Totals {
+        aulong messages = 0;
+        aulong raw = 0; //!< payload bytes before compression
+        aulong sent = 0; //!< payload bytes after compression
+        asizei clients = 0, deflating = 0; //!< connected now and how many of those negotiated permessage-deflate
+    };
+
+    class TrafficSourceInterface {
+    public:
+        virtual ~TrafficSourceInterface() { }
+        //! Including connections already closed.
+        virtual Totals GetTraffic() const = 0;
+    };
+
+    WebTrafficCMD(const TrafficSourceInterface &src) : source(src), AbstractCommand("webTraffic") { }
+
+
+private:
+    const TrafficSourceInterface &source;
+
+    PushInterface* Parse(rapidjson::Document &build, const rapidjson::Value &input) {
+        const Totals got(source.GetTraffic());
+        build.SetObject();
+        build.AddMember("messages", uint64_t(got.messages), build.GetAllocator());
+        build.AddMember("raw", uint64_t(got.raw), build.GetAllocator());
+        build.AddMember("sent", uint64_t(got.sent), build.GetAllocator());
+        build.AddMember("clients", uint64_t(got.clients), build.GetAllocator());
+        build.AddMember("deflating", uint64_t(got.deflating), build.GetAllocator());
+        return nullptr;
+    }
+};
+
+
+}
+}
@@ -23,9 +23,11 @@ public:
 
 	/*! This is called every time possible to check state against previous tick state.
 	The only "input" here is passing time and what we want to know is a message to push to clint IF the contents changed.
+	\param whole Produce the whole state even if it did not change, as when replying to the request. Usually only what changed is
+	produced, clients asking for delta pushes get the whole state diffed by the server instead.
 	\return false if nothing to send, otherwise true and a valid JSON value to be used as payload.
 	\note For rapidjson, reply must be a Document (albeit it's a Value) so it can go along with its own allocator. */
-	virtual bool Refresh(rapidjson::Document &out) = 0;
+	virtual bool Refresh(rapidjson::Document &out, bool whole) = 0;
 };
 
 
@@ -228,20 +228,24 @@ kernel void Echo_8way(global uint2 *input, global uint2 *hashOut, global uint *a
     if(get_local_id(0) == 3) {
         ulong magic = upsample(myHash.y, myHash.x);
         ulong target =  upsample(dispatchData[1], dispatchData[2]); // watch out for endianess!
-		passhi[get_local_id(1)] = magic <= target;
+		passhi[get_local_id(1)] = 0;
         if(magic <= target) {
             uint storage = atomic_inc(found);
-			passhi[get_local_size(1) + get_local_id(1)] = storage;
-			// Now passing out the whole hash as well as nonce for extra checking
-            const uint nonce = (uint)(get_global_id(1));
-            found[storage * 17 + 1] = as_uint(as_char4(nonce).wzyx); // watch out for endianess!
+            found[1] = dispatchData[3]; // generation, tells the host those results are current
+            if(storage < dispatchData[4]) { // capacity, count keeps going so the host can figure out it overflowed
+                passhi[get_local_id(1)] = 1;
+                passhi[get_local_size(1) + get_local_id(1)] = storage;
+                // Now passing out the whole hash as well as nonce for extra checking
+                const uint nonce = (uint)(get_global_id(1));
+                found[storage * 17 + 2] = as_uint(as_char4(nonce).wzyx); // watch out for endianess!
+            }
         }
     }
 	barrier(CLK_LOCAL_MEM_FENCE);
 	uint candidate = 0;
 	for(uint slot = 0; slot < get_local_size(1); slot++) candidate = slot == get_local_id(1)? passhi[slot] : candidate;
 	if(candidate) {
-	    found++;
+	    found += 2; // count, generation
         candidate = passhi[get_local_size(1) + get_local_id(1)]; // very **likely** broadcast
 		found += candidate * 17;
         found++; // this one is the nonce, already stored
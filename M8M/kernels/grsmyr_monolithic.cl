@@ -801,7 +801,9 @@ kernel void grsmyr_monolithic(global uint *found, global uint *wuData, global ui
     ulong target = (((ulong)dispatchData[1]) << 32) | dispatchData[2]; // watch out for endianess!
     if(hash.quad[3] <= target) {
         uint storage = atomic_inc(found);
-        found++;
+        found[1] = dispatchData[3]; // generation, tells the host those results are current
+        if(storage >= dispatchData[4]) return; // capacity, count keeps going so the host can figure out it overflowed
+        found += 2; // count, generation
         found += storage * 9;
         found[0] = as_uint(as_char4(get_global_id(0)).wzyx); // watch out for endianess!
         for(uint cp = 0; cp < 8; cp++) found[1 + cp] = hash.dword[cp];
@@ -316,7 +316,12 @@ kernel void firstKDF_4way(global uint *blockHeader, global uchar *output, const
 	local uint lds[16 * 33];
 	// local uint *team = lds + get_local_id(1) * 33;
 	uint buffStart = 0;
-	for(uint loop = 0; loop < CONST_N; loop++) {
+#if defined KDF_CONST_N
+	const uint kdfIterations = KDF_CONST_N; // baked by host, known at compile time
+#else
+	const uint kdfIterations = CONST_N;
+#endif
+	for(uint loop = 0; loop < kdfIterations; loop++) {
 		barrier(CLK_GLOBAL_MEM_FENCE);
 		buffStart = FastKDFIteration(lds, buffStart, buff_a, buff_b);
 	}
@@ -369,7 +374,12 @@ kernel void lastKDF_4way(volatile global uint *found, global uint *dispatchData,
 	}
 	local uint lds[16 * 33];
 	uint buffStart = 0;
-	for(uint loop = 0; loop < CONST_N; loop++) {
+#if defined KDF_CONST_N
+	const uint kdfIterations = KDF_CONST_N; // baked by host, known at compile time
+#else
+	const uint kdfIterations = CONST_N;
+#endif
+	for(uint loop = 0; loop < kdfIterations; loop++) {
 		barrier(CLK_GLOBAL_MEM_FENCE);
 		buffStart = FastKDFIteration(lds, buffStart, buff_a, buff_b);
 	}
@@ -393,19 +403,23 @@ kernel void lastKDF_4way(volatile global uint *found, global uint *dispatchData,
 		global uint *finalHash = (global uint*)output_to_test;
         const ulong magic = upsample(finalHash[7], finalHash[6]);
         const ulong target =  upsample(dispatchData[1], dispatchData[2]); // watch out for endianess!
-		lds[get_local_id(1)] = magic < target;
+		lds[get_local_id(1)] = 0;
         if(magic < target) {
 			uint storage = atomic_inc(found);
-			uint nonce = (uint)(get_global_id(1));
-			found[1 + storage * (outLen / 4 + 1)] = as_uint(as_uchar4(nonce).wzyx);
-			lds[get_local_size(1) + get_local_id(1)] = storage;
+			found[1] = dispatchData[3]; // generation, tells the host those results are current
+			if(storage < dispatchData[4]) { // capacity, count keeps going so the host can figure out it overflowed
+				uint nonce = (uint)(get_global_id(1));
+				found[2 + storage * (outLen / 4 + 1)] = as_uint(as_uchar4(nonce).wzyx);
+				lds[get_local_id(1)] = 1;
+				lds[get_local_size(1) + get_local_id(1)] = storage;
+			}
 		}
 	}
 	barrier(CLK_LOCAL_MEM_FENCE);
 	uint candidate = 0;
 	for(uint slot = 0; slot < get_local_size(1); slot++) candidate = slot == get_local_id(1)? lds[slot] : candidate;
 	if(candidate) { // taken from echo8W but not very efficient, would be much better to pack writes, but that rarely happens anyway!
-	    found++;
+	    found += 2; // count, generation
         candidate = lds[get_local_size(1) + get_local_id(1)]; // very **likely** broadcast
 		found += candidate * 9;
         found++; // this one is the nonce, already stored
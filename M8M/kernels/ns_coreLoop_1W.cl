@@ -234,7 +234,12 @@ kernel void sequentialWrite_1way(global uint *xin, global uint *padBuffer,
     xin    += get_local_id(0);
     statex += get_local_id(0);
     uint16 mangle = LoadStateSlice(xin + 16 * 3 * get_local_size(0));
-    for(uint loop = 0; loop < iterations; loop++) {
+#if defined LOOP_ITERATIONS
+    const uint loopCount = LOOP_ITERATIONS; // baked by host, known at compile time
+#else
+    const uint loopCount = iterations;
+#endif
+    for(uint loop = 0; loop < loopCount; loop++) {
         barrier(CLK_GLOBAL_MEM_FENCE);
         for(uint slice = 0; slice < 4; slice++) {
             barrier(CLK_LOCAL_MEM_FENCE);
@@ -270,7 +275,12 @@ kernel void indirectedRead_1way(global uint *xio, global const uint *padBuffer,
     padBuffer += 16 * slot;
     // updated state from previous slice iteration, this starts with slice[3]
     uint16 mangle = LoadStateSlice(xio + 16 * 3 * get_local_size(0));
-    for(uint loop = 0; loop < iterations; loop++) {
+#if defined LOOP_ITERATIONS
+    const uint loopCount = LOOP_ITERATIONS; // baked by host, known at compile time
+#else
+    const uint loopCount = iterations;
+#endif
+    for(uint loop = 0; loop < loopCount; loop++) {
         barrier(CLK_GLOBAL_MEM_FENCE);
         const uint indirected = xio[48 * get_local_size(0)] % 128;
         global const uint *padSlices = padBuffer + indirected * 64 * get_global_size(0);
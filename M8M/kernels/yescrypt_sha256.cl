@@ -100,6 +100,31 @@ kernel void yescrypt_sha256_80B(global uint *block, global uint *hashOut) {
 }
 
 
+/*! Same as yescrypt_sha256_80B but the first 64 bytes of the header have been already hashed by the host.
+midstate is the SHA256 state after the first block, so only the block containing the nonce needs to be processed. */
+kernel void yescrypt_sha256_80B_tail(global uint *midstate, global uint *block, global uint *hashOut) {
+	const uint slot = get_global_id(0) - get_global_offset(0);
+	uint8 state = (uint8)(midstate[0], midstate[1], midstate[2], midstate[3],
+	                      midstate[4], midstate[5], midstate[6], midstate[7]);
+	uint shaBuff[16];
+	for(uint i = 0; i < 3; i++) shaBuff[i] = as_uint(as_uchar4(block[i + 16]).wzyx);
+	shaBuff[3] = (uint)(get_global_id(0)); // nonce
+	shaBuff[4] = 0x80000000;
+	for(uint i = 5; i < 15; i++) shaBuff[i] = 0;
+	shaBuff[15] = 80 * 8;
+	SHA256_transform(&state, shaBuff);
+	hashOut += slot * 8;
+	hashOut[0] = state.s0;
+	hashOut[1] = state.s1;
+	hashOut[2] = state.s2;
+	hashOut[3] = state.s3;
+	hashOut[4] = state.s4;
+	hashOut[5] = state.s5;
+	hashOut[6] = state.s6;
+	hashOut[7] = state.s7;
+}
+
+
 
 
 #ifdef PBKDF2_BLOCK_STRIDE
@@ -387,7 +412,9 @@ kernel void FinalMangling(global uint *io, global uint *block
 	const uint target = dispatchData[1];
 	if(magic <= target) {
         const uint storage = atomic_inc(found);
-		found++;
+		found[1] = dispatchData[3]; // generation, tells the host those results are current
+		if(storage >= dispatchData[4]) return; // capacity, count keeps going so the host can figure out it overflowed
+		found += 2; // count, generation
 		found += storage * 9;
 		found[0] = get_global_id(0);
 		found[1] = as_uint(as_uchar4(octx.s0).wzyx);
@@ -0,0 +1,611 @@
+/*
+ * This code is released under the MIT license.
+ * For conditions of distribution and use, see the LICENSE or hit the web.
+ */
+/*! Conformance check of the binary monitor protocol: every monitor command and pusher must give the same values to clients which
+negotiated "M8M-monitor-cbor" as they give to "M8M-monitor" clients in JSON.
+A JSON client and a CBOR client connect to a real AbstractWSServer over an in-memory network, send the same requests with valid
+parameters and subscribe to the same streams. Each CBOR reply and push is decoded and must be equal to the parsed JSON one.
+This is a console program on its own, it is not part of M8M.vcxproj. Build it together with ../AbstractWSServer.cpp, with the M8M
+directory and local-include in the include path, then link Common, zlib and Ws2_32.
+Returns 0 if everything matched, otherwise prints what did not and returns 1. */
+#include "../AbstractWSServer.h"
+#include "../../Common/PoolInfo.h"
+#include "../commands/Monitor/SystemInfoCMD.h"
+#include "../commands/Monitor/AlgosCMD.h"
+#include "../commands/Monitor/PoolCMD.h"
+#include "../commands/Monitor/RejectReasonCMD.h"
+#include "../commands/Monitor/ConfigInfoCMD.h"
+#include "../commands/Monitor/ScanTime.h"
+#include "../commands/Monitor/ScanPercentilesCMD.h"
+#include "../commands/Monitor/ScanHistoryCMD.h"
+#include "../commands/Monitor/DeviceShares.h"
+#include "../commands/Monitor/PoolStats.h"
+#include "../commands/Monitor/UptimeCMD.h"
+#include "../commands/VersionCMD.h"
+#include "../commands/ExtensionListCMD.h"
+#include "../commands/UpgradeCMD.h"
+#include <rapidjson/writer.h>
+#include <deque>
+#include <cstdio>
+
+
+//! Sockets are byte queues, connections are made by the test and only accepted by the server.
+class LoopbackNetwork : public NetworkInterface {
+public:
+    class Pipe : public ConnectedSocketInterface {
+    public:
+        Pipe *peer = nullptr;
+        std::deque<abyte> incoming;
+        bool open = true;
+        asizei Send(const abyte *octects, asizei count) throw() {
+            if(!open || !peer->open) return 0;
+            peer->incoming.insert(peer->incoming.end(), octects, octects + count);
+            return count;
+        }
+        asizei Receive(abyte *octects, asizei buffSize) throw() {
+            const asizei count = buffSize < incoming.size()? buffSize : incoming.size();
+            std::copy(incoming.begin(), incoming.begin() + count, octects);
+            incoming.erase(incoming.begin(), incoming.begin() + count);
+            return count;
+        }
+        bool GotData() const { return incoming.size() != 0; }
+        bool CanSend() const { return open; }
+        bool Works() const { return open && peer->open; }
+        std::string PeerHost() const { return "loopback"; }
+        std::string PeerPort() const { return "0"; }
+    };
+    class Landing : public ServiceSocketInterface {
+    public:
+        const aushort port;
+        std::deque<Pipe*> pending;
+        explicit Landing(aushort number) : port(number) { }
+        aushort GetPort() const { return port; }
+        bool Works() const { return true; }
+    };
+
+    //! \returns The client end, the server end is accepted by the next Refresh.
+    Pipe& Connect() {
+        if(!landing) throw std::exception("Nobody is listening.");
+        pipes.push_back(std::make_unique<Pipe>());
+        Pipe &client(*pipes.back());
+        pipes.push_back(std::make_unique<Pipe>());
+        Pipe &server(*pipes.back());
+        client.peer = &server;
+        server.peer = &client;
+        landing->pending.push_back(&server);
+        return client;
+    }
+    //! Only the sockets with something to do, the way SleepOn would leave them.
+    void Ready(std::vector<SocketInterface*> &toRead) const {
+        auto idle = [this](SocketInterface *test) {
+            if(landing.get() == test) return landing->pending.empty();
+            return static_cast<Pipe*>(test)->GotData() == false;
+        };
+        toRead.erase(std::remove_if(toRead.begin(), toRead.end(), idle), toRead.end());
+    }
+
+    std::pair<ConnectedSocketInterface*, ConnectionError> BeginConnection(const char *host, const char *portService) {
+        return std::make_pair(nullptr, ce_noRoutes);
+    }
+    bool CloseConnection(ConnectedSocketInterface &object) {
+        static_cast<Pipe&>(object).open = false;
+        return true;
+    }
+    asizei SleepOn(std::vector<SocketInterface*> &read, std::vector<SocketInterface*> &write, asizei timeoutms) { return 0; }
+    void Wake() { }
+    SockErr GetSocketError() { return se_OK; }
+    ConnectionError GetConnectionError(const ConnectedSocketInterface &socket) const { return ce_ok; }
+    ServiceSocketInterface& NewServiceSocket(aushort port, aushort numPending) {
+        landing.reset(new Landing(port));
+        return *landing;
+    }
+    void CloseServiceSocket(ServiceSocketInterface &what) { landing.reset(); }
+    ConnectedSocketInterface& BeginConnection(ServiceSocketInterface &listener) {
+        Pipe *accepted = landing->pending.front();
+        landing->pending.pop_front();
+        return *accepted;
+    }
+
+private:
+    std::unique_ptr<Landing> landing;
+    std::vector<std::unique_ptr<Pipe>> pipes;
+};
+
+
+//! Just enough of a WebSocket client: unfragmented, uncompressed messages.
+class Client {
+public:
+    const bool binary;
+    explicit Client(bool cbor) : binary(cbor), pipe(nullptr) { }
+
+    void Upgrade(LoopbackNetwork &network, const char *protocol) {
+        pipe = &network.Connect();
+        const std::string request(std::string("GET /monitor HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n") +
+                                  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n" +
+                                  "Sec-WebSocket-Protocol: " + protocol + "\r\n\r\n");
+        pipe->Send(request.c_str(), request.length());
+    }
+    bool Upgraded() {
+        const char *end = "\r\n\r\n";
+        auto stop = std::search(pipe->incoming.begin(), pipe->incoming.end(), end, end + 4);
+        if(stop == pipe->incoming.end()) return false;
+        const std::string response(pipe->incoming.begin(), stop + 4);
+        pipe->incoming.erase(pipe->incoming.begin(), stop + 4);
+        if(response.find("HTTP/1.1 101") != 0) throw std::exception(("Upgrade refused: " + response).c_str());
+        return true;
+    }
+
+    void Send(const std::string &message) {
+        std::vector<abyte> frame;
+        frame.push_back(abyte(binary? 0x82 : 0x81));
+        if(message.length() <= 125) frame.push_back(abyte(0x80 | message.length()));
+        else {
+            frame.push_back(abyte(0x80 | 126));
+            frame.push_back(abyte(message.length() >> 8));
+            frame.push_back(abyte(message.length()));
+        }
+        const abyte mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+        frame.insert(frame.end(), mask, mask + 4);
+        for(asizei loop = 0; loop < message.length(); loop++) frame.push_back(message[loop] ^ mask[loop % 4]);
+        pipe->Send(frame.data(), frame.size());
+    }
+
+    //! Data messages received so far, control frames are dropped.
+    std::vector<std::string> Received() {
+        std::vector<std::string> ret;
+        std::deque<abyte> &in(pipe->incoming);
+        while(in.size() >= 2) {
+            const aubyte opcode = aubyte(in[0]) & 0x0F;
+            aulong len = aubyte(in[1]) & 0x7F;
+            asizei header = 2;
+            if(len == 126 || len == 127) {
+                const asizei extra = len == 126? 2 : 8;
+                if(in.size() < header + extra) break;
+                len = 0;
+                for(asizei loop = 0; loop < extra; loop++) len = (len << 8) | aubyte(in[header + loop]);
+                header += extra;
+            }
+            if(in.size() < header + len) break;
+            if(aubyte(in[0]) & 0x40) throw std::exception("Compressed message but deflate was not negotiated.");
+            const std::string payload(in.begin() + header, in.begin() + header + asizei(len));
+            in.erase(in.begin(), in.begin() + header + asizei(len));
+            if(opcode == (binary? 2 : 1)) ret.push_back(payload);
+            else if(opcode < 8) throw std::exception("Unexpected message type.");
+        }
+        return ret;
+    }
+
+private:
+    LoopbackNetwork::Pipe *pipe;
+};
+
+
+/*! Fixed values for everything the monitor commands show. Numbers not fitting 32 bits, fractions, empty and null entries are
+there on purpose. Tick changes something in each streaming command so pushes have something to send. */
+class Rig : public commands::monitor::SystemInfoCMD::ProcessingNodesEnumeratorInterface,
+            public commands::monitor::AlgosCMD::AlgoEnumeratorInterface,
+            public commands::monitor::PoolCMD::PoolEnumeratorInterface,
+            public commands::monitor::RejectReasonCMD::RejInfoProviderInterface,
+            public commands::monitor::ConfigInfoCMD::ConfigDescriptorInterface,
+            public MiningPerformanceWatcherInterface,
+            public commands::monitor::DeviceShares::ValueSourceInterface,
+            public commands::monitor::PoolStats::ValueSourceInterface,
+            public commands::monitor::UptimeCMD::StartTimeProvider {
+public:
+    ScanTimeHistory history;
+    std::map<std::string, commands::ExtensionState> extensions;
+    aulong ticks = 0;
+
+    Rig() : pool("main", "stratum+tcp://pool.example.com:3333", "worker.1", "x") {
+        pool.algo = "qubit";
+        pool.diffMul.stratum = 256;
+        pool.diffMul.one = 1;
+        pool.diffMul.share = 1.0 / 3;
+        rejected.Parse("{\"hashCount\":-1,\"impl\":\"fiveSteps\"}");
+        history.SetNumDevices(2);
+        const auto start(std::chrono::system_clock::time_point(std::chrono::seconds(1420070400)));
+        for(aint second = 0; second < 3; second++) {
+            history.Record(0, std::chrono::microseconds(1500 + second * 250));
+            history.Record(0, std::chrono::microseconds(6000000000ull));
+            history.Tick(start + std::chrono::seconds(second)); // device 1 never completes an iteration
+        }
+        commands::ExtensionState ext;
+        ext.desc = "Extension with a \"quoted\" description";
+        ext.disabled = true;
+        ext.enable = [] { };
+        extensions["quoted"] = ext;
+        extensions["hidden"] = commands::ExtensionState { std::string(), true, [] { } };
+    }
+    void Tick() { ticks++; }
+
+    // SystemInfoCMD
+    const char* GetAPIName() const { return "OpenCL"; }
+    asizei GetNumPlatforms() const { return 2; }
+    std::string GetPlatformString(asizei p, PlatformInfoString pis) const { return "platform " + std::to_string(p) + " string " + std::to_string(pis) + " \xC3\xA8"; }
+    asizei GetNumDevices(asizei p) const { return p? 0 : 2; }
+    std::string GetDeviceInfo(asizei plat, asizei dev, DeviceInfoString prop) const { return "device " + std::to_string(dev) + " string " + std::to_string(prop); }
+    auint GetDeviceInfo(asizei plat, asizei dev, DeviceInfoUint prop) { return auint(dev * 1000 + prop + 23); }
+    aulong GetDeviceInfo(asizei plat, asizei dev, DeviceInfoUnsignedLong prop) { return (aulong(dev + 1) << 33) + prop; }
+    bool GetDeviceInfo(asizei plat, asizei dev, DeviceInfoBool prop) { return ((dev + prop) & 1) != 0; }
+    LDSType GetDeviceLDSType(asizei plat, asizei dev) { return dev? ldsType_global : ldsType_dedicated; }
+    DevType GetDeviceType(asizei plat, asizei dev) {
+        DevType ret;
+        ret.defaultDevice = dev == 0;
+        ret.gpu = true;
+        return ret;
+    }
+
+    // AlgosCMD
+    asizei GetNumAlgos() const { return 2; }
+    std::string GetAlgoName(asizei algo) const { return algo? "neoScrypt" : "qubit"; }
+    asizei GetNumImplementations(asizei algo) const { return algo + 1; }
+    void GetAlgoDescription(commands::monitor::AlgosCMD::AlgoDesc &desc, asizei algo, asizei impl) const {
+        desc.implementation = impl? "smooth" : "fiveSteps";
+        desc.version = "v" + std::to_string(impl + 1);
+        desc.signature = 0xFEDCBA9876543210ull >> (algo + impl);
+    }
+
+    // PoolCMD
+    asizei GetNumServers() const { return 1; }
+    const PoolInfo& GetServerInfo(asizei i) const { return pool; }
+    std::string GetConnectionURL(asizei i) const { return "stratum+tcp://pool.example.com:3333"; }
+    std::vector< std::pair<const char*, StratumState::AuthStatus> > GetWorkerAuthState(asizei i) const {
+        return { std::make_pair("worker.1", StratumState::as_accepted), std::make_pair("worker.2", StratumState::as_pending),
+                 std::make_pair("worker.3", StratumState::as_failed) };
+    }
+
+    // RejectReasonCMD
+    asizei GetNumEntries() const { return 2; }
+    asizei GetNumRejectedConfigs(asizei dev) const { return dev? 0 : 2; }
+    std::vector<std::string> GetRejectionReasons(asizei dev, asizei entry) const {
+        return { "not enough memory", "needs " + std::to_string(entry + 1) + " bytes more" };
+    }
+    auint GetRejectedConfigIndex(asizei dev, asizei entry) const { return auint(entry * 2); }
+
+    // ConfigInfoCMD
+    bool ValidSelection() const { return true; }
+    std::string GetSelectedAlgorithm() const { return "qubit"; }
+    bool ValidConfig() const { return true; }
+    asizei GetNumDeducedConfigs() const { return 2; }
+    commands::monitor::ConfigInfoCMD::ConfigInfo GetConfig(asizei cfg) const {
+        commands::monitor::ConfigInfoCMD::ConfigInfo ret;
+        if(cfg) {
+            ret.specified = &rejected;
+            ret.rejectReasons = { "hashCount must be positive" };
+        }
+        else {
+            ret.impl = "fiveSteps";
+            ret.devices = { 0, 1 };
+        }
+        return ret;
+    }
+    bool GetResources(AbstractAlgorithm::ConfigDesc &desc, auint dev) const {
+        desc.hashCount = 4096ull << (dev * 20);
+        desc.aliasingSavings = dev * 1024;
+        AbstractAlgorithm::ConfigDesc::MemDesc mem;
+        mem.presentation = "scratchpad";
+        mem.bytes = 0x80000000u;
+        mem.flags = { "aliased", "RW" };
+        desc.memUsage.push_back(mem);
+        mem.memoryType = AbstractAlgorithm::ConfigDesc::as_host;
+        mem.presentation = "nonces";
+        mem.bytes = 132;
+        mem.flags.clear();
+        desc.memUsage.push_back(mem);
+        return true;
+    }
+
+    // ScanTime
+    size_t GetNumDevices() const { return 3; }
+    std::chrono::seconds GetAverageWindow() const { return std::chrono::seconds(5); }
+    bool GetPerformance(DevStats &out, size_t device) const {
+        if(device == 2) return false;
+        out.min = std::chrono::microseconds(1000 + device);
+        out.max = std::chrono::microseconds(9000000000ull);
+        out.avg = std::chrono::microseconds(2500 + ticks * 7);
+        out.last = std::chrono::microseconds(ticks * 1000 + 500);
+        return true;
+    }
+
+    // DeviceShares
+    bool GetDeviceShareStats(commands::monitor::DeviceShares::ShareStats &out, asizei devLinearIndex) {
+        if(devLinearIndex >= 2) return false;
+        out.found = 10 + ticks;
+        out.bad = devLinearIndex;
+        out.discarded = 0;
+        out.stale = 1ull << 40;
+        out.overflowed = ticks / 2;
+        out.dsps = 0.1 * (ticks + 1) + devLinearIndex;
+        out.last = std::chrono::system_clock::time_point(std::chrono::seconds(1420070400 + ticks));
+        return true;
+    }
+
+    // PoolStats
+    bool GetPoolShareStats(commands::monitor::PoolStats::ShareStats &out, asizei poolIndex) {
+        if(poolIndex >= 1) return false;
+        using namespace std::chrono;
+        out.sent = 5 + ticks;
+        out.accepted = 4 + ticks;
+        out.rejected = 1;
+        out.daps = 123.456 / (ticks + 1);
+        out.lastActivated = system_clock::time_point(seconds(1420070400));
+        out.lastConnDown = system_clock::time_point();
+        out.numActivationAttempts = 1;
+        out.cumulatedTime = seconds(3600 + ticks);
+        out.lastSubmitReply = system_clock::time_point(seconds(1420070500 + ticks));
+        out.lastActivity = out.lastSubmitReply;
+        out.recvBuffered = 17;
+        out.recvCopied = 1 << 20;
+        out.hashrate = 1.5e6 + ticks;
+        out.failovers = 2;
+        out.lastFailoverGap = milliseconds(250);
+        out.longestFailoverGap = milliseconds(1250);
+        out.lastConnectLatency = milliseconds(80);
+        out.avgConnectLatency = milliseconds(95);
+        return true;
+    }
+
+    // UptimeCMD
+    std::chrono::seconds GetStartTime(commands::monitor::UptimeCMD::StartTime st) const {
+        return std::chrono::seconds(st == commands::monitor::UptimeCMD::st_firstNonce? 0 : 1420070400 + st);
+    }
+
+private:
+    PoolInfo pool;
+    rapidjson::Document rejected;
+};
+
+
+/*! None of the monitor commands allows more than one stream per client, this one does so pushes carry a stream identifier. */
+class Counter : public commands::AbstractCommand {
+public:
+    explicit Counter(const Rig &src) : rig(src), AbstractCommand("counter") { }
+    asizei GetMaxPushing() const { return 2; }
+
+protected:
+    class Pusher : public commands::PushInterface {
+    public:
+        explicit Pusher(const Rig &src) : rig(src) { }
+        bool Refresh(rapidjson::Document &out, bool whole) {
+            if(!whole && rig.ticks == sent) return false;
+            out.SetObject();
+            out.AddMember("ticks", uint64_t(rig.ticks), out.GetAllocator());
+            out.AddMember("half", rig.ticks / 2.0, out.GetAllocator());
+            sent = rig.ticks;
+            return true;
+        }
+    private:
+        const Rig &rig;
+        aulong sent = 0;
+    };
+    commands::PushInterface* Parse(rapidjson::Document &reply, const rapidjson::Value &input) {
+        std::unique_ptr<Pusher> ret(new Pusher(rig));
+        ret->Refresh(reply, true);
+        return ret.release();
+    }
+
+private:
+    const Rig &rig;
+};
+
+
+class Conformance {
+public:
+    typedef std::vector<const char*> Fields; //!< object members, looked up in push payloads too
+    asizei checked = 0, failed = 0;
+
+    Conformance() : server(network, 31000, "monitor", "M8M-monitor"), json(false), cbor(true) {
+        using namespace commands::monitor;
+        server.SetBinaryProtocol("M8M-monitor-cbor");
+        Register(new SystemInfoCMD(rig));
+        Register(new AlgosCMD(rig));
+        Register(new PoolCMD(rig));
+        Register(new RejectReasonCMD(rig));
+        Register(new ConfigInfoCMD(rig));
+        Register(new ScanTime(rig));
+        Register(new ScanPercentilesCMD(rig.history));
+        Register(new ScanHistoryCMD(rig.history));
+        Register(new DeviceShares(rig));
+        Register(new PoolStats(rig));
+        Register(new UptimeCMD(rig));
+        Register(new WebTrafficCMD(server));
+        Register(new commands::VersionCMD);
+        Register(new commands::ExtensionListCMD(rig.extensions));
+        Register(new commands::UpgradeCMD(rig.extensions));
+        Register(new commands::UnsubscribeCMD(server));
+        Register(new Counter(rig));
+    }
+
+    void Run() {
+        server.Listen();
+        json.Upgrade(network, "M8M-monitor");
+        cbor.Upgrade(network, "M8M-monitor-cbor, M8M-monitor");
+        Pump();
+        if(!json.Upgraded() || !cbor.Upgraded()) throw std::exception("Handshake did not complete.");
+
+        Reply("{\"command\":\"systemInfo\"}");
+        Reply("{\"command\":\"algos\"}");
+        Reply("{\"command\":\"pools\"}");
+        Reply("{\"command\":\"rejectReason\"}");
+        Reply("{\"command\":\"configInfo\"}");
+        Reply("{\"command\":\"scanPercentiles\"}");
+        Reply("{\"command\":\"scanPercentiles\",\"params\":{\"percentiles\":[0,12.5,99.9,100]}}");
+        Reply("{\"command\":\"scanHistory\",\"params\":{\"resolution\":\"seconds\"}}");
+        Reply("{\"command\":\"scanHistory\",\"params\":{\"resolution\":\"minutes\",\"since\":0}}");
+        Reply("{\"command\":\"scanHistory\",\"params\":{\"since\":1420070400}}");
+        Reply("{\"command\":\"uptime\"}");
+        Reply("{\"command\":\"webTraffic\"}", Fields { "messages", "raw", "sent" }); // the two replies are enqueued one after the other
+        Reply("{\"command\":\"version\"}");
+        Reply("{\"command\":\"extensionList\"}");
+        Reply("{\"command\":\"upgrade\",\"params\":{\"mode\":\"query\",\"list\":[\"quoted\",\"missing\"]}}");
+        Reply("{\"command\":\"upgrade\",\"params\":{\"mode\":\"enable\",\"list\":[\"quoted\"]}}");
+        Reply("{\"command\":\"scanTime\"}");
+        Reply("{\"command\":\"deviceShares\"}");
+        Reply("{\"command\":\"poolStats\"}");
+        Reply("{\"command\":\"scanPercentiles\",\"params\":{\"percentiles\":[101]}}"); // errors are text strings in both
+        Reply("{\"command\":\"noSuchCommand\"}");
+
+        // Both clients share each pusher so this is a single push encoded both ways.
+        const char *streaming[] = { "scanTime", "deviceShares", "poolStats", nullptr };
+        for(asizei loop = 0; streaming[loop]; loop++) Reply("{\"command\":\"" + std::string(streaming[loop]) + "\",\"push\":true}");
+        Reply("{\"command\":\"counter\",\"push\":true}", Fields { "stream" });
+        Pushes("push", 4);
+        Unsubscribe(streaming);
+
+        // Clients joining a delta stream get the whole state once, which would not match the patch the first subscriber gets.
+        // The CBOR client adds .minInterval so it has its own pushers, both get patches from the first push.
+        for(asizei loop = 0; streaming[loop]; loop++) {
+            const std::string request("{\"command\":\"" + std::string(streaming[loop]) + "\",\"push\":true,\"delta\":true");
+            Reply(request + '}', request + ",\"minInterval\":0}");
+        }
+        Reply("{\"command\":\"counter\",\"push\":true,\"delta\":true}", "{\"command\":\"counter\",\"push\":true,\"delta\":true,\"minInterval\":0}", Fields { "stream" });
+        Pushes("delta push", 4);
+        Unsubscribe(streaming);
+    }
+
+private:
+    LoopbackNetwork network;
+    AbstractWSServer server;
+    Rig rig;
+    Client json, cbor;
+
+    void Register(commands::AbstractCommand *cmd) {
+        std::unique_ptr<commands::AbstractCommand> own(cmd);
+        server.RegisterCommand(own);
+    }
+
+    void Pump() {
+        for(asizei loop = 0; loop < 8; loop++) {
+            std::vector<Network::SocketInterface*> toRead, toWrite;
+            server.FillSleepLists(toRead, toWrite);
+            network.Ready(toRead);
+            if(toRead.empty() && toWrite.empty() && !server.NeedsPolling()) return;
+            server.Refresh(toRead, toWrite);
+        }
+    }
+
+    void Reply(const std::string &request, const Fields &volatileFields = Fields()) {
+        Reply(request, request, volatileFields);
+    }
+
+    void Reply(const std::string &textRequest, const std::string &binaryRequest, const Fields &volatileFields = Fields()) {
+        rapidjson::Document parsed;
+        parsed.Parse(binaryRequest.c_str());
+        if(parsed.HasParseError()) throw std::exception(("Bad test request " + binaryRequest).c_str());
+        std::string encoded;
+        commands::cbor::Encode(encoded, parsed);
+        json.Send(textRequest);
+        cbor.Send(encoded);
+        Pump();
+        const std::vector<std::string> text(json.Received()), binary(cbor.Received());
+        if(text.size() != 1 || binary.size() != 1) {
+            Fail(textRequest, "expected a reply each, got " + std::to_string(text.size()) + " JSON and " + std::to_string(binary.size()) + " CBOR");
+            return;
+        }
+        Compare(textRequest, text[0], binary[0], volatileFields);
+    }
+
+    /*! Something changes for each subscribed stream at each round, each client must get a push for each stream. */
+    void Pushes(const char *what, asizei streams) {
+        for(asizei round = 0; round < 3; round++) {
+            rig.Tick();
+            Pump();
+            const std::vector<std::string> text(json.Received()), binary(cbor.Received());
+            const std::string label(std::string(what) + " round " + std::to_string(round));
+            if(text.size() != streams || binary.size() != streams) {
+                Fail(label, "expected " + std::to_string(streams) + " pushes each, got " + std::to_string(text.size()) + " JSON and " + std::to_string(binary.size()) + " CBOR");
+                continue;
+            }
+            for(asizei loop = 0; loop < streams; loop++) Compare(label, text[loop], binary[loop], { "stream" });
+        }
+    }
+
+    void Unsubscribe(const char **streaming) {
+        for(asizei loop = 0; streaming[loop]; loop++) Reply("{\"command\":\"unsubscribe\",\"params\":{\"originator\":\"" + std::string(streaming[loop]) + "\"}}");
+        Reply("{\"command\":\"unsubscribe\",\"params\":{\"originator\":\"counter\"}}");
+        rig.Tick();
+        Pump();
+        if(json.Received().size() || cbor.Received().size()) Fail("unsubscribe", "pushes still coming");
+    }
+
+    void Compare(const std::string &label, const std::string &text, const std::string &binary, const Fields &volatileFields) {
+        checked++;
+        rapidjson::Document expected, got;
+        expected.Parse(text.c_str());
+        if(expected.HasParseError()) expected.SetString(text.c_str(), rapidjson::SizeType(text.length()), expected.GetAllocator()); // errors are not JSON
+        try {
+            commands::cbor::Decoder::Decode(got, reinterpret_cast<const aubyte*>(binary.data()), binary.length());
+        } catch(std::exception &ex) {
+            Fail(label, std::string("CBOR does not decode: ") + ex.what());
+            return;
+        }
+        // This rapidjson does not write and parse all doubles exactly but CBOR does. Put the binary ones through the same
+        // trip so only encoding differences show up.
+        TextRoundTrip(got);
+        // Those can legitimately differ between the two clients so they only need to be there, with the same type.
+        for(const char *name : volatileFields) {
+            rapidjson::Value *a = Find(expected, name), *b = Find(got, name);
+            if(a && b && a->GetType() == b->GetType() && a->IsNumber() == b->IsNumber()) {
+                a->SetNull();
+                b->SetNull();
+            }
+        }
+        if(expected != got) Fail(label, "JSON " + Serialize(expected) + "\n    CBOR " + Serialize(got));
+    }
+
+    //! Pushes wrap the payload, the field can be in either.
+    static rapidjson::Value* Find(rapidjson::Value &object, const char *name) {
+        if(object.IsObject() == false) return nullptr;
+        rapidjson::Value::MemberIterator match(object.FindMember(name));
+        if(match != object.MemberEnd()) return &match->value;
+        match = object.FindMember("payload");
+        return match != object.MemberEnd()? Find(match->value, name) : nullptr;
+    }
+
+    static void TextRoundTrip(rapidjson::Value &value) {
+        if(value.IsDouble()) {
+            rapidjson::StringBuffer buff;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buff, nullptr);
+            writer.StartArray();
+            writer.Double(value.GetDouble());
+            writer.EndArray();
+            rapidjson::Document back;
+            back.Parse(buff.GetString());
+            value.SetDouble(back.Begin()->GetDouble());
+        }
+        else if(value.IsArray()) {
+            for(rapidjson::SizeType loop = 0; loop < value.Size(); loop++) TextRoundTrip(value[loop]);
+        }
+        else if(value.IsObject()) {
+            for(auto el = value.MemberBegin(); el != value.MemberEnd(); ++el) TextRoundTrip(el->value);
+        }
+    }
+
+    static std::string Serialize(const rapidjson::Value &value) {
+        rapidjson::StringBuffer buff;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buff, nullptr);
+        value.Accept(writer);
+        return std::string(buff.GetString(), buff.GetSize());
+    }
+
+    void Fail(const std::string &label, const std::string &what) {
+        failed++;
+        printf("MISMATCH %s\n    %s\n", label.c_str(), what.c_str());
+    }
+};
+
+
+int main(int argc, char **argv) {
+    try {
+        Conformance test;
+        test.Run();
+        printf("%u checks, %u mismatches\n", unsigned(test.checked), unsigned(test.failed));
+        return test.failed? 1 : 0;
+    } catch(std::exception &ex) {
+        printf("%s\n", ex.what());
+    } catch(std::string &ex) {
+        printf("%s\n", ex.c_str());
+    }
+    return 1;
+}